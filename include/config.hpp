@@ -1,7 +1,57 @@
 #ifndef __H_CONFIG__
 #define __H_CONFIG__
 
-#include <SPIFFS.h>
+#include <ArduinoJson.h>
+#include "vic_hal.hpp"
+
+#define MAX_CONFIG_DOC 4096
+#define MAX_VIC_POLL 8
+#define MAX_VIC_MUX_SELECT 4
+
+// One VE.Direct device, on a UART of its own or on a channel of a
+// multiplexer. Pins are -1 when not given.
+struct VicInputConfig
+{
+    VicInputConfig();
+
+    const char *base;
+    int8_t uart;
+    int8_t rxPin;
+    int8_t txPin;
+    int8_t mux; // Index into the muxes, -1 for a UART of its own
+    uint8_t channel;
+    uint16_t poll[MAX_VIC_POLL]; // HEX registers to poll
+    size_t pollCount;
+    JsonObject policies;
+};
+
+// An analog multiplexer in front of a UART's RX and TX, its channel
+// picked by the select pins, LSB first
+struct VicMuxConfig
+{
+    VicMuxConfig();
+
+    int8_t uart;
+    int8_t rxPin;
+    int8_t txPin;
+    int8_t select[MAX_VIC_MUX_SELECT];
+    size_t selectCount;
+    uint16_t dwell_ms; // Longest wait for a block before moving on
+};
+
+// The board's temperature and humidity sensor. Each reading averages
+// `samples` conversions taken interval_ms apart, and is published when
+// it moves more than a deadband or maxInterval_s after the last one.
+struct VicSensorConfig
+{
+    VicSensorConfig();
+
+    uint8_t samples;
+    uint16_t interval_ms;
+    float tempDeadband;     // Degrees C
+    float humidityDeadband; // % RH
+    uint16_t maxInterval_s;
+};
 
 class Config
 {
@@ -9,11 +59,21 @@ public:
     Config();
 
 public:
-    bool readConfig(File configFile);
+    bool readConfig(VicFile &configFile);
 
     const char *getSSID();
     const char *getKey();
     const char *getMDNS();
+    bool getBatchPublish();
+    const char *getEncoding();
+    bool getBenchmark();
+    size_t getWindows(uint16_t *dest, size_t size);
+    bool getRawPublish();
+    uint16_t getReplayRate();
+    bool getBacklogSeries();
+    size_t getInputs(VicInputConfig *dest, size_t size);
+    size_t getMuxes(VicMuxConfig *dest, size_t size);
+    void getSensor(VicSensorConfig &dest);
 
 private:
     DynamicJsonDocument _doc;
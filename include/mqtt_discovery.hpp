@@ -3,21 +3,50 @@
 
 #include <AsyncUDP.h>
 #include <AsyncMqttClient.h>
+#include <Preferences.h>
+#include "vic_hal.hpp"
+#include "vic_discovery.hpp"
 
-class MQTTDiscovery
+//
+// The board's side of finding the broker: discovery broadcasts over UDP,
+// the AsyncMqttClient connection, and the last broker kept in NVS.
+// VicReconnect decides when to do what.
+//
+// The protocol is in vic_discovery.hpp.
+//
+class MQTTDiscovery : public VicBrokerLink
 {
 public:
     MQTTDiscovery(uint16_t discoveryPort, uint16_t localPort, AsyncMqttClient *mqttClient);
-    void discoverAndConnectBroker();
+
+    bool begin();
+
+    bool connected() override;
+    void connect(const VicBrokerAddr &broker) override;
+    void disconnect() override;
+    bool takeDropped() override;
+
+    void sendDiscovery() override;
+    bool takeDiscovered(VicBrokerOffer &offer) override;
+
+    bool loadBroker(VicBrokerAddr &broker) override;
+    void saveBroker(const VicBrokerAddr &broker) override;
 
 private:
     void onPacket(AsyncUDPPacket *packet);
+    void onDisconnect(AsyncMqttClientDisconnectReason reason);
 
 private:
     uint16_t _discoveryPort;
     uint16_t _localPort;
     AsyncMqttClient *_mqttClient;
     AsyncUDP _udp;
+    Preferences _prefs;
+
+    // Replies come in on the UDP task, are taken on the caller's
+    portMUX_TYPE _lock;
+    VicDiscovery _discovery;
+    volatile bool _dropped;
 };
 
-#endif
\ No newline at end of file
+#endif
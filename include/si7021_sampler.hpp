@@ -0,0 +1,73 @@
+#ifndef __H_SI7021_SAMPLER__
+#define __H_SI7021_SAMPLER__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <Wire.h>
+
+#define SI7021_ADDRESS 0x40
+// Longest RH plus temperature conversion at full resolution, 12 + 10.8 ms
+#define SI7021_CONVERSION_MS 25
+// Give up on a conversion that never completes after this long
+#define SI7021_TIMEOUT_MS 100
+#define MAX_SI7021_SAMPLES 16
+
+enum Si7021State : uint8_t
+{
+    SI7021_IDLE,
+    SI7021_CONVERTING
+};
+
+//
+// Samples an Si7021 without ever waiting on it. poll() either starts a
+// humidity conversion in no hold master mode or, once it has had time
+// to finish, collects it together with the temperature the sensor took
+// along the way. A call takes at most three short I2C transactions,
+// about a millisecond at 100 kHz, so it can sit in a loop that has
+// other work to do.
+//
+// Every `samples` readings are averaged into one result, which poll()
+// reports by returning true. Readings with a bad CRC are dropped.
+//
+class Si7021Sampler
+{
+public:
+    Si7021Sampler();
+
+    bool begin(TwoWire *wire, uint8_t samples, uint16_t interval_ms);
+
+    // True when a new averaged result is ready
+    bool poll(uint32_t now_ms);
+
+    float getTemperature();
+    float getHumidity();
+
+    // Longest single poll() since the last reset, and failed conversions
+    uint32_t getMaxPoll_us();
+    uint32_t getErrors();
+    void resetMaxPoll();
+
+private:
+    bool startConversion();
+    bool collect();
+
+private:
+    TwoWire *_wire;
+    Si7021State _state;
+    uint8_t _samples;
+    uint16_t _interval_ms;
+    uint32_t _nextSampleMillis;
+    uint32_t _startMillis;
+
+    uint8_t _count;
+    uint32_t _sumHumidity;
+    uint32_t _sumTemperature;
+
+    float _temperature;
+    float _humidity;
+
+    uint32_t _maxPoll_us;
+    uint32_t _errors;
+};
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef __H_SPSC_QUEUE__
+#define __H_SPSC_QUEUE__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+//
+// Fixed size lock-free queue for exactly one producer and one consumer,
+// e.g. a serial reader task feeding the publisher. Neither side ever
+// blocks, a push onto a full queue is dropped and counted.
+//
+// Head and tail only ever increase, the slot is the index mod N, so N
+// must be a power of two. The producer owns the head and the counters,
+// the consumer owns the tail.
+//
+template <typename T, size_t N>
+class SPSCQueue
+{
+    static_assert((N != 0) && ((N & (N - 1)) == 0),
+                  "SPSCQueue size must be a power of two");
+
+public:
+    SPSCQueue()
+        : _head(0), _tail(0), _highWater(0), _drops(0) {}
+
+    // Producer side
+    bool push(const T &item)
+    {
+        size_t head = _head.load(std::memory_order_relaxed);
+        size_t tail = _tail.load(std::memory_order_acquire);
+        if (head - tail >= N)
+        {
+            _drops.store(_drops.load(std::memory_order_relaxed) + 1,
+                         std::memory_order_relaxed);
+            return false;
+        }
+
+        _items[head & (N - 1)] = item;
+        _head.store(head + 1, std::memory_order_release);
+
+        uint32_t used = head + 1 - tail;
+        if (used > _highWater.load(std::memory_order_relaxed))
+        {
+            _highWater.store(used, std::memory_order_relaxed);
+        }
+
+        return true;
+    }
+
+    // Consumer side
+    bool pop(T *item)
+    {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        size_t head = _head.load(std::memory_order_acquire);
+        if (tail == head)
+        {
+            return false;
+        }
+
+        *item = _items[tail & (N - 1)];
+        _tail.store(tail + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // Either side, a snapshot
+    size_t size()
+    {
+        return _head.load(std::memory_order_acquire) -
+               _tail.load(std::memory_order_acquire);
+    }
+
+    size_t capacity()
+    {
+        return N;
+    }
+
+    uint32_t getHighWater()
+    {
+        return _highWater.load(std::memory_order_relaxed);
+    }
+
+    uint32_t getDrops()
+    {
+        return _drops.load(std::memory_order_relaxed);
+    }
+
+private:
+    T _items[N];
+    std::atomic<size_t> _head;
+    std::atomic<size_t> _tail;
+    std::atomic<uint32_t> _highWater;
+    std::atomic<uint32_t> _drops;
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef __H_VE_DIRECT_FILE_SOURCE__
+#define __H_VE_DIRECT_FILE_SOURCE__
+
+#include <stdio.h>
+#include "ve_direct_source.hpp"
+
+//
+// Replays a raw VE.Direct capture (the bytes exactly as they came off
+// the wire) through the same ingest path as a UART. read() never waits,
+// it returns the next chunk of the file until the file runs out. Writes
+// are counted and discarded.
+//
+class VEDirectFileSource : public VEDirectSource
+{
+public:
+    VEDirectFileSource();
+    ~VEDirectFileSource();
+
+    bool open(const char *path);
+    void close();
+
+    size_t read(uint8_t *dest, size_t size, uint32_t timeout_ms) override;
+    size_t write(const uint8_t *data, size_t len) override;
+    bool atEnd() override;
+
+    uint32_t getBytesRead();
+    uint32_t getBytesWritten();
+
+private:
+    FILE *_file;
+    uint32_t _bytesRead;
+    uint32_t _bytesWritten;
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef __H_VE_DIRECT_HEX__
+#define __H_VE_DIRECT_HEX__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define VED_HEX_MAX_DATA 48
+#define VED_HEX_CHECK 0x55
+
+// Commands (host -> device)
+#define VED_HEX_CMD_PING 0x1
+#define VED_HEX_CMD_APP_VERSION 0x3
+#define VED_HEX_CMD_PRODUCT_ID 0x4
+#define VED_HEX_CMD_RESTART 0x6
+#define VED_HEX_CMD_GET 0x7
+#define VED_HEX_CMD_SET 0x8
+#define VED_HEX_CMD_ASYNC 0xA
+
+// Responses (device -> host)
+#define VED_HEX_RSP_DONE 0x1
+#define VED_HEX_RSP_UNKNOWN 0x3
+#define VED_HEX_RSP_ERROR 0x4
+#define VED_HEX_RSP_PING 0x5
+#define VED_HEX_RSP_GET 0x7
+#define VED_HEX_RSP_SET 0x8
+#define VED_HEX_RSP_ASYNC 0xA
+
+// GET/SET/ASYNC response flags
+#define VED_HEX_FLAG_UNKNOWN_ID 0x01
+#define VED_HEX_FLAG_NOT_SUPPORTED 0x02
+#define VED_HEX_FLAG_PARAMETER_ERROR 0x04
+
+struct VEDirectHexFrame
+{
+    uint8_t command;
+    uint8_t data[VED_HEX_MAX_DATA];
+    size_t len; // Not including the checksum byte
+};
+
+// How a register maps onto a text protocol field
+struct VicHexRegister
+{
+    uint16_t reg;
+    const char *label;
+    uint8_t size;
+    bool isSigned;
+    int32_t mul;
+    int32_t div;
+};
+
+//
+// VE.Direct HEX protocol frames, ":<cmd><data...><checksum>\n" with the
+// command as a single hex digit and everything else as hex byte pairs.
+// The command plus all data bytes plus the checksum sum to 0x55.
+//
+// Register GET/SET/ASYNC data is <id lo><id hi><flags><value, LSB first>.
+//
+class VEDirectHex
+{
+public:
+    static bool decode(const char *hex, size_t len, VEDirectHexFrame *frame);
+
+    static size_t encode(char *dest, size_t size,
+                         uint8_t command,
+                         const uint8_t *data, size_t len);
+    static size_t encodeGet(char *dest, size_t size, uint16_t reg);
+    static size_t encodeSet(char *dest, size_t size, uint16_t reg,
+                            const uint8_t *value, size_t len);
+
+    static bool isRegisterFrame(const VEDirectHexFrame *frame);
+    static uint16_t getRegister(const VEDirectHexFrame *frame);
+    static uint8_t getFlags(const VEDirectHexFrame *frame);
+    static const uint8_t *getValue(const VEDirectHexFrame *frame, size_t *len);
+
+    static const VicHexRegister *findRegister(uint16_t reg);
+};
+
+#endif
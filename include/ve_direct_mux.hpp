@@ -0,0 +1,40 @@
+#ifndef __H_VE_DIRECT_MUX__
+#define __H_VE_DIRECT_MUX__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ve_direct_uart.hpp"
+
+#define MAX_VED_MUX_SELECT 4
+#define MAX_VED_MUX_CHANNELS (1 << MAX_VED_MUX_SELECT)
+
+//
+// Several VE.Direct devices on one UART through an analog multiplexer
+// (a 74HC4051/4052 or similar) switching RX and TX, the channel picked
+// by GPIO select pins. Only the selected device is heard, so a reader
+// takes turns: select() a channel, wait for a block from it, move on.
+// With n devices each one is heard every n blocks or so, plenty for
+// chargers that change slowly.
+//
+class VEDirectMux
+{
+public:
+    VEDirectMux();
+
+    bool begin(VEDirectUART *uart, const int8_t *selectPins, size_t selectCount);
+
+    // Switches and drops whatever the previous channel sent
+    void select(uint8_t channel);
+    uint8_t getChannel();
+    size_t getChannelCount();
+
+    VEDirectSource *getSource();
+
+private:
+    VEDirectUART *_uart;
+    int8_t _selectPins[MAX_VED_MUX_SELECT];
+    size_t _selectCount;
+    uint8_t _channel;
+};
+
+#endif
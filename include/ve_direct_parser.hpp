@@ -0,0 +1,87 @@
+#ifndef __H_VE_DIRECT_PARSER__
+#define __H_VE_DIRECT_PARSER__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define VED_MAX_LABEL 16
+#define VED_MAX_VALUE 48
+#define VED_MAX_HEX 96
+
+//
+// Incremental VE.Direct text protocol tokenizer. Bytes are fed one at a
+// time as they come off the wire, in whatever chunks the caller has, and
+// feed() reports when a field or a whole block is complete. Label and
+// value are tokenized in place and stay valid until the next feed().
+//
+// The block checksum is kept as a running sum. Fields are only reported
+// once the parser has seen a block boundary, and an overlong or malformed
+// line makes the parser skip to the end of the line and fail the block
+// rather than truncate the field.
+//
+// HEX protocol frames spliced into the stream are collected separately
+// and reported with EVENT_HEX, see ve_direct_hex.hpp to decode them.
+//
+class VEDirectParser
+{
+public:
+    enum Event
+    {
+        EVENT_NONE,
+        EVENT_FIELD,
+        EVENT_BLOCK_GOOD,
+        EVENT_BLOCK_BAD,
+        EVENT_HEX
+    };
+
+public:
+    VEDirectParser();
+
+    Event feed(uint8_t c);
+    void reset();
+
+    const char *getLabel();
+    const char *getValue();
+    const char *getHex();
+    size_t getHexLen();
+
+    uint32_t getGoodBlocks();
+    uint32_t getBadBlocks();
+    uint32_t getResyncs();
+    uint32_t getDroppedHex();
+
+private:
+    enum State
+    {
+        ST_IDLE,
+        ST_LABEL,
+        ST_VALUE,
+        ST_CHECKSUM,
+        ST_RESYNC,
+        ST_HEX
+    };
+
+    Event endBlock();
+    void resync();
+
+private:
+    State _state;
+    State _hexPrevState;
+    char _label[VED_MAX_LABEL];
+    char _value[VED_MAX_VALUE];
+    char _hex[VED_MAX_HEX];
+    size_t _labelLen;
+    size_t _valueLen;
+    size_t _hexLen;
+    bool _hexOverflow;
+    uint8_t _checksum;
+    bool _blockBad;
+    bool _synced;
+
+    uint32_t _goodBlocks;
+    uint32_t _badBlocks;
+    uint32_t _resyncs;
+    uint32_t _droppedHex;
+};
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef __H_VE_DIRECT_SOURCE__
+#define __H_VE_DIRECT_SOURCE__
+
+#include <stddef.h>
+#include <stdint.h>
+
+//
+// Where a reader gets its VE.Direct bytes from, a UART on the board
+// (ve_direct_uart.hpp) or a capture file on the host
+// (ve_direct_file_source.hpp). The reader loop only sees this interface,
+// so the same ingest path runs against either.
+//
+class VEDirectSource
+{
+public:
+    virtual ~VEDirectSource() {}
+
+    // Waits up to timeout_ms for bytes, then returns as many as are
+    // available, at most size. Returns 0 on timeout or end of input.
+    virtual size_t read(uint8_t *dest, size_t size, uint32_t timeout_ms) = 0;
+
+    // Queues bytes for the device (HEX commands), returns the number taken
+    virtual size_t write(const uint8_t *data, size_t len) = 0;
+
+    // True once a finite source (a capture file) has nothing more to give
+    virtual bool atEnd() { return false; }
+
+    // Times received bytes were lost before the reader got to them
+    virtual uint32_t getOverflows() { return 0; }
+};
+
+#endif
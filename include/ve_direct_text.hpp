@@ -1,22 +1,31 @@
 #ifndef __H_VE_DIRECT_TEXT__
 #define __H_VE_DIRECT_TEXT__
 
-#include <SPIFFS.h>
 #include <ArduinoJson.h>
+#include "vic_hal.hpp"
+#include "victron_defs.hpp"
+#include "ve_direct_parser.hpp"
+#include "ve_direct_hex.hpp"
+#include "spsc_queue.hpp"
+#include "vic_derived.hpp"
 
 #define MAX_ERROR_LEN 2048
-#define MAX_VIC_PAIR 128
-#define MAX_VIC_FIELD_LISTENER 10
+#define MAX_BLOCK_FIELDS 32
+#define MAX_VIC_TEXT_SLOTS 8
+#define MAX_VIC_TEXT 36
+#define MAX_VIC_REGISTERS 8
+#define VIC_DELTA_QUEUE_LEN 64
 
 #define MAX_KEY 16
 #define MAX_VALUE 48
 
-#define MAX_FIELDNAME 16
+#define MAX_DEFS_DOC 8192
 
-class VEDirectText;
+#define VIC_NO_FIELD 0xff
 
-typedef void (VEDirectText::*VicFieldListenerCallback)(DynamicJsonDocument &,
-                                                       const char *, const char *);
+// VicSlot flags
+#define VIC_SLOT_SET 0x01
+#define VIC_SLOT_REPORTED 0x02 // Sent by the device, not derived
 
 struct VicPair
 {
@@ -26,83 +35,142 @@ struct VicPair
     char value[MAX_VALUE];
 };
 
-struct VicFieldListener
+// Current value of a field, indexed by field ID. Numeric values are
+// kept as received, in the units of the field's type.
+struct VicSlot
 {
-    VicFieldListener();
+    VicSlot();
 
-    char fieldName[MAX_FIELDNAME];
-    VicFieldListenerCallback callback;
+    int32_t value;
+    uint8_t flags;
 };
 
+// Current value of a text field (serial number, firmware...)
+struct VicTextSlot
+{
+    VicTextSlot();
+
+    uint8_t fieldId;
+    char text[MAX_VIC_TEXT];
+};
+
+// Last value of a HEX register that doesn't map onto a field
+struct VicRegisterSlot
+{
+    VicRegisterSlot();
+
+    uint16_t reg;
+    bool changed;
+    uint8_t len;
+    uint8_t data[VED_HEX_MAX_DATA];
+};
+
+// VicDelta kinds
+#define VIC_DELTA_FIELD 0
+#define VIC_DELTA_REGISTER 1
+#define VIC_DELTA_BLOCK 2
+
+// One changed field or register, as passed from a reader task to the
+// publisher. Text fields carry their text in data, registers their raw
+// value bytes. A VIC_DELTA_BLOCK entry follows the changes of each
+// validated text block and carries nothing.
+struct VicDelta
+{
+    VicDelta();
+
+    uint8_t kind;
+    uint8_t fieldId;
+    uint16_t reg;
+    int32_t value;
+    uint8_t len;
+    uint8_t data[VED_HEX_MAX_DATA];
+};
+
+typedef SPSCQueue<VicDelta, VIC_DELTA_QUEUE_LEN> VicDeltaQueue;
+
+//
+// Processes the byte stream from one VE.Direct device into current field
+// values. Changed fields are flagged rather than formatted, the caller
+// walks them with nextChange() and formats only what it publishes.
+//
+// Derived fields (see VicDerived) are brought up to date once per block,
+// and after each register update, recomputing only those with a changed
+// input. A value the device sends itself is never overwritten.
+//
 class VEDirectText
 {
 public:
-    static bool loadDefs(File dataFile);
+    static bool loadDefs(VicFile &dataFile);
+    static uint32_t defsChecksum(VicFile &dataFile);
     static const char *getLoadDefsError();
+    static VicPolicy parsePolicy(JsonObject p, const VicPolicy &base);
+
+    static void formatValue(char *destValue,
+                            size_t sizeValue,
+                            char *destUnits,
+                            size_t sizeUnits,
+                            int32_t value,
+                            const char *text,
+                            VicType vicType);
 
 public:
     VEDirectText();
 
     const char *getLastError();
 
-    VicPair *findKey(const char *key);
+    void handleBytes(const uint8_t *data, size_t len);
+    void restart();
 
-    VicPair *findEmptyPair();
+    const VicSlot *getSlot(uint8_t fieldId);
+    const char *getText(uint8_t fieldId);
+    bool formatField(uint8_t fieldId,
+                     char *destValue,
+                     size_t sizeValue,
+                     char *destUnits,
+                     size_t sizeUnits);
 
-    void addFieldListener(const char *fieldName,
-                          VicFieldListenerCallback callback);
+    bool hasChanges();
+    int nextChange(int fieldId);
+    int nextRegisterChange(int index);
+    const VicRegisterSlot *getRegister(int index);
+    void clearChanges();
+    void markTextChanged();
+    bool takeChanges(VicDeltaQueue &queue);
 
-    void callFieldListener(const char *fieldName,
-                           DynamicJsonDocument &updates,
-                           const char *fieldValue,
-                           const char *unitsValue);
+    uint32_t getGoodBlocks();
+    uint32_t getBadBlocks();
+    uint32_t getBadHexFrames();
 
-    void updateCurrentData(DynamicJsonDocument &updates,
-                           const char *fieldKey,
-                           const char *fieldValue,
-                           const char *unitsKey,
-                           const char *unitsValue);
+private:
+    void handleField(const char *field, const char *value);
+    void handleHex(const char *hex, size_t len);
 
-    void handleLine(DynamicJsonDocument &updates, char *line);
+    void updateValue(const VicFieldDef *fieldDef, int32_t value, bool reported);
+    void updateText(const VicFieldDef *fieldDef, const char *text);
+    void updateRegister(uint16_t reg, const uint8_t *data, size_t len);
+    void markChanged(uint8_t fieldId);
+    void updateDerived();
 
-    void formatValue(char *destValue,
-                     size_t sizeValue,
-                     char *destUnits,
-                     size_t sizeUnits,
-                     const char *value,
-                     const char *vicType);
-
-    void vpvUpdated(DynamicJsonDocument &updates,
-                    const char *fieldValue,
-                    const char *unitsValue);
-    void ppvUpdated(DynamicJsonDocument &updates,
-                    const char *fieldValue,
-                    const char *unitsValue);
-    void vUpdated(DynamicJsonDocument &updates,
-                  const char *fieldValue,
-                  const char *unitsValue);
-    void iUpdated(DynamicJsonDocument &updates,
-                  const char *fieldValue,
-                  const char *unitsValue);
-    void pUpdated(DynamicJsonDocument &updates,
-                  const char *fieldValue,
-                  const char *unitsValue);
-
-    void updateIpv(DynamicJsonDocument &updates,
-                   float amps);
-    void updateP(DynamicJsonDocument &updates,
-                 int watts);
-    void updateEff(DynamicJsonDocument &updates,
-                   float pct);
+    VicTextSlot *findTextSlot(uint8_t fieldId, bool create);
 
 private:
     char _lastError[MAX_ERROR_LEN];
 
-    VicPair _currentData[MAX_VIC_PAIR];
-    VicFieldListener _fieldListeners[MAX_VIC_FIELD_LISTENER];
+    VicSlot _slots[MAX_VIC_FIELDS];
+    VicTextSlot _textSlots[MAX_VIC_TEXT_SLOTS];
+    VicRegisterSlot _registers[MAX_VIC_REGISTERS];
+    uint32_t _changed[VIC_FIELD_WORDS];
+    uint32_t _derivedInputs[VIC_FIELD_WORDS]; // Changed since updateDerived()
+    bool _anyChanged;
+    bool _blockEnded;
+
+    VEDirectParser _parser;
+    VicPair _block[MAX_BLOCK_FIELDS];
+    int _blockFieldCount;
+    bool _blockOverflow;
+    uint32_t _badHexFrames;
 
 protected:
-    static DynamicJsonDocument g_victronDefs;
     static char g_loadDefsError[MAX_ERROR_LEN];
 };
 
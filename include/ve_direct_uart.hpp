@@ -0,0 +1,46 @@
+#ifndef __H_VE_DIRECT_UART__
+#define __H_VE_DIRECT_UART__
+
+#include <driver/uart.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include "ve_direct_source.hpp"
+
+#define VED_UART_RX_BUFFER 1024
+#define VED_UART_EVENT_QUEUE 16
+
+// Interrupt as soon as this many bytes sit in the RX FIFO...
+#define VED_UART_RX_FIFO_THRESH 64
+// ...or the line has been idle this many symbol times (about 5 ms at
+// 19200 baud), i.e. at the end of every burst the device sends
+#define VED_UART_RX_TIMEOUT 10
+
+//
+// VE.Direct input on an ESP-IDF UART driver. The driver buffers bytes
+// from the RX interrupt and posts an event when the FIFO threshold or
+// the RX idle timeout is reached, so read() blocks on the event queue
+// and hands back whole bursts instead of being polled byte by byte.
+//
+// Don't also open the same UART through HardwareSerial.
+//
+class VEDirectUART : public VEDirectSource
+{
+public:
+    VEDirectUART();
+
+    bool begin(uart_port_t port, uint32_t baud, int rxPin, int txPin);
+
+    size_t read(uint8_t *dest, size_t size, uint32_t timeout_ms) override;
+    size_t write(const uint8_t *data, size_t len) override;
+    uint32_t getOverflows() override;
+
+    void flush();
+
+private:
+    uart_port_t _port;
+    QueueHandle_t _events;
+    bool _started;
+    uint32_t _overflows;
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef __H_VIC_AGGREGATOR__
+#define __H_VIC_AGGREGATOR__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <ArduinoJson.h>
+#include "victron_defs.hpp"
+#include "ve_direct_text.hpp"
+
+#define MAX_VIC_WINDOWS 3
+// Measured fields aggregated per device, a BMV sends about 25
+#define MAX_VIC_AGG_FIELDS 32
+
+// _slotOf entries besides an index
+#define VIC_AGG_NONE 0xff // Not seen yet
+#define VIC_AGG_SKIP 0xfe // Not aggregated
+
+// VicAggSlot flags
+#define VIC_AGG_SEEN 0x01
+
+// One numeric field over one window. A value holds until the next
+// change, so sum is the time integral in raw units times ms.
+struct VicAggSlot
+{
+    VicAggSlot();
+
+    int32_t min;
+    int32_t max;
+    int32_t last;
+    int64_t sum;
+    uint32_t duration_ms;
+    uint32_t since_ms;
+    uint8_t flags;
+};
+
+//
+// Aggregates one device's measured fields (volts, amps, watts, percent,
+// temperature and the like, see VictronDefs::isMeasurementType) over up
+// to MAX_VIC_WINDOWS report windows (e.g. 10 s and 1 min). add() every
+// change as it comes off the queue, report() a window once isDue() says
+// so. States, codes, flags and counts aren't aggregated.
+//
+// Each field reports min, max, time-weighted mean and last value,
+// scaled to the units of its type (see VicTypeScale). Currents also
+// report the charge (ah) and powers the energy (wh) over the window.
+//
+// Accumulators are fixed, MAX_VIC_AGG_FIELDS per window, handed out to
+// fields as they are first seen. Nothing is ever allocated. Fields past
+// that are left out of the reports.
+//
+class VicAggregator
+{
+public:
+    VicAggregator();
+
+    // All windows have to be added before the first add()
+    bool addWindow(uint16_t window_s, uint32_t now_ms);
+    size_t getWindowCount();
+    uint16_t getWindow(size_t window);
+
+    void add(const VicDelta &delta, uint32_t now_ms);
+    bool isDue(size_t window, uint32_t now_ms);
+    void report(size_t window, uint32_t now_ms, JsonObject dest);
+
+private:
+    void advance(VicAggSlot &slot, uint32_t now_ms);
+
+private:
+    VicAggSlot _slots[MAX_VIC_WINDOWS][MAX_VIC_AGG_FIELDS];
+    uint8_t _slotOf[MAX_VIC_FIELDS];
+    uint8_t _fieldOf[MAX_VIC_AGG_FIELDS];
+    size_t _fieldCount;
+    uint16_t _window_s[MAX_VIC_WINDOWS];
+    uint32_t _windowStart_ms[MAX_VIC_WINDOWS];
+    size_t _windowCount;
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef __H_VIC_BOOT_PROFILE__
+#define __H_VIC_BOOT_PROFILE__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "vic_hal.hpp"
+
+// Config and definition errors kept for the boot report, the board has
+// no console to print them on
+#define MAX_VIC_BOOT_ERRORS 6
+#define MAX_VIC_BOOT_ERROR 64
+#define MAX_VIC_BOOT_REPORT (320 + MAX_VIC_BOOT_ERRORS * (MAX_VIC_BOOT_ERROR + 4))
+
+// The steps from power on to publishing, in the order they usually
+// finish. Ingest doesn't wait for the network, so the first block
+// often comes in before Wi-Fi is up.
+enum VicBootPhase : uint8_t
+{
+    VIC_BOOT_SPIFFS,
+    VIC_BOOT_CONFIG,
+    VIC_BOOT_DEFS,
+    VIC_BOOT_LOG,
+    VIC_BOOT_INPUTS,      // Reader tasks running
+    VIC_BOOT_FIRST_BLOCK, // First good block from any input
+    VIC_BOOT_WIFI,
+    VIC_BOOT_BROKER,      // First broker connection
+    VIC_BOOT_COUNT
+};
+
+//
+// When each boot phase finished, in ms since boot. Each phase is marked
+// once, the first time, by one writer, and each has its own slot, so
+// setup() and the tasks can mark theirs without a lock.
+//
+// Errors are only added from setup(), before the task that reports them
+// starts. Past MAX_VIC_BOOT_ERRORS they are counted, not kept.
+//
+class VicBootProfile
+{
+public:
+    VicBootProfile(VicClock *clock);
+
+    void mark(VicBootPhase phase);
+    bool isMarked(VicBootPhase phase) const;
+    uint32_t get(VicBootPhase phase) const;
+
+    void addError(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+    // {"reason": ..., "defs": ..., "<phase>_ms": ..., "errors": [...]}
+    // with the phases marked so far, 0 if it doesn't fit
+    size_t format(char *dest, size_t size, const char *reason, const char *defs) const;
+
+    static const char *getName(VicBootPhase phase);
+
+private:
+    VicClock *_clock;
+    volatile uint32_t _at_ms[VIC_BOOT_COUNT];
+    volatile bool _marked[VIC_BOOT_COUNT];
+    char _errors[MAX_VIC_BOOT_ERRORS][MAX_VIC_BOOT_ERROR];
+    size_t _errorCount;
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef __H_VIC_DERIVED__
+#define __H_VIC_DERIVED__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "victron_defs.hpp"
+
+#define MAX_VIC_DERIVED 16
+#define MAX_VIC_DERIVED_OPS 128
+#define MAX_VIC_DERIVED_STACK 8
+
+// Words in a bitmap with one bit per field ID
+#define VIC_FIELD_WORDS ((MAX_VIC_FIELDS + 31) / 32)
+
+struct VicSlot;
+
+enum VicDerivedOpCode : uint8_t
+{
+    VIC_OP_FIELD, // Push a field's value in base units
+    VIC_OP_CONST,
+    VIC_OP_ADD,
+    VIC_OP_SUB,
+    VIC_OP_MUL,
+    VIC_OP_DIV,   // x / 0 is 0
+    VIC_OP_NEG
+};
+
+struct VicDerivedOp
+{
+    VicDerivedOpCode code;
+    uint8_t fieldId;
+    float value; // The field's base scale, or the constant
+};
+
+// One derived field, its expression in postfix order and the fields it
+// reads
+struct VicDerivedNode
+{
+    uint8_t fieldId;
+    uint8_t firstOp;
+    uint8_t opCount;
+    float scale; // Base units to the field's stored units
+    uint32_t inputs[VIC_FIELD_WORDS];
+};
+
+//
+// Fields computed from others, e.g. "expr": "PPV / VPV" on a field in
+// the definitions file. Expressions use +, -, *, /, brackets, numbers
+// and fields by label or key, and are worked out in base units (see
+// VicTypeScale), so "PPV / VPV" is W / V = A whatever the types store.
+//
+// build() compiles every field's expression once the definitions are
+// loaded, and orders them so a field derived from another derived field
+// comes after it. Call it before the readers start, they only read the
+// result. A cycle, an unknown field or a text field fails the build.
+//
+class VicDerived
+{
+public:
+    static bool build();
+    static const char *getBuildError();
+
+    // In dependency order
+    static size_t getNodeCount();
+    static const VicDerivedNode *getNode(size_t index);
+
+    // Whether any of the node's inputs are set in changed, a field bitmap
+    static bool dependsOn(const VicDerivedNode &node, const uint32_t *changed);
+    // false if an input has no value yet
+    static bool evaluate(const VicDerivedNode &node, const VicSlot *slots, int32_t *result);
+
+private:
+    static bool compile(uint8_t fieldId, const char *expr, VicDerivedNode *node);
+
+    static VicDerivedNode g_nodes[MAX_VIC_DERIVED];
+    static size_t g_nodeCount;
+    static VicDerivedOp g_ops[MAX_VIC_DERIVED_OPS];
+    static size_t g_opCount;
+    static char g_buildError[128];
+};
+
+#endif
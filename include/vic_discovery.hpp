@@ -0,0 +1,56 @@
+#ifndef __H_VIC_DISCOVERY__
+#define __H_VIC_DISCOVERY__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "vic_hal.hpp"
+
+#define VIC_DISCOVERY_VERSION 2
+#define VIC_DISCOVERY_MAGIC_LEN 8
+#define VIC_DISCOVERY_REQUEST_LEN 17
+#define VIC_DISCOVERY_REPLY_V1_LEN 14
+#define VIC_DISCOVERY_REPLY_LEN 18
+
+// Replies kept from one broadcast
+#define MAX_VIC_BROKERS 4
+
+//
+// The broker discovery protocol, over UDP. Every field is big endian.
+//
+// Request, broadcast to the agents' port:
+//   magic (8), our IPv4 address (4), port to reply to (2),
+//   version (1), sequence number (2)
+// Reply, one per broker, sent to the address and port in the request:
+//   magic (8), broker IPv4 address (4), broker port (2),
+//   version (1), the request's sequence number (2), load (1)
+//
+// Version 1 was the first 14 bytes of each, so a version 1 agent can
+// still answer, and a version 1 reply is taken as load 0. The sequence
+// number ties a reply to its request, and so gives the round trip time.
+// Load is up to the agent, the reference one (tools/discovery_agent.py)
+// sends the broker's connected clients.
+//
+// Collects the replies to the latest request, for a VicBrokerLink to
+// hand to VicReconnect. Not thread safe, a link that gets replies on
+// another task locks around onReply() and take().
+//
+class VicDiscovery
+{
+public:
+    VicDiscovery();
+
+    // Starts a new request and forgets replies to earlier ones
+    size_t makeRequest(uint8_t *dest, const uint8_t *ip, uint16_t replyPort, uint32_t now_us);
+
+    // False if the packet isn't a reply to the latest request
+    bool onReply(const uint8_t *data, size_t len, uint32_t now_us);
+    bool take(VicBrokerOffer &offer);
+
+private:
+    uint16_t _seq;
+    uint32_t _sent_us;
+    VicBrokerOffer _offers[MAX_VIC_BROKERS];
+    size_t _count;
+};
+
+#endif
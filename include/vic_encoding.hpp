@@ -0,0 +1,69 @@
+#ifndef __H_VIC_ENCODING__
+#define __H_VIC_ENCODING__
+
+#include <ArduinoJson.h>
+#include "ve_direct_text.hpp"
+#include "vic_hal.hpp"
+
+#define MAX_VIC_KEY 50
+#define MAX_VIC_FORMATTED 100
+#define MAX_SCHEMA_DOC (JSON_OBJECT_SIZE(1) +           \
+                        JSON_ARRAY_SIZE(MAX_VIC_FIELDS) + \
+                        (MAX_VIC_FIELDS * JSON_ARRAY_SIZE(5)))
+
+#define VIC_BENCH_ITERATIONS 100
+
+enum VicEncodingFormat : uint8_t
+{
+    // {"value": "12.84", "units": "V"}, formatted, pretty printed
+    VIC_ENCODING_JSON,
+    // [fieldId, raw value] as MessagePack, units and scale are in the
+    // device's schema message
+    VIC_ENCODING_MSGPACK
+};
+
+//
+// Turns changed fields and registers into MQTT payloads, either per
+// field or collected into one state document per block.
+//
+// JSON state is an object keyed by the per-field topic names.
+// MessagePack state is {"f": [id, value, id, value...],
+// "r": [reg, "hex", ...]}, a field updated twice since the last block
+// appears twice and the last one wins.
+//
+// The schema lists every known field as
+// [id, key, units, decimals, type name], the value published for a
+// field is value / 10^decimals in units.
+//
+class VicEncoding
+{
+public:
+    static VicEncodingFormat formatFromName(const char *name);
+
+    static bool formatDelta(const VicDelta &delta,
+                            char *key, size_t sizeKey,
+                            char *value, size_t sizeValue,
+                            char *units, size_t sizeUnits);
+    static bool deltaKey(const VicDelta &delta, char *key, size_t sizeKey);
+    static bool fieldKey(uint8_t fieldId, char *key, size_t sizeKey);
+
+    static size_t encodeDelta(VicEncodingFormat format,
+                              const VicDelta &delta,
+                              char *dest, size_t size);
+
+    static void addToState(VicEncodingFormat format,
+                           JsonDocument &state,
+                           const VicDelta &delta);
+    static size_t encodeState(VicEncodingFormat format,
+                              JsonDocument &state,
+                              char *dest, size_t size);
+
+    // schema is cleared and used as scratch, at least MAX_SCHEMA_DOC
+    static size_t encodeSchema(VicEncodingFormat format,
+                               JsonDocument &schema,
+                               char *dest, size_t size);
+
+    static void benchmark(VicClock *clock, JsonDocument &result);
+};
+
+#endif
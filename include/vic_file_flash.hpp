@@ -0,0 +1,37 @@
+#ifndef __H_VIC_FILE_FLASH__
+#define __H_VIC_FILE_FLASH__
+
+#include <stdio.h>
+#include "vic_flash.hpp"
+
+//
+// File backed stand-in for a flash partition, with the same erase and
+// write semantics (writes AND into what is there). A new file starts
+// out erased. Counts erases so wear can be checked.
+//
+class VicFileFlash : public VicFlash
+{
+public:
+    VicFileFlash();
+    ~VicFileFlash();
+
+    bool open(const char *path, size_t size, size_t sectorSize);
+    void close();
+
+    size_t getSize() override;
+    size_t getSectorSize() override;
+
+    bool read(size_t offset, void *dest, size_t len) override;
+    bool write(size_t offset, const void *src, size_t len) override;
+    bool eraseSector(size_t offset) override;
+
+    uint32_t getErases();
+
+private:
+    FILE *_file;
+    size_t _size;
+    size_t _sectorSize;
+    uint32_t _erases;
+};
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef __H_VIC_FLASH__
+#define __H_VIC_FLASH__
+
+#include <stddef.h>
+#include <stdint.h>
+
+//
+// A region of NOR flash: erasing a sector sets it to 0xFF, writes can
+// only clear bits. Implemented on a flash partition on the board
+// (vic_partition_flash.hpp) and on a plain file on the host
+// (vic_file_flash.hpp) so the log on top can be run natively.
+//
+class VicFlash
+{
+public:
+    virtual ~VicFlash() {}
+
+    virtual size_t getSize() = 0;
+    virtual size_t getSectorSize() = 0;
+
+    virtual bool read(size_t offset, void *dest, size_t len) = 0;
+    virtual bool write(size_t offset, const void *src, size_t len) = 0;
+    virtual bool eraseSector(size_t offset) = 0;
+};
+
+#endif
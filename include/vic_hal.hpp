@@ -0,0 +1,98 @@
+#ifndef __H_VIC_HAL__
+#define __H_VIC_HAL__
+
+#include <stddef.h>
+#include <stdint.h>
+
+//
+// What the ingest and publishing code needs from the platform beyond
+// the serial ports (VEDirectSource) and the log's flash (VicFlash).
+// Implemented on the Arduino core for the board (vic_hal_arduino.hpp)
+// and on the C library for the "native" build (vic_hal_host.hpp), so the
+// same code can be run and profiled on a host.
+//
+
+// A file being read. read() and readBytes() are what ArduinoJson needs
+// of a custom reader, so a document can be deserialized straight from it.
+class VicFile
+{
+public:
+    virtual ~VicFile() {}
+
+    // Next byte, -1 at the end of the file
+    virtual int read() = 0;
+    virtual size_t readBytes(char *dest, size_t size) = 0;
+
+    virtual const char *name() = 0;
+};
+
+class VicClock
+{
+public:
+    virtual ~VicClock() {}
+
+    // Since boot
+    virtual uint32_t millis() = 0;
+    virtual uint32_t micros() = 0;
+
+    // Seconds since the epoch, small until the clock has been set
+    virtual uint32_t time() = 0;
+};
+
+// Where published messages go, the broker connection on the board
+class VicMqttSink
+{
+public:
+    virtual ~VicMqttSink() {}
+
+    virtual bool connected() = 0;
+    virtual bool publish(const char *topic, uint8_t qos, bool retain,
+                         const char *payload, size_t len) = 0;
+};
+
+struct VicBrokerAddr
+{
+    VicBrokerAddr();
+
+    bool isValid() const;
+    bool operator==(const VicBrokerAddr &other) const;
+
+    uint8_t ip[4];
+    uint16_t port;
+};
+
+// A broker that answered discovery, see vic_discovery.hpp
+struct VicBrokerOffer
+{
+    VicBrokerOffer();
+
+    VicBrokerAddr broker;
+    uint8_t version;
+    uint8_t load;
+    uint32_t rtt_us;
+};
+
+// Finding and reaching the broker. connect() and sendDiscovery() only
+// start things off, VicReconnect polls connected() and takeDiscovered()
+// for the outcome, so neither needs to call back across tasks.
+class VicBrokerLink
+{
+public:
+    virtual ~VicBrokerLink() {}
+
+    virtual bool connected() = 0;
+    virtual void connect(const VicBrokerAddr &broker) = 0;
+    virtual void disconnect() = 0;
+    // True once after a connection, or an attempt at one, has ended
+    virtual bool takeDropped() = 0;
+
+    // One discovery broadcast, replies are kept for takeDiscovered()
+    virtual void sendDiscovery() = 0;
+    virtual bool takeDiscovered(VicBrokerOffer &offer) = 0;
+
+    // The last broker connected to, kept across restarts
+    virtual bool loadBroker(VicBrokerAddr &broker) = 0;
+    virtual void saveBroker(const VicBrokerAddr &broker) = 0;
+};
+
+#endif
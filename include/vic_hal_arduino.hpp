@@ -0,0 +1,46 @@
+#ifndef __H_VIC_HAL_ARDUINO__
+#define __H_VIC_HAL_ARDUINO__
+
+#include <SPIFFS.h>
+#include <AsyncMqttClient.h>
+#include "vic_hal.hpp"
+
+//
+// The platform interfaces of vic_hal.hpp on the board
+//
+
+class VicSpiffsFile : public VicFile
+{
+public:
+    VicSpiffsFile(File file);
+
+    int read() override;
+    size_t readBytes(char *dest, size_t size) override;
+    const char *name() override;
+
+private:
+    File _file;
+};
+
+class VicArduinoClock : public VicClock
+{
+public:
+    uint32_t millis() override;
+    uint32_t micros() override;
+    uint32_t time() override;
+};
+
+class VicAsyncMqttSink : public VicMqttSink
+{
+public:
+    VicAsyncMqttSink(AsyncMqttClient *client);
+
+    bool connected() override;
+    bool publish(const char *topic, uint8_t qos, bool retain,
+                 const char *payload, size_t len) override;
+
+private:
+    AsyncMqttClient *_client;
+};
+
+#endif
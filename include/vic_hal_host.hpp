@@ -0,0 +1,89 @@
+#ifndef __H_VIC_HAL_HOST__
+#define __H_VIC_HAL_HOST__
+
+#include <stdio.h>
+#include "vic_hal.hpp"
+
+//
+// The platform interfaces of vic_hal.hpp on a host, for the "native"
+// build.
+//
+
+class VicStdioFile : public VicFile
+{
+public:
+    VicStdioFile();
+    ~VicStdioFile();
+
+    bool open(const char *path);
+    void close();
+
+    int read() override;
+    size_t readBytes(char *dest, size_t size) override;
+    const char *name() override;
+
+private:
+    FILE *_file;
+    const char *_name;
+};
+
+// Monotonic time since construction, and the system's wall clock
+class VicHostClock : public VicClock
+{
+public:
+    VicHostClock();
+
+    uint32_t millis() override;
+    uint32_t micros() override;
+    uint32_t time() override;
+
+private:
+    uint64_t nowMicros();
+
+private:
+    uint64_t _start;
+};
+
+// Time that only moves when told to, for replaying captures faster
+// than real time. time() is start plus the elapsed seconds.
+class VicManualClock : public VicClock
+{
+public:
+    VicManualClock(uint32_t start);
+
+    void advance(uint32_t ms);
+
+    uint32_t millis() override;
+    uint32_t micros() override;
+    uint32_t time() override;
+
+private:
+    uint32_t _start;
+    uint64_t _micros;
+};
+
+// Writes each message as a line of "topic payload" to out, binary
+// payloads as hex, or just counts them if out is null. Starts out
+// connected.
+class VicPrintMqttSink : public VicMqttSink
+{
+public:
+    VicPrintMqttSink(FILE *out);
+
+    void setConnected(bool connected);
+
+    bool connected() override;
+    bool publish(const char *topic, uint8_t qos, bool retain,
+                 const char *payload, size_t len) override;
+
+    uint32_t getPublishes();
+    uint32_t getBytes();
+
+private:
+    FILE *_out;
+    bool _connected;
+    uint32_t _publishes;
+    uint32_t _bytes;
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef __H_VIC_PARTITION_FLASH__
+#define __H_VIC_PARTITION_FLASH__
+
+#include <esp_partition.h>
+#include "vic_flash.hpp"
+
+//
+// A data partition of the board's flash, found by its label in
+// partitions.csv
+//
+class VicPartitionFlash : public VicFlash
+{
+public:
+    VicPartitionFlash();
+
+    bool begin(const char *label);
+
+    size_t getSize() override;
+    size_t getSectorSize() override;
+
+    bool read(size_t offset, void *dest, size_t len) override;
+    bool write(size_t offset, const void *src, size_t len) override;
+    bool eraseSector(size_t offset) override;
+
+private:
+    const esp_partition_t *_partition;
+};
+
+#endif
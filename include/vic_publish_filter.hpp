@@ -0,0 +1,66 @@
+#ifndef __H_VIC_PUBLISH_FILTER__
+#define __H_VIC_PUBLISH_FILTER__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <ArduinoJson.h>
+#include "victron_defs.hpp"
+#include "ve_direct_text.hpp"
+
+#define MAX_VIC_DEVICE_POLICIES 8
+
+// VicFilterSlot flags
+#define VIC_FILTER_SEEN 0x01
+#define VIC_FILTER_PUBLISHED 0x02
+
+struct VicFilterSlot
+{
+    VicFilterSlot();
+
+    int32_t latest;
+    int32_t published;
+    uint32_t publishedMillis;
+    uint8_t flags;
+};
+
+//
+// Applies the per-field publish policies (see VicPolicy) to one
+// device's changes on the publisher side. offer() every delta as it
+// comes off the queue and publish it only if offer() says so. Call
+// nextDue() periodically to pick up changes that were held back by
+// minInterval and heartbeats that are due.
+//
+// Only numeric fields are filtered. Text fields, registers and block
+// markers always pass and never heartbeat.
+//
+// Policies come from the field definitions unless this device has its
+// own, see loadPolicies().
+//
+class VicPublishFilter
+{
+public:
+    VicPublishFilter();
+
+    bool offer(const VicDelta &delta, uint32_t now_ms);
+    int nextDue(int fieldId, uint32_t now_ms, VicDelta *delta);
+    void reset();
+
+    bool setPolicy(uint8_t fieldId, const VicPolicy &policy);
+    bool loadPolicies(JsonObject policies);
+
+    uint32_t getSuppressed();
+
+private:
+    bool isFiltered(uint8_t fieldId);
+    const VicPolicy *getPolicy(uint8_t fieldId);
+    bool isDue(uint8_t fieldId, uint32_t now_ms);
+    void markPublished(uint8_t fieldId, uint32_t now_ms);
+
+private:
+    VicFilterSlot _slots[MAX_VIC_FIELDS];
+    VicPolicyOverride _policies[MAX_VIC_DEVICE_POLICIES];
+    size_t _policyCount;
+    uint32_t _suppressed;
+};
+
+#endif
@@ -0,0 +1,169 @@
+#ifndef __H_VIC_PUBLISHER__
+#define __H_VIC_PUBLISHER__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <ArduinoJson.h>
+#include "ve_direct_source.hpp"
+#include "ve_direct_text.hpp"
+#include "vic_encoding.hpp"
+#include "vic_publish_filter.hpp"
+#include "vic_aggregator.hpp"
+#include "vic_ring_log.hpp"
+#include "vic_series.hpp"
+#include "vic_topic_table.hpp"
+#include "vic_hal.hpp"
+
+#define MAX_VIC_INPUTS 8
+#define MAX_VIC_BASE 256
+
+#define MAX_READ 128
+// How long a reader with changes the queue had no room for waits for
+// bytes before trying the queue again
+#define VIC_QUEUE_RETRY_MS 10
+#define MAX_STATE_DOC 4096
+#define MAX_STATE_JSON 2048
+#define MAX_SCHEMA 4096
+#define MAX_AGG_DOC 8192
+#define MAX_AGG_JSON 6144
+#define MAX_REPLAY 64
+#define MAX_REPLAY_DOC (JSON_ARRAY_SIZE(MAX_REPLAY) + (MAX_REPLAY * JSON_ARRAY_SIZE(3)))
+#define MAX_REPLAY_JSON 2048
+#define MAX_REPLAY_SERIES 512
+// Worst case 9 bytes a sample, plus a field ID, length and count per series
+#define MAX_SERIES_PAYLOAD ((MAX_REPLAY_SERIES * 9) + (256 * (3 + VIC_SERIES_HEADER)))
+
+// Scratch shared by everything the publisher sends, one message at a time
+#define MAX_VIC_TOPIC (MAX_VIC_BASE + 64)
+#define MAX_VIC_PAYLOAD MAX_AGG_JSON
+#define MAX_SCRATCH_DOC MAX_AGG_DOC
+
+static_assert((MAX_STATE_JSON <= MAX_VIC_PAYLOAD) &&
+                  (MAX_SCHEMA <= MAX_VIC_PAYLOAD) &&
+                  (MAX_REPLAY_JSON <= MAX_VIC_PAYLOAD) &&
+                  (MAX_SERIES_PAYLOAD <= MAX_VIC_PAYLOAD),
+              "Every payload must fit the shared payload buffer");
+static_assert((MAX_REPLAY_DOC <= MAX_SCRATCH_DOC) &&
+                  (MAX_SCHEMA_DOC <= MAX_SCRATCH_DOC),
+              "Replay rows and schemas must fit the shared document");
+
+// Topic base for the board's own values
+#define VIC_BOARD_BASE "pmcg-esp32"
+
+// One VE.Direct device. A reader owns the source and the processor and
+// pushes changes onto the queue, the publisher drains the queue and owns
+// the rest.
+struct VicInput
+{
+    VicInput();
+
+    char mqttBase[MAX_VIC_BASE];
+    VEDirectSource *source;
+    VEDirectText processor; // Reader only
+    VicDeltaQueue queue;
+    StaticJsonDocument<MAX_STATE_DOC> state; // Publisher only, batched mode
+    VicPublishFilter filter;                 // Publisher only
+    VicAggregator aggregator;                // Publisher only
+    VicTopicTable topics;                    // Publisher only, built by begin()
+    const uint16_t *pollRegisters;
+    size_t pollCount;
+    std::atomic<bool> resendText; // Set by the publisher, taken by the reader
+};
+
+// See the README for the matching config.json settings
+struct VicPublishOptions
+{
+    VicPublishOptions();
+
+    // One message per device per validated text block on <base>/state
+    // instead of one message per changed field
+    bool batch;
+    VicEncodingFormat encoding;
+    // Only publish aggregates when false
+    bool raw;
+    // Aggregation windows in seconds, published on <base>/agg/<window>s
+    uint16_t windows[MAX_VIC_WINDOWS];
+    size_t windowCount;
+    // Backlog records replayed per second, and whether series encoded
+    uint16_t replayRate;
+    bool backlogSeries;
+};
+
+//
+// Everything between the devices' change queues and the broker:
+// per-field or batched publishing, publish policies, aggregates, the
+// offline log and its replay, schemas and stats. poll() does one pass
+// and never waits, call it every few ms from one task.
+//
+// Nothing is allocated while running. Each device's batched state is a
+// fixed document in its VicInput, cleared after every block. Topics come
+// ready made from each device's VicTopicTable, and messages are built
+// one at a time in one payload buffer and one scratch document owned by
+// the publisher.
+//
+// Only talks to the platform through vic_hal.hpp, so the whole path from
+// bytes in to messages out runs on a host too.
+//
+class VicPublisher
+{
+public:
+    // Reader side, one call per burst of bytes from the input's source.
+    // Returns the number of bytes handled. Changes the queue has no room
+    // for stay with the processor and go on a later call.
+    static size_t readInput(VicInput &input, uint32_t wait_ms);
+    static void pollHex(VicInput &input);
+
+public:
+    VicPublisher(VicMqttSink *mqtt, VicClock *clock, VicRingLog *log);
+
+    void begin(VicInput *const *inputs, size_t inputCount,
+               const VicPublishOptions &options);
+    void poll();
+
+    // For values from elsewhere (the board's sensors) that couldn't be
+    // published because the broker is away
+    void logValue(uint8_t device, uint8_t fieldId, int32_t value);
+
+private:
+    void drain(int device);
+    void publishDelta(VicInput &input, const VicDelta &delta);
+    void addToState(VicInput &input, const VicDelta &delta);
+    void publishState(VicInput &input);
+    void publishSchemas();
+    void publishStats();
+    void doPolicies();
+    void doAggregates();
+    void doReplay();
+
+    void logDelta(int device, const VicDelta &delta);
+    void logTime(uint32_t *time, uint8_t *flags);
+
+    const char *getTopic(VicInput &input, VicTopic topic);
+
+    size_t encodeReplayRows(size_t count, uint8_t logDevice);
+    size_t encodeReplaySeries(size_t count, uint8_t logDevice);
+
+private:
+    VicMqttSink *_mqtt;
+    VicClock *_clock;
+    VicRingLog *_log;
+
+    VicInput *const *_inputs;
+    size_t _inputCount;
+    VicPublishOptions _options;
+
+    bool _wasConnected;
+    uint32_t _nextStatsMillis;
+    uint32_t _nextPolicyMillis;
+    uint32_t _nextLogFlushMillis;
+    uint32_t _nextReplayMillis;
+
+    char _topic[MAX_VIC_TOPIC];
+    char _payload[MAX_VIC_PAYLOAD];
+    StaticJsonDocument<MAX_SCRATCH_DOC> _scratch;
+    VicLogRecord _records[MAX_REPLAY_SERIES];
+    bool _replayed[MAX_REPLAY_SERIES];
+};
+
+#endif
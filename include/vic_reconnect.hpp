@@ -0,0 +1,109 @@
+#ifndef __H_VIC_RECONNECT__
+#define __H_VIC_RECONNECT__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "vic_hal.hpp"
+#include "vic_discovery.hpp"
+
+// How long a connect or a discovery broadcast gets before it counts as
+// failed, unless the link reports it refused sooner, and the range of
+// the backoff between rounds
+#define VIC_CONNECT_TIMEOUT_MS 5000
+#define VIC_DISCOVERY_TIMEOUT_MS 2000
+#define VIC_BACKOFF_MIN_MS 1000
+#define VIC_BACKOFF_MAX_MS 60000
+
+// Once the first broker has answered, how long the others get
+#define VIC_DISCOVERY_WINDOW_MS 250
+// A broker's score is its round trip in ms plus this much per unit of
+// load, the lowest is tried first
+#define VIC_LOAD_WEIGHT_MS 10
+
+enum VicReconnectState : uint8_t
+{
+    VIC_RECONNECT_CONNECTED,
+    VIC_RECONNECT_CONNECTING, // To one of the known brokers
+    VIC_RECONNECT_DISCOVERY,  // Collecting discovery replies
+    VIC_RECONNECT_BACKOFF
+};
+
+// Since boot, all times in ms
+struct VicReconnectStats
+{
+    VicReconnectStats();
+
+    uint32_t connects;
+    uint32_t attempts;    // Connects tried, including failed ones
+    uint32_t discoveries; // Broadcasts sent
+    uint32_t last_ms;     // Disconnect (or boot) to connected
+    uint32_t max_ms;
+    bool cached;          // Connected without a new discovery
+};
+
+//
+// Keeps the board connected to a broker. It knows up to MAX_VIC_BROKERS
+// of them: the one it last reached, kept in the link's store, and then
+// whoever answered the latest discovery broadcast, best score first.
+//
+// Each round tries the known brokers in turn, then broadcasts discovery
+// and tries whoever answers, best first. A round that fails waits before
+// the next, doubling from VIC_BACKOFF_MIN_MS up to VIC_BACKOFF_MAX_MS,
+// randomised by up to half so a room full of boards doesn't retry in
+// step after a broker restart.
+//
+// A lost connection fails over to the next known broker at once, without
+// a broadcast, and comes back round to the one that went away last.
+//
+// poll() never waits, call it every few ms. It returns true once each
+// time a connection is made, when getStats() has the time it took and
+// getBroker() the broker.
+//
+class VicReconnect
+{
+public:
+    VicReconnect(VicBrokerLink *link, VicClock *clock);
+
+    void begin();
+    bool poll();
+
+    VicReconnectState getState();
+    const VicReconnectStats &getStats();
+    const VicBrokerOffer &getBroker();
+    size_t getBrokerCount();
+
+    static uint32_t score(const VicBrokerOffer &offer);
+
+private:
+    void startRound(size_t first);
+    void tryNext();
+    void discover();
+    void collect(uint32_t now);
+    void backoff();
+    uint32_t random();
+
+private:
+    VicBrokerLink *_link;
+    VicClock *_clock;
+    VicReconnectState _state;
+
+    VicBrokerOffer _brokers[MAX_VIC_BROKERS];
+    size_t _brokerCount;
+    size_t _current;
+    size_t _first;
+    size_t _tries;
+    bool _discovered; // This round
+
+    VicBrokerOffer _offers[MAX_VIC_BROKERS];
+    size_t _offerCount;
+    uint32_t _firstOfferMillis;
+
+    uint32_t _stateMillis;
+    uint32_t _downMillis;
+    uint32_t _backoff_ms;
+    uint32_t _wait_ms;
+    uint32_t _random;
+    VicReconnectStats _stats;
+};
+
+#endif
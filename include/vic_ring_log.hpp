@@ -0,0 +1,92 @@
+#ifndef __H_VIC_RING_LOG__
+#define __H_VIC_RING_LOG__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "vic_flash.hpp"
+
+#define VIC_LOG_BATCH 32
+#define VIC_LOG_MARK_EVERY 256
+
+// VicLogRecord device for the board's own sensors, and their field IDs
+#define VIC_LOG_BOARD 0xff
+#define VIC_LOG_TEMPERATURE 0
+#define VIC_LOG_HUMIDITY 1
+
+// VicLogRecord flags
+#define VIC_LOG_UPTIME 0x01 // time is seconds since boot, the clock wasn't set
+#define VIC_LOG_MARK 0x02   // Replayed through seq value, not data
+
+#define VIC_LOG_ERASED 0xffffffff
+
+// One logged value, 16 bytes so a 4 KB sector holds 256. seq numbers
+// every slot ever written, so slot = seq mod the number of slots.
+struct VicLogRecord
+{
+    uint32_t seq;
+    uint32_t time;
+    int32_t value;
+    uint8_t device;
+    uint8_t fieldId;
+    uint8_t flags;
+    uint8_t check;
+};
+
+static_assert(sizeof(VicLogRecord) == 16, "VicLogRecord must stay 16 bytes");
+
+//
+// Append-only ring of VicLogRecords in a flash region, for values that
+// couldn't be published while the broker was away.
+//
+// Records are buffered in RAM and written VIC_LOG_BATCH at a time. A
+// sector is erased only when the head wraps onto it, dropping the oldest
+// records, so every sector sees one erase per lap of the ring.
+//
+// How far the backlog has been replayed is kept in the log itself as
+// VIC_LOG_MARK records, written at the end of each replay and every
+// VIC_LOG_MARK_EVERY records, so a reboot resumes where replay left off
+// instead of starting over. mount() finds the head from the first record
+// of each sector and the replay position from the last mark.
+//
+class VicRingLog
+{
+public:
+    VicRingLog(VicFlash *flash);
+
+    bool mount();
+    bool isMounted();
+
+    bool append(uint8_t device, uint8_t fieldId, int32_t value,
+                uint32_t time, uint8_t flags);
+    bool flush();
+
+    bool hasBacklog();
+    uint32_t getBacklog();
+    size_t readNext(VicLogRecord *dest, size_t max);
+    void markReplayed();
+
+    uint32_t getDropped();
+
+private:
+    static uint8_t checkOf(const VicLogRecord &record);
+    static bool isValid(const VicLogRecord &record);
+
+    size_t offsetOf(uint32_t seq);
+    uint32_t oldestSeq();
+    bool readRecord(uint32_t seq, VicLogRecord *dest);
+    bool appendRecord(const VicLogRecord &record);
+
+private:
+    VicFlash *_flash;
+    bool _mounted;
+    uint32_t _slots;
+    uint32_t _slotsPerSector;
+    uint32_t _headSeq; // Next seq to write to flash
+    uint32_t _tailSeq; // Next seq to replay
+    uint32_t _sinceMark;
+    uint32_t _dropped;
+    VicLogRecord _pending[VIC_LOG_BATCH];
+    size_t _pendingCount;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef __H_VIC_SERIES__
+#define __H_VIC_SERIES__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define VIC_SERIES_HEADER 2
+
+//
+// Compact encoding for a time series of one field's raw integer values
+// (mV, mA, W...), after Facebook's Gorilla. A stream is a 16 bit sample
+// count, LSB first, then a bit stream, MSB first:
+//
+// The first sample is its time in 32 bits and its value in 32 bits.
+//
+// Every later time is stored as the change in the time step (delta of
+// delta), so a steady 1 Hz series costs one bit per sample:
+//   0                  unchanged
+//   10   + 7 bits      -63..64
+//   110  + 9 bits      -255..256
+//   1110 + 12 bits     -2047..2048
+//   1111 + 32 bits     anything else
+//
+// Every later value is stored as the zigzagged change from the previous
+// value:
+//   0                  unchanged
+//   10   + 6 bits      zigzag < 64
+//   110  + 13 bits     zigzag < 8192
+//   1110 + 20 bits     zigzag < 1048576
+//   1111 + 32 bits     anything else
+//
+class VicSeriesEncoder
+{
+public:
+    VicSeriesEncoder(uint8_t *dest, size_t size);
+
+    bool add(uint32_t time, int32_t value);
+    size_t finish();
+
+    uint16_t getCount();
+
+private:
+    bool writeBits(uint32_t bits, uint8_t count);
+    bool writeTime(uint32_t time);
+    bool writeValue(int32_t value);
+
+private:
+    uint8_t *_dest;
+    size_t _size;
+    size_t _bitPos;
+    uint16_t _count;
+    uint32_t _prevTime;
+    int64_t _prevDelta;
+    int32_t _prevValue;
+};
+
+class VicSeriesDecoder
+{
+public:
+    VicSeriesDecoder(const uint8_t *src, size_t len);
+
+    uint16_t getCount();
+    bool next(uint32_t *time, int32_t *value);
+
+private:
+    bool readBits(uint8_t count, uint32_t *bits);
+    bool readPrefix(uint8_t max, uint8_t *ones);
+
+private:
+    const uint8_t *_src;
+    size_t _len;
+    size_t _bitPos;
+    uint16_t _count;
+    uint16_t _read;
+    uint32_t _prevTime;
+    int64_t _prevDelta;
+    int32_t _prevValue;
+};
+
+#endif
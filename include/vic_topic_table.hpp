@@ -0,0 +1,55 @@
+#ifndef __H_VIC_TOPIC_TABLE__
+#define __H_VIC_TOPIC_TABLE__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "victron_defs.hpp"
+
+// Offset of a field with no topic
+#define VIC_TOPIC_NONE 0xffff
+
+// A device's topics that aren't per field, relative to its base
+enum VicTopic : uint8_t
+{
+    VIC_TOPIC_STATE,
+    VIC_TOPIC_SCHEMA,
+    VIC_TOPIC_BLOCKS,
+    VIC_TOPIC_QUEUE,
+    VIC_TOPIC_BACKLOG,
+    VIC_TOPIC_BACKLOG_SERIES,
+    VIC_TOPIC_COUNT
+};
+
+//
+// Every full topic one device publishes on, <base>/<key> for each field
+// plus the fixed ones above, built once into a single pool after the
+// field definitions and config are loaded. Publishing is then a lookup
+// by field ID that hands back a ready, NUL-terminated topic.
+//
+// Register topics depend on what the device answers, so they are still
+// formatted per message.
+//
+class VicTopicTable
+{
+public:
+    VicTopicTable();
+    ~VicTopicTable();
+
+    // Rebuilds the table, call again if fields are added later
+    bool build(const char *base);
+
+    // 0 if the table isn't built or there is no such field
+    const char *getField(uint8_t fieldId) const;
+    const char *getTopic(VicTopic topic) const;
+    size_t getPoolSize() const;
+
+    static const char *getSuffix(VicTopic topic);
+
+private:
+    char *_pool;
+    size_t _poolSize;
+    uint16_t _fields[MAX_VIC_FIELDS];
+    uint16_t _topics[VIC_TOPIC_COUNT];
+};
+
+#endif
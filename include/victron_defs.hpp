@@ -0,0 +1,200 @@
+#ifndef __H_VICTRON_DEFS__
+#define __H_VICTRON_DEFS__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "victron_fields.hpp"
+
+#define MAX_VIC_EXTRA_FIELDS 16
+#define MAX_VIC_FIELDNAME 16
+#define MAX_VIC_FIELDS (VIC_NUM_FIELDS + MAX_VIC_EXTRA_FIELDS)
+#define MAX_VIC_POLICY_OVERRIDES 16
+#define MAX_VIC_EXPR 48
+#define MAX_VIC_EXPR_OVERRIDES 8
+// Worst case size of saveOverrides()
+#define MAX_VIC_OVERRIDES_BLOB (8 + 10 + (MAX_VIC_EXTRA_FIELDS * (1 + MAX_VIC_FIELDNAME + 1)) + \
+                                (MAX_VIC_POLICY_OVERRIDES * (1 + 10)) +                  \
+                                (MAX_VIC_EXPR_OVERRIDES * (2 + MAX_VIC_EXPR)))
+
+enum VicType : uint8_t
+{
+    VIC_TYPE_UNKNOWN,
+    VIC_TYPE_PCT,
+    VIC_TYPE_PCT_TENTH,
+    VIC_TYPE_VOLT_CENTI,
+    VIC_TYPE_KWH_CENTI,
+    VIC_TYPE_AMP_TENTH,
+    VIC_TYPE_WATT,
+    VIC_TYPE_VA,
+    VIC_TYPE_COUNTER,
+    VIC_TYPE_DEG_C,
+    VIC_TYPE_FW,
+    VIC_TYPE_FWE,
+    VIC_TYPE_MA,
+    VIC_TYPE_MAH,
+    VIC_TYPE_MV,
+    VIC_TYPE_MAP_AR,
+    VIC_TYPE_MAP_OR,
+    VIC_TYPE_MAP_CS,
+    VIC_TYPE_MAP_ERR,
+    VIC_TYPE_MAP_MODE,
+    VIC_TYPE_MAP_MPPT,
+    VIC_TYPE_MAP_PID,
+    VIC_TYPE_MINUTES,
+    VIC_TYPE_ONOFF,
+    VIC_TYPE_DAY_SEQ,
+    VIC_TYPE_SECONDS,
+    VIC_TYPE_SERIAL,
+    VIC_TYPE_STRING,
+
+    VIC_NUM_TYPES
+};
+
+enum VicMapId : uint8_t
+{
+    VIC_MAP_AR,
+    VIC_MAP_OR,
+    VIC_MAP_PID,
+    VIC_MAP_CS,
+    VIC_MAP_ERR,
+    VIC_MAP_MODE,
+    VIC_MAP_MPPT,
+
+    VIC_NUM_MAPS
+};
+
+struct VicFieldDef
+{
+    const char *name; // Label as sent by the device
+    const char *key;  // Lower case name used for MQTT
+    VicType type;
+    uint8_t id;
+};
+
+struct VicMapEntry
+{
+    int32_t key;
+    const char *value;
+};
+
+struct VicMap
+{
+    const VicMapEntry *entries;
+    size_t count;
+};
+
+struct VicTypeName
+{
+    const char *name;
+    VicType type;
+};
+
+// What a stored integer means, value / 10^decimals in units. Derived
+// fields are computed in base units (V, A, W, Wh, Ah, %, s), value * base.
+struct VicTypeScale
+{
+    const char *units;
+    uint8_t decimals;
+    float base;
+};
+
+// A field computed from others, see vic_derived.hpp
+struct VicDerivedExpr
+{
+    uint8_t fieldId;
+    const char *expr;
+};
+
+// When a changed numeric field is published. A change is sent once it
+// is more than max(deadband, deadbandPct of the last sent value) away
+// from the last sent value and at least minInterval has passed. After
+// maxInterval the current value is sent even if it hasn't changed.
+// All zero publishes every change and nothing else.
+struct VicPolicy
+{
+    int32_t deadband;          // In the field's stored units
+    uint16_t deadbandPctTenth; // 0.1 %
+    uint16_t minInterval_s;
+    uint16_t maxInterval_s; // 0 for no heartbeat
+};
+
+struct VicPolicyOverride
+{
+    VicPolicyOverride();
+
+    uint8_t fieldId;
+    VicPolicy policy;
+};
+
+struct VicExprOverride
+{
+    VicExprOverride();
+
+    uint8_t fieldId;
+    char expr[MAX_VIC_EXPR]; // Empty for a field no longer derived
+};
+
+struct VicExtraField
+{
+    VicExtraField();
+
+    char name[MAX_VIC_FIELDNAME];
+    char key[MAX_VIC_FIELDNAME];
+    VicFieldDef def;
+};
+
+//
+// Field and map definitions, compiled from defs/victron_data_def.json
+// by tools/gen_victron_defs.py. Fields can be retyped or added at
+// runtime with addField(), e.g. from an override file on SPIFFS.
+//
+class VictronDefs
+{
+public:
+    static const VicFieldDef *findField(const char *name);
+    static const VicFieldDef *lookupField(const char *nameOrKey);
+    static const VicFieldDef *getField(uint8_t id);
+    static size_t getFieldCount();
+
+    static bool isTextType(VicType type);
+    static bool isMeasurementType(VicType type);
+
+    static const VicMap *getMap(VicMapId map);
+    static const char *lookupMap(VicMapId map, int32_t key);
+
+    static VicType typeFromName(const char *typeName);
+    static const char *typeName(VicType type);
+    static const VicTypeScale *getTypeScale(VicType type);
+
+    static bool addField(const char *name, VicType type);
+
+    static const VicPolicy *getPolicy(uint8_t id);
+    static bool setPolicy(const char *name, const VicPolicy &policy);
+    // For fields added at runtime and compiled fields without a policy
+    // of their own
+    static const VicPolicy *getDefaultPolicy();
+    static void setDefaultPolicy(const VicPolicy &policy);
+    static bool samePolicy(const VicPolicy &a, const VicPolicy &b);
+
+    // Expression a field is derived from, 0 if it isn't
+    static const char *getExpr(uint8_t id);
+    static bool setExpr(const char *name, const char *expr);
+
+    // Runtime additions and policy and expression overrides in a compact
+    // binary form, so they can be cached and restored without the JSON
+    // they came from. loadOverrides() replaces the current ones, false if
+    // the data is from different compiled definitions.
+    static size_t saveOverrides(uint8_t *dest, size_t size);
+    static bool loadOverrides(const uint8_t *data, size_t len);
+
+private:
+    static VicExtraField g_extraFields[MAX_VIC_EXTRA_FIELDS];
+    static size_t g_extraFieldCount;
+    static VicPolicyOverride g_policyOverrides[MAX_VIC_POLICY_OVERRIDES];
+    static size_t g_policyOverrideCount;
+    static VicPolicy g_defaultPolicy;
+    static VicExprOverride g_exprOverrides[MAX_VIC_EXPR_OVERRIDES];
+    static size_t g_exprOverrideCount;
+};
+
+#endif
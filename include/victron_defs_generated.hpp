@@ -0,0 +1,412 @@
+// Generated by tools/gen_victron_defs.py from defs/victron_data_def.json.
+// Do not edit by hand, edit the definitions file and rebuild.
+
+#ifndef __H_VICTRON_DEFS_GENERATED__
+#define __H_VICTRON_DEFS_GENERATED__
+
+#include "victron_defs.hpp"
+
+// Indexed by VicFieldId
+static constexpr VicFieldDef g_vicFieldDefs[] = {
+    {"AC_OUT_I", "ac_out_i", VIC_TYPE_AMP_TENTH, VIC_FIELD_AC_OUT_I},
+    {"AC_OUT_S", "ac_out_s", VIC_TYPE_VA, VIC_FIELD_AC_OUT_S},
+    {"AC_OUT_V", "ac_out_v", VIC_TYPE_VOLT_CENTI, VIC_FIELD_AC_OUT_V},
+    {"AR", "ar", VIC_TYPE_MAP_AR, VIC_FIELD_AR},
+    {"Alarm", "alarm", VIC_TYPE_ONOFF, VIC_FIELD_ALARM},
+    {"BMV", "bmv", VIC_TYPE_STRING, VIC_FIELD_BMV},
+    {"CE", "ce", VIC_TYPE_MAH, VIC_FIELD_CE},
+    {"CS", "cs", VIC_TYPE_MAP_CS, VIC_FIELD_CS},
+    {"DM", "dm", VIC_TYPE_PCT, VIC_FIELD_DM},
+    {"ERR", "err", VIC_TYPE_MAP_ERR, VIC_FIELD_ERR},
+    {"FW", "fw", VIC_TYPE_FW, VIC_FIELD_FW},
+    {"FWE", "fwe", VIC_TYPE_FWE, VIC_FIELD_FWE},
+    {"H1", "h1", VIC_TYPE_MAH, VIC_FIELD_H1},
+    {"H10", "h10", VIC_TYPE_COUNTER, VIC_FIELD_H10},
+    {"H11", "h11", VIC_TYPE_COUNTER, VIC_FIELD_H11},
+    {"H12", "h12", VIC_TYPE_COUNTER, VIC_FIELD_H12},
+    {"H13", "h13", VIC_TYPE_COUNTER, VIC_FIELD_H13},
+    {"H14", "h14", VIC_TYPE_COUNTER, VIC_FIELD_H14},
+    {"H15", "h15", VIC_TYPE_MV, VIC_FIELD_H15},
+    {"H16", "h16", VIC_TYPE_MV, VIC_FIELD_H16},
+    {"H17", "h17", VIC_TYPE_KWH_CENTI, VIC_FIELD_H17},
+    {"H18", "h18", VIC_TYPE_KWH_CENTI, VIC_FIELD_H18},
+    {"H19", "h19", VIC_TYPE_KWH_CENTI, VIC_FIELD_H19},
+    {"H2", "h2", VIC_TYPE_MAH, VIC_FIELD_H2},
+    {"H20", "h20", VIC_TYPE_KWH_CENTI, VIC_FIELD_H20},
+    {"H21", "h21", VIC_TYPE_WATT, VIC_FIELD_H21},
+    {"H22", "h22", VIC_TYPE_KWH_CENTI, VIC_FIELD_H22},
+    {"H23", "h23", VIC_TYPE_WATT, VIC_FIELD_H23},
+    {"H3", "h3", VIC_TYPE_MAH, VIC_FIELD_H3},
+    {"H4", "h4", VIC_TYPE_COUNTER, VIC_FIELD_H4},
+    {"H5", "h5", VIC_TYPE_COUNTER, VIC_FIELD_H5},
+    {"H6", "h6", VIC_TYPE_MAH, VIC_FIELD_H6},
+    {"H7", "h7", VIC_TYPE_MV, VIC_FIELD_H7},
+    {"H8", "h8", VIC_TYPE_MV, VIC_FIELD_H8},
+    {"H9", "h9", VIC_TYPE_SECONDS, VIC_FIELD_H9},
+    {"HSDS", "hsds", VIC_TYPE_DAY_SEQ, VIC_FIELD_HSDS},
+    {"I", "i", VIC_TYPE_MA, VIC_FIELD_I},
+    {"I2", "i2", VIC_TYPE_MA, VIC_FIELD_I2},
+    {"I3", "i3", VIC_TYPE_MA, VIC_FIELD_I3},
+    {"IL", "il", VIC_TYPE_MA, VIC_FIELD_IL},
+    {"LOAD", "load", VIC_TYPE_ONOFF, VIC_FIELD_LOAD},
+    {"MODE", "mode", VIC_TYPE_MAP_MODE, VIC_FIELD_MODE},
+    {"MPPT", "mppt", VIC_TYPE_MAP_MPPT, VIC_FIELD_MPPT},
+    {"OR", "or", VIC_TYPE_MAP_OR, VIC_FIELD_OR},
+    {"P", "p", VIC_TYPE_WATT, VIC_FIELD_P},
+    {"PID", "pid", VIC_TYPE_MAP_PID, VIC_FIELD_PID},
+    {"PPV", "ppv", VIC_TYPE_WATT, VIC_FIELD_PPV},
+    {"Relay", "relay", VIC_TYPE_ONOFF, VIC_FIELD_RELAY},
+    {"SER#", "ser#", VIC_TYPE_SERIAL, VIC_FIELD_SERNUM},
+    {"SOC", "soc", VIC_TYPE_PCT_TENTH, VIC_FIELD_SOC},
+    {"T", "t", VIC_TYPE_DEG_C, VIC_FIELD_T},
+    {"TTG", "ttg", VIC_TYPE_MINUTES, VIC_FIELD_TTG},
+    {"V", "v", VIC_TYPE_MV, VIC_FIELD_V},
+    {"V2", "v2", VIC_TYPE_MV, VIC_FIELD_V2},
+    {"V3", "v3", VIC_TYPE_MV, VIC_FIELD_V3},
+    {"VM", "vm", VIC_TYPE_MV, VIC_FIELD_VM},
+    {"VPV", "vpv", VIC_TYPE_MV, VIC_FIELD_VPV},
+    {"VS", "vs", VIC_TYPE_MV, VIC_FIELD_VS},
+    {"WARN", "warn", VIC_TYPE_MAP_AR, VIC_FIELD_WARN},
+    {"ipv", "ipv", VIC_TYPE_MA, VIC_FIELD_IPV},
+    {"eff", "eff", VIC_TYPE_PCT, VIC_FIELD_EFF},
+};
+
+static constexpr VicMapEntry g_vic_map_ar[] = {
+    {1, "Low Voltage"},
+    {2, "High Voltage"},
+    {4, "Low SOC"},
+    {8, "Low Starter Voltage"},
+    {16, "High Starter Voltage"},
+    {32, "Low Temperature"},
+    {64, "High Temperature"},
+    {128, "Mid Voltage"},
+    {256, "Overload"},
+    {512, "DC Ripple"},
+    {1024, "Low V AC Out"},
+    {2048, "High V AC Out"},
+    {4096, "Short Circuit"},
+    {8192, "BMS Lockout"},
+};
+
+static constexpr VicMapEntry g_vic_map_or[] = {
+    {1, "No input power"},
+    {2, "Switched off (power switch)"},
+    {4, "Switched off (device mode register)"},
+    {8, "Remote input"},
+    {16, "Protection active"},
+    {32, "Paygo"},
+    {64, "BMS"},
+    {128, "Engine shutdown detection"},
+    {256, "Analysing input voltage"},
+};
+
+static constexpr VicMapEntry g_vic_map_pid[] = {
+    {512, "BMV-600S"},
+    {513, "BMV-602S"},
+    {514, "BMV-600HS"},
+    {515, "BMV-700"},
+    {516, "BMV-702"},
+    {517, "BMV-700H"},
+    {768, "BlueSolar MPPT 70|15"},
+    {41024, "BlueSolar MPPT 75|50"},
+    {41025, "BlueSolar MPPT 150|35"},
+    {41026, "BlueSolar MPPT 75|15"},
+    {41027, "BlueSolar MPPT 100|15"},
+    {41028, "BlueSolar MPPT 100|30"},
+    {41029, "BlueSolar MPPT 100|50"},
+    {41030, "BlueSolar MPPT 150|70"},
+    {41031, "BlueSolar MPPT 150|100"},
+    {41033, "BlueSolar MPPT 100|50 rev2"},
+    {41034, "BlueSolar MPPT 100|30 rev2"},
+    {41035, "BlueSolar MPPT 150|35 rev2"},
+    {41036, "BlueSolar MPPT 75|10"},
+    {41037, "BlueSolar MPPT 150|45"},
+    {41038, "BlueSolar MPPT 150|60"},
+    {41039, "BlueSolar MPPT 150|85"},
+    {41040, "SmartSolar MPPT 250|100"},
+    {41041, "SmartSolar MPPT 150|100"},
+    {41042, "SmartSolar MPPT 150|85"},
+    {41043, "SmartSolar MPPT 75|15"},
+    {41044, "SmartSolar MPPT 75|10"},
+    {41045, "SmartSolar MPPT 100|15"},
+    {41046, "SmartSolar MPPT 100|30"},
+    {41047, "SmartSolar MPPT 100|50"},
+    {41048, "SmartSolar MPPT 150|35"},
+    {41049, "SmartSolar MPPT 150|100 rev2"},
+    {41050, "SmartSolar MPPT 150|85 rev2"},
+    {41051, "SmartSolar MPPT 250|70"},
+    {41052, "SmartSolar MPPT 250|85"},
+    {41053, "SmartSolar MPPT 250|60"},
+    {41054, "SmartSolar MPPT 250|45"},
+    {41055, "SmartSolar MPPT 100|20"},
+    {41056, "SmartSolar MPPT 100|20 48V"},
+    {41057, "SmartSolar MPPT 150|45"},
+    {41058, "SmartSolar MPPT 150|60"},
+    {41059, "SmartSolar MPPT 150|70"},
+    {41060, "SmartSolar MPPT 250|85 rev2"},
+    {41061, "SmartSolar MPPT 250|100 rev2"},
+    {41062, "BlueSolar MPPT 100|20"},
+    {41063, "BlueSolar MPPT 100|20 48V"},
+    {41064, "SmartSolar MPPT 250|60 rev2"},
+    {41065, "SmartSolar MPPT 250|70 rev2"},
+    {41066, "SmartSolar MPPT 150|45 rev2"},
+    {41067, "SmartSolar MPPT 150|60 rev2"},
+    {41068, "SmartSolar MPPT 150|70 rev2"},
+    {41069, "SmartSolar MPPT 150|85 rev3"},
+    {41070, "SmartSolar MPPT 150|100 rev3"},
+    {41071, "BlueSolar MPPT 150|45 rev2"},
+    {41072, "BlueSolar MPPT 150|60 rev2"},
+    {41073, "BlueSolar MPPT 150|70 rev2"},
+    {41218, "SmartSolar MPPT VE.Can 150/70"},
+    {41219, "SmartSolar MPPT VE.Can 150/45"},
+    {41220, "SmartSolar MPPT VE.Can 150/60"},
+    {41221, "SmartSolar MPPT VE.Can 150/85"},
+    {41222, "SmartSolar MPPT VE.Can 150/100"},
+    {41223, "SmartSolar MPPT VE.Can 250/45"},
+    {41224, "SmartSolar MPPT VE.Can 250/60"},
+    {41225, "SmartSolar MPPT VE.Can 250/70"},
+    {41226, "SmartSolar MPPT VE.Can 250/85"},
+    {41227, "SmartSolar MPPT VE.Can 250/100"},
+    {41228, "SmartSolar MPPT VE.Can 150/70 rev2"},
+    {41229, "SmartSolar MPPT VE.Can 150/85 rev2"},
+    {41230, "SmartSolar MPPT VE.Can 150/100 rev2"},
+    {41231, "BlueSolar MPPT VE.Can 150/100"},
+    {41234, "BlueSolar MPPT VE.Can 250/70"},
+    {41235, "BlueSolar MPPT VE.Can 250/100"},
+    {41236, "SmartSolar MPPT VE.Can 250/70 rev2"},
+    {41237, "SmartSolar MPPT VE.Can 250/100 rev2"},
+    {41238, "SmartSolar MPPT VE.Can 250/85 rev2"},
+    {41473, "Phoenix Inverter 12V 250VA 230V"},
+    {41474, "Phoenix Inverter 24V 250VA 230V"},
+    {41476, "Phoenix Inverter 48V 250VA 230V"},
+    {41489, "Phoenix Inverter 12V 375VA 230V"},
+    {41490, "Phoenix Inverter 24V 375VA 230V"},
+    {41492, "Phoenix Inverter 48V 375VA 230V"},
+    {41505, "Phoenix Inverter 12V 500VA 230V"},
+    {41506, "Phoenix Inverter 24V 500VA 230V"},
+    {41508, "Phoenix Inverter 48V 500VA 230V"},
+    {41521, "Phoenix Inverter 12V 250VA 230V"},
+    {41522, "Phoenix Inverter 24V 250VA 230V"},
+    {41524, "Phoenix Inverter 48V 250VA 230V"},
+    {41529, "Phoenix Inverter 12V 250VA 120V"},
+    {41530, "Phoenix Inverter 24V 250VA 120V"},
+    {41532, "Phoenix Inverter 48V 250VA 120V"},
+    {41537, "Phoenix Inverter 12V 375VA 230V"},
+    {41538, "Phoenix Inverter 24V 375VA 230V"},
+    {41540, "Phoenix Inverter 48V 375VA 230V"},
+    {41545, "Phoenix Inverter 12V 375VA 120V"},
+    {41546, "Phoenix Inverter 24V 375VA 120V"},
+    {41548, "Phoenix Inverter 48V 375VA 120V"},
+    {41553, "Phoenix Inverter 12V 500VA 230V"},
+    {41554, "Phoenix Inverter 24V 500VA 230V"},
+    {41556, "Phoenix Inverter 48V 500VA 230V"},
+    {41561, "Phoenix Inverter 12V 500VA 120V"},
+    {41562, "Phoenix Inverter 24V 500VA 120V"},
+    {41564, "Phoenix Inverter 48V 500VA 120V"},
+    {41569, "Phoenix Inverter 12V 800VA 230V"},
+    {41570, "Phoenix Inverter 24V 800VA 230V"},
+    {41572, "Phoenix Inverter 48V 800VA 230V"},
+    {41577, "Phoenix Inverter 12V 800VA 120V"},
+    {41578, "Phoenix Inverter 24V 800VA 120V"},
+    {41580, "Phoenix Inverter 48V 800VA 120V"},
+    {41585, "Phoenix Inverter 12V 1200VA 230V"},
+    {41586, "Phoenix Inverter 24V 1200VA 230V"},
+    {41588, "Phoenix Inverter 48V 1200VA 230V"},
+    {41593, "Phoenix Inverter 12V 1200VA 120V"},
+    {41594, "Phoenix Inverter 24V 1200VA 120V"},
+    {41596, "Phoenix Inverter 48V 1200VA 120V"},
+    {41601, "Phoenix Inverter 12V 1600VA 230V"},
+    {41602, "Phoenix Inverter 24V 1600VA 230V"},
+    {41604, "Phoenix Inverter 48V 1600VA 230V"},
+    {41617, "Phoenix Inverter 12V 2000VA 230V"},
+    {41618, "Phoenix Inverter 24V 2000VA 230V"},
+    {41620, "Phoenix Inverter 48V 2000VA 230V"},
+    {41633, "Phoenix Inverter 12V 3000VA 230V"},
+    {41634, "Phoenix Inverter 24V 3000VA 230V"},
+    {41636, "Phoenix Inverter 48V 3000VA 230V"},
+    {41792, "Phoenix Smart IP43 Charger 12|50 (1+1)"},
+    {41793, "Phoenix Smart IP43 Charger 12|50 (3)"},
+    {41794, "Phoenix Smart IP43 Charger 24|25 (1+1)"},
+    {41795, "Phoenix Smart IP43 Charger 24|25 (3)"},
+    {41796, "Phoenix Smart IP43 Charger 12|30 (1+1)"},
+    {41797, "Phoenix Smart IP43 Charger 12|30 (3)"},
+    {41798, "Phoenix Smart IP43 Charger 24|16 (1+1)"},
+    {41799, "Phoenix Smart IP43 Charger 24|16 (3)"},
+    {41857, "BMV-712 Smart"},
+};
+
+static constexpr VicMapEntry g_vic_map_cs[] = {
+    {0, "Off"},
+    {1, "Low power"},
+    {2, "Fault"},
+    {3, "Bulk"},
+    {4, "Absorption"},
+    {5, "Float"},
+    {6, "Storage"},
+    {7, "Equalize (manual)"},
+    {9, "Inverting"},
+    {11, "Power supply"},
+    {245, "Starting-up"},
+    {246, "Repeated absorption"},
+    {247, "Auto equalize / Recondition"},
+    {248, "BatterySafe"},
+    {252, "External Control"},
+};
+
+static constexpr VicMapEntry g_vic_map_err[] = {
+    {0, "No error"},
+    {2, "Battery voltage too high"},
+    {17, "Charger temperature too high"},
+    {18, "Charger over current"},
+    {19, "Charger current reversed"},
+    {20, "Bulk time limit exceeded"},
+    {21, "Current sensor issue (sensor bias/sensor broken)"},
+    {26, "Terminals overheated"},
+    {33, "Input voltage too high (solar panel)"},
+    {34, "Input current too high (solar panel)"},
+    {38, "Input shutdown (due to excessive battery voltage)"},
+    {39, "Input shutdown (due to current flow during off mode)"},
+    {65, "Lost communication with one of devices"},
+    {66, "Synchronised charging device configuration issue"},
+    {67, "BMS connection lost"},
+    {68, "Network misconfigured"},
+    {116, "Factory calibration data lost"},
+    {117, "Invalid/incompatible firmware"},
+    {119, "User settings invalid"},
+};
+
+static constexpr VicMapEntry g_vic_map_mode[] = {
+    {1, "VE_REG_MODE_CHARGER"},
+    {2, "VE_REG_MODE_INVERTER"},
+    {4, "VE_REG_MODE_OFF"},
+    {5, "VE_REG_MODE_ECO"},
+    {253, "VE_REG_MODE_HIBERNATE"},
+};
+
+static constexpr VicMapEntry g_vic_map_mppt[] = {
+    {0, "Off"},
+    {1, "Voltage or current limited"},
+    {2, "MPP Tracker active"},
+};
+
+// Publish policies, indexed by VicFieldId
+static constexpr VicPolicy g_vicPolicies[] = {
+    {0, 0, 0, 300}, // AC_OUT_I
+    {0, 0, 0, 300}, // AC_OUT_S
+    {0, 0, 0, 300}, // AC_OUT_V
+    {0, 0, 0, 0}, // AR
+    {0, 0, 0, 0}, // Alarm
+    {0, 0, 0, 300}, // BMV
+    {100, 0, 10, 120}, // CE
+    {0, 0, 0, 0}, // CS
+    {0, 0, 0, 300}, // DM
+    {0, 0, 0, 0}, // ERR
+    {0, 0, 0, 300}, // FW
+    {0, 0, 0, 300}, // FWE
+    {0, 0, 0, 300}, // H1
+    {0, 0, 0, 300}, // H10
+    {0, 0, 0, 300}, // H11
+    {0, 0, 0, 300}, // H12
+    {0, 0, 0, 300}, // H13
+    {0, 0, 0, 300}, // H14
+    {0, 0, 0, 300}, // H15
+    {0, 0, 0, 300}, // H16
+    {0, 0, 0, 300}, // H17
+    {0, 0, 0, 300}, // H18
+    {0, 0, 0, 300}, // H19
+    {0, 0, 0, 300}, // H2
+    {0, 0, 0, 300}, // H20
+    {0, 0, 0, 300}, // H21
+    {0, 0, 0, 300}, // H22
+    {0, 0, 0, 300}, // H23
+    {0, 0, 0, 300}, // H3
+    {0, 0, 0, 300}, // H4
+    {0, 0, 0, 300}, // H5
+    {0, 0, 0, 300}, // H6
+    {0, 0, 0, 300}, // H7
+    {0, 0, 0, 300}, // H8
+    {0, 0, 0, 300}, // H9
+    {0, 0, 0, 300}, // HSDS
+    {50, 0, 5, 60}, // I
+    {50, 0, 5, 60}, // I2
+    {50, 0, 5, 60}, // I3
+    {50, 0, 5, 60}, // IL
+    {0, 0, 0, 0}, // LOAD
+    {0, 0, 0, 0}, // MODE
+    {0, 0, 0, 0}, // MPPT
+    {0, 0, 0, 0}, // OR
+    {1, 20, 5, 60}, // P
+    {0, 0, 0, 300}, // PID
+    {1, 20, 5, 60}, // PPV
+    {0, 0, 0, 0}, // Relay
+    {0, 0, 0, 300}, // SER#
+    {2, 0, 10, 120}, // SOC
+    {0, 0, 60, 300}, // T
+    {0, 0, 60, 300}, // TTG
+    {10, 0, 5, 60}, // V
+    {10, 0, 5, 60}, // V2
+    {10, 0, 5, 60}, // V3
+    {10, 0, 5, 60}, // VM
+    {100, 0, 5, 60}, // VPV
+    {10, 0, 5, 60}, // VS
+    {0, 0, 0, 0}, // WARN
+    {50, 0, 5, 60}, // ipv
+    {1, 0, 5, 60}, // eff
+};
+
+// Derived fields and the expressions they're computed from
+static constexpr VicDerivedExpr g_vicDerivedExprs[] = {
+    {VIC_FIELD_P, "V * I"},
+    {VIC_FIELD_IPV, "PPV / VPV"},
+    {VIC_FIELD_EFF, "P / PPV * 100"},
+};
+static constexpr size_t VIC_NUM_DERIVED_EXPRS = 3;
+
+// Fields added at runtime
+static constexpr VicPolicy g_vicDefaultPolicy = {0, 0, 0, 300};
+
+// Type names, sorted for binary search
+static constexpr VicTypeName g_vicTypeNames[] = {
+    {"%", VIC_TYPE_PCT},
+    {"0.01 V", VIC_TYPE_VOLT_CENTI},
+    {"0.01 kWh", VIC_TYPE_KWH_CENTI},
+    {"0.1 %", VIC_TYPE_PCT_TENTH},
+    {"0.1 A", VIC_TYPE_AMP_TENTH},
+    {"VA", VIC_TYPE_VA},
+    {"W", VIC_TYPE_WATT},
+    {"count", VIC_TYPE_COUNTER},
+    {"deg_C", VIC_TYPE_DEG_C},
+    {"fw", VIC_TYPE_FW},
+    {"fwe", VIC_TYPE_FWE},
+    {"mA", VIC_TYPE_MA},
+    {"mAh", VIC_TYPE_MAH},
+    {"mV", VIC_TYPE_MV},
+    {"map_ar", VIC_TYPE_MAP_AR},
+    {"map_cs", VIC_TYPE_MAP_CS},
+    {"map_err", VIC_TYPE_MAP_ERR},
+    {"map_mode", VIC_TYPE_MAP_MODE},
+    {"map_mppt", VIC_TYPE_MAP_MPPT},
+    {"map_or", VIC_TYPE_MAP_OR},
+    {"map_pid", VIC_TYPE_MAP_PID},
+    {"min", VIC_TYPE_MINUTES},
+    {"onoff", VIC_TYPE_ONOFF},
+    {"range[0..364]", VIC_TYPE_DAY_SEQ},
+    {"sec", VIC_TYPE_SECONDS},
+    {"serial", VIC_TYPE_SERIAL},
+    {"string", VIC_TYPE_STRING},
+};
+
+static constexpr VicMap g_vicMaps[] = {
+    {g_vic_map_ar, sizeof(g_vic_map_ar) / sizeof(g_vic_map_ar[0])},
+    {g_vic_map_or, sizeof(g_vic_map_or) / sizeof(g_vic_map_or[0])},
+    {g_vic_map_pid, sizeof(g_vic_map_pid) / sizeof(g_vic_map_pid[0])},
+    {g_vic_map_cs, sizeof(g_vic_map_cs) / sizeof(g_vic_map_cs[0])},
+    {g_vic_map_err, sizeof(g_vic_map_err) / sizeof(g_vic_map_err[0])},
+    {g_vic_map_mode, sizeof(g_vic_map_mode) / sizeof(g_vic_map_mode[0])},
+    {g_vic_map_mppt, sizeof(g_vic_map_mppt) / sizeof(g_vic_map_mppt[0])},
+};
+
+// CRC-32 of the definitions, see VictronDefs::saveOverrides()
+static constexpr uint32_t VIC_DEFS_HASH = 0xf662796b;
+
+#endif
@@ -0,0 +1,82 @@
+// Generated by tools/gen_victron_defs.py from defs/victron_data_def.json.
+// Do not edit by hand, edit the definitions file and rebuild.
+
+#ifndef __H_VICTRON_FIELDS__
+#define __H_VICTRON_FIELDS__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Field IDs. Fields sent by the device come first, in the (strcmp)
+// order of the field table, followed by fields derived from them.
+enum VicFieldId : uint8_t
+{
+    VIC_FIELD_AC_OUT_I,
+    VIC_FIELD_AC_OUT_S,
+    VIC_FIELD_AC_OUT_V,
+    VIC_FIELD_AR,
+    VIC_FIELD_ALARM,
+    VIC_FIELD_BMV,
+    VIC_FIELD_CE,
+    VIC_FIELD_CS,
+    VIC_FIELD_DM,
+    VIC_FIELD_ERR,
+    VIC_FIELD_FW,
+    VIC_FIELD_FWE,
+    VIC_FIELD_H1,
+    VIC_FIELD_H10,
+    VIC_FIELD_H11,
+    VIC_FIELD_H12,
+    VIC_FIELD_H13,
+    VIC_FIELD_H14,
+    VIC_FIELD_H15,
+    VIC_FIELD_H16,
+    VIC_FIELD_H17,
+    VIC_FIELD_H18,
+    VIC_FIELD_H19,
+    VIC_FIELD_H2,
+    VIC_FIELD_H20,
+    VIC_FIELD_H21,
+    VIC_FIELD_H22,
+    VIC_FIELD_H23,
+    VIC_FIELD_H3,
+    VIC_FIELD_H4,
+    VIC_FIELD_H5,
+    VIC_FIELD_H6,
+    VIC_FIELD_H7,
+    VIC_FIELD_H8,
+    VIC_FIELD_H9,
+    VIC_FIELD_HSDS,
+    VIC_FIELD_I,
+    VIC_FIELD_I2,
+    VIC_FIELD_I3,
+    VIC_FIELD_IL,
+    VIC_FIELD_LOAD,
+    VIC_FIELD_MODE,
+    VIC_FIELD_MPPT,
+    VIC_FIELD_OR,
+    VIC_FIELD_P,
+    VIC_FIELD_PID,
+    VIC_FIELD_PPV,
+    VIC_FIELD_RELAY,
+    VIC_FIELD_SERNUM,
+    VIC_FIELD_SOC,
+    VIC_FIELD_T,
+    VIC_FIELD_TTG,
+    VIC_FIELD_V,
+    VIC_FIELD_V2,
+    VIC_FIELD_V3,
+    VIC_FIELD_VM,
+    VIC_FIELD_VPV,
+    VIC_FIELD_VS,
+    VIC_FIELD_WARN,
+
+    VIC_FIELD_IPV,
+    VIC_FIELD_EFF,
+
+    VIC_NUM_FIELDS
+};
+
+static constexpr size_t VIC_NUM_LABEL_FIELDS = 59;
+
+#endif
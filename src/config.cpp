@@ -1,12 +1,28 @@
-#include <WiFi.h>
-#include <SPIFFS.h>
+#include <stdlib.h>
+#include <string.h>
 #include <ArduinoJson.h>
 #include "config.hpp"
 
+// Fast-changing MPPT registers fetched over the HEX protocol between the
+// 1 Hz text blocks
+static const uint16_t mpptPollRegisters[] = {0xEDBB,  // Panel voltage
+                                             0xEDBC,  // Panel power
+                                             0xEDD5,  // Charger voltage
+                                             0xEDD7}; // Charger current
+
+VicInputConfig::VicInputConfig()
+    : base(""), uart(-1), rxPin(-1), txPin(-1), mux(-1), channel(0), pollCount(0) {}
+
+VicMuxConfig::VicMuxConfig()
+    : uart(-1), rxPin(-1), txPin(-1), selectCount(0), dwell_ms(2500) {}
+
+VicSensorConfig::VicSensorConfig()
+    : samples(4), interval_ms(250), tempDeadband(0.1), humidityDeadband(0.5), maxInterval_s(60) {}
+
 Config::Config()
-    : _doc(1024) {}
+    : _doc(MAX_CONFIG_DOC) {}
 
-bool Config::readConfig(File configFile)
+bool Config::readConfig(VicFile &configFile)
 {
     DeserializationError error = deserializeJson(_doc, configFile);
 
@@ -27,3 +43,174 @@ const char *Config::getMDNS()
 {
     return _doc["mdns"];
 }
+
+// Optional, per-field topics unless "batch": true
+bool Config::getBatchPublish()
+{
+    return _doc["batch"] | false;
+}
+
+// Optional, "json" unless "msgpack"
+const char *Config::getEncoding()
+{
+    return _doc["encoding"] | "json";
+}
+
+// Optional, run the encoding benchmark once connected
+bool Config::getBenchmark()
+{
+    return _doc["benchmark"] | false;
+}
+
+// Optional aggregation windows in seconds, e.g. [10, 60]
+size_t Config::getWindows(uint16_t *dest, size_t size)
+{
+    size_t count = 0;
+    for (JsonVariant v : _doc["windows"].as<JsonArray>())
+    {
+        if (count < size)
+        {
+            dest[count++] = v | 0;
+        }
+    }
+
+    return count;
+}
+
+// Optional, set "raw": false to only publish aggregates
+bool Config::getRawPublish()
+{
+    return _doc["raw"] | true;
+}
+
+// Optional, backlog records replayed per second
+uint16_t Config::getReplayRate()
+{
+    return _doc["replayRate"] | 50;
+}
+
+// Optional, set "backlogSeries": true to replay the backlog series encoded
+bool Config::getBacklogSeries()
+{
+    return _doc["backlogSeries"] | false;
+}
+
+// Without an "inputs" list, the original board: a BMV-712 on UART0 and
+// two MPPTs on UART1 and UART2
+static void defaultInputs(VicInputConfig *dest, size_t size, size_t *count)
+{
+    static const char *bases[] = {"pmcg-esp32/victron/bmv-712",
+                                  "pmcg-esp32/victron/solar/100-50",
+                                  "pmcg-esp32/victron/solar/100-30"};
+    static const int8_t pins[][2] = {{3, 1}, {12, 14}, {16, 17}};
+
+    for (*count = 0; (*count < size) && (*count < 3); (*count)++)
+    {
+        VicInputConfig &input = dest[*count];
+        input = VicInputConfig();
+        input.base = bases[*count];
+        input.uart = *count;
+        input.rxPin = pins[*count][0];
+        input.txPin = pins[*count][1];
+        if (*count > 0)
+        {
+            input.pollCount = sizeof(mpptPollRegisters) / sizeof(mpptPollRegisters[0]);
+            memcpy(input.poll, mpptPollRegisters, sizeof(mpptPollRegisters));
+        }
+    }
+}
+
+// Optional list of devices, e.g.
+// [{"base": "site/bmv", "uart": 1, "rx": 12, "tx": 14},
+//  {"base": "site/mppt-1", "mux": 0, "channel": 0, "poll": ["EDBB"],
+//   "policies": {"V": {"deadband": 50}}}]
+size_t Config::getInputs(VicInputConfig *dest, size_t size)
+{
+    size_t count = 0;
+
+    JsonArray inputs = _doc["inputs"];
+    if (inputs.isNull())
+    {
+        defaultInputs(dest, size, &count);
+        return count;
+    }
+
+    for (JsonObject v : inputs)
+    {
+        if (count >= size)
+        {
+            break;
+        }
+
+        VicInputConfig &input = dest[count++];
+        input = VicInputConfig();
+        input.base = v["base"] | "";
+        input.uart = v["uart"] | -1;
+        input.rxPin = v["rx"] | -1;
+        input.txPin = v["tx"] | -1;
+        input.mux = v["mux"] | -1;
+        input.channel = v["channel"] | 0;
+        input.policies = v["policies"].as<JsonObject>();
+
+        // Registers as hex strings, "EDBB", or numbers
+        for (JsonVariant reg : v["poll"].as<JsonArray>())
+        {
+            if (input.pollCount < MAX_VIC_POLL)
+            {
+                input.poll[input.pollCount++] = reg.is<const char *>()
+                                                    ? strtoul(reg.as<const char *>(), 0, 16)
+                                                    : (reg | 0);
+            }
+        }
+    }
+
+    return count;
+}
+
+// Optional list of multiplexers the inputs can refer to, e.g.
+// [{"uart": 2, "rx": 16, "tx": 17, "select": [25, 26, 27]}]
+size_t Config::getMuxes(VicMuxConfig *dest, size_t size)
+{
+    size_t count = 0;
+    for (JsonObject v : _doc["muxes"].as<JsonArray>())
+    {
+        if (count >= size)
+        {
+            break;
+        }
+
+        VicMuxConfig &mux = dest[count++];
+        mux = VicMuxConfig();
+        mux.uart = v["uart"] | -1;
+        mux.rxPin = v["rx"] | -1;
+        mux.txPin = v["tx"] | -1;
+        mux.dwell_ms = v["dwell"] | mux.dwell_ms;
+        for (JsonVariant pin : v["select"].as<JsonArray>())
+        {
+            if (mux.selectCount < MAX_VIC_MUX_SELECT)
+            {
+                mux.select[mux.selectCount++] = pin | -1;
+            }
+        }
+    }
+
+    return count;
+}
+
+// Optional "sensor" object, defaults to 4 samples a second, 0.1 C and
+// 0.5 %RH deadbands and a reading at least every minute
+void Config::getSensor(VicSensorConfig &dest)
+{
+    dest = VicSensorConfig();
+    JsonObject sensor = _doc["sensor"];
+    if (sensor.isNull())
+    {
+        return;
+    }
+
+    dest.samples = sensor["samples"] | dest.samples;
+    dest.interval_ms = sensor["interval"] | dest.interval_ms;
+    dest.tempDeadband = sensor["tempDeadband"] | dest.tempDeadband;
+    dest.humidityDeadband = sensor["humidityDeadband"] | dest.humidityDeadband;
+    dest.maxInterval_s = sensor["maxInterval"] | dest.maxInterval_s;
+}
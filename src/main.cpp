@@ -3,15 +3,29 @@
 #include <ESPmDNS.h>
 #include <ArduinoOTA.h>
 #include <AsyncMqttClient.h>
-#include <Adafruit_Si7021.h>
+#include <Wire.h>
 #include <SPIFFS.h>
 #include <ArduinoJson.h>
-#include <HardwareSerial.h>
+#include <Preferences.h>
+#include <esp_system.h>
+#include <time.h>
+#include <new>
 #include "config.hpp"
 #include "mqtt_discovery.hpp"
 #include "ve_direct_text.hpp"
-
-#define MAX_LINE 200
+#include "ve_direct_uart.hpp"
+#include "ve_direct_mux.hpp"
+#include "si7021_sampler.hpp"
+#include "vic_encoding.hpp"
+#include "vic_partition_flash.hpp"
+#include "vic_ring_log.hpp"
+#include "vic_publisher.hpp"
+#include "vic_hal_arduino.hpp"
+#include "vic_reconnect.hpp"
+#include "vic_boot_profile.hpp"
+
+#define MAX_BENCH_DOC 512
+#define MAX_VIC_MUXES 3
 
 AsyncMqttClient mqttClient;
 const uint16_t discoveryPort = 2112;
@@ -20,23 +34,112 @@ MQTTDiscovery mqttDiscovery(discoveryPort,
                             localPort,
                             &mqttClient);
 
-Adafruit_Si7021 tempHumSensor;
+// The Si7021 is sampled from the publisher task without blocking it,
+// see Si7021Sampler
+Si7021Sampler tempHumSensor;
+VicSensorConfig sensorConfig;
+bool sensorPresent = false;
+float lastTemperature = 0;
+float lastHumidity = 0;
+unsigned long lastSensorMillis = 0;
+bool sensorReported = false;
 
 void doTempHumSensor();
 
-const int reportRate_ms = 1000;
-unsigned long nextThingMillis;
-
-struct VicInput
+// Each input has its own reader task that owns the port and the parser,
+// and pushes changes onto its queue. A single publisher task drains the
+// queues and does all the MQTT publishing, so a slow publish or an OTA
+// check never holds up the UARTs.
+const BaseType_t taskCore = 1;
+const UBaseType_t readerPriority = 3;
+const UBaseType_t publisherPriority = 2;
+const uint32_t readerStack = 4096;
+const uint32_t publisherStack = 8192;
+const int publisherIdle_ms = 10;
+
+// Free heap, its low water mark, the largest free block and how
+// fragmented the rest is, plus the publisher task's spare stack, on
+// pmcg-esp32/heap. The longest publisher pass and sensor poll since the
+// last report on pmcg-esp32/timing, against the time the UART's 128 byte
+// hardware FIFO takes to fill.
+const int heapRate_ms = 60000;
+uint32_t maxPublisherPass_us = 0;
+
+// Inputs' "poll" registers are fetched over the HEX protocol between
+// the 1 Hz text blocks. Needs the ESP32 TX pin wired to the device's RX.
+const int hexPollRate_ms = 250;
+
+const uint32_t vicBaud = 19200;
+
+// Run the encoding benchmark once connected, results on
+// pmcg-esp32/benchmark
+bool runBenchmark = false;
+
+// Values that couldn't be published while the broker was away go to a
+// ring log in the "vlog" flash partition, and are replayed on
+// <base>/backlog once it's back
+VicPartitionFlash logFlash;
+VicRingLog offlineLog(&logFlash);
+
+// The publisher only sees the platform through these, see vic_hal.hpp
+VicArduinoClock boardClock;
+VicAsyncMqttSink mqttSink(&mqttClient);
+VicPublisher publisher(&mqttSink, &boardClock, &offlineLog);
+
+// Finds the broker and keeps reconnecting to it, run from the publisher
+// task. How long each connect took goes out on pmcg-esp32/reconnect.
+VicReconnect reconnect(&mqttDiscovery, &boardClock);
+
+// Serial ingest starts before Wi-Fi is up, with values going to the
+// offline log until there's a broker. Discovery and OTA start once the
+// network is there. When each phase of the boot finished goes out once
+// on pmcg-esp32/boot, with why the board restarted.
+VicBootProfile bootProfile(&boardClock);
+bool networkUp = false;
+bool otaStarted = false;
+bool bootReported = false;
+const char *defsSource = "compiled";
+
+// Overrides from the data file are cached in NVS with the file's
+// checksum, so they're only parsed from JSON when the file changes
+const char *defsPrefs = "defs";
+const char *defsPath = "/victron_data_def.json";
+
+// Inputs come from "inputs" in config.json, a UART each or a channel
+// on a multiplexer. The inputs on a multiplexer share one reader task
+// that takes turns between them.
+struct VicMuxReader
 {
-  char mqttBase[1024];
-  HardwareSerial *port;
-  VEDirectText processor;
-  char readLine[MAX_LINE];
-  int pos;
+  VEDirectMux mux;
+  VicInput *inputs[MAX_VED_MUX_CHANNELS];
+  uint8_t channels[MAX_VED_MUX_CHANNELS];
+  size_t count;
+  uint16_t dwell_ms;
 };
 
-VicInput inputs[3];
+VicInputConfig inputConfigs[MAX_VIC_INPUTS];
+// Allocated one at a time, each is about 19 KB
+VicInput *inputs[MAX_VIC_INPUTS];
+size_t inputCount = 0;
+VicInput *directInputs[UART_NUM_MAX];
+size_t directCount = 0;
+VEDirectUART uarts[UART_NUM_MAX];
+bool uartUsed[UART_NUM_MAX];
+VicMuxReader muxReaders[MAX_VIC_MUXES];
+size_t muxCount = 0;
+
+void readerTask(void *param);
+void muxReaderTask(void *param);
+void publisherTask(void *param);
+void setupInputs();
+bool beginUART(int port, int rxPin, int txPin);
+void doBenchmark();
+void doHeapStats();
+void doTimingStats();
+void doReconnectStats();
+void doBootStats();
+const char *loadVictronDefs();
+const char *resetReasonName();
 
 Config config;
 
@@ -47,6 +150,7 @@ void setup()
     delay(1000);
     ESP.restart();
   }
+  bootProfile.mark(VIC_BOOT_SPIFFS);
 
   File configFile = SPIFFS.open("/config.json", "r");
   if (!configFile)
@@ -55,143 +159,547 @@ void setup()
     ESP.restart();
   }
 
-  if (!config.readConfig(configFile))
+  VicSpiffsFile configReader(configFile);
+  if (!config.readConfig(configReader))
   {
     delay(1000);
     ESP.restart();
   }
   configFile.close();
+  bootProfile.mark(VIC_BOOT_CONFIG);
+
+  VicPublishOptions options;
+  options.batch = config.getBatchPublish();
+  options.encoding = VicEncoding::formatFromName(config.getEncoding());
+  options.windowCount = config.getWindows(options.windows, MAX_VIC_WINDOWS);
+  options.raw = config.getRawPublish();
+  options.replayRate = config.getReplayRate();
+  options.backlogSeries = config.getBacklogSeries();
+  runBenchmark = config.getBenchmark();
+
+  defsSource = loadVictronDefs();
+  if (!VicDerived::build())
+  {
+    bootProfile.addError("%s", VicDerived::getBuildError());
+  }
+  bootProfile.mark(VIC_BOOT_DEFS);
+
+  // Done with files
+  SPIFFS.end();
+
+  // No partition (older partition table) just means no offline log
+  if (logFlash.begin("vlog"))
+  {
+    offlineLog.mount();
+  }
+  bootProfile.mark(VIC_BOOT_LOG);
+
+  setupInputs();
+  publisher.begin(inputs, inputCount, options);
+
+  for (size_t i = 0; i < directCount; i++)
+  {
+    char name[16];
+    sprintf(name, "vic-reader-%d", (int)i);
+    xTaskCreatePinnedToCore(readerTask, name, readerStack,
+                            directInputs[i], readerPriority, 0, taskCore);
+  }
+  for (size_t m = 0; m < muxCount; m++)
+  {
+    if (muxReaders[m].count > 0)
+    {
+      char name[16];
+      sprintf(name, "vic-mux-%d", (int)m);
+      xTaskCreatePinnedToCore(muxReaderTask, name, readerStack,
+                              &muxReaders[m], readerPriority, 0, taskCore);
+    }
+  }
+  bootProfile.mark(VIC_BOOT_INPUTS);
+
+  // A missing sensor shouldn't stop the inputs
+  config.getSensor(sensorConfig);
+  sensorPresent = tempHumSensor.begin(&Wire, sensorConfig.samples, sensorConfig.interval_ms);
+  if (!sensorPresent)
+  {
+    bootProfile.addError("No Si7021");
+  }
+
+  xTaskCreatePinnedToCore(publisherTask, "vic-publisher", publisherStack,
+                          0, publisherPriority, 0, taskCore);
 
+  // Connects in the background, the publisher task and loop() pick it
+  // up when it's there
   WiFi.mode(WIFI_STA);
+  WiFi.setAutoReconnect(true);
   WiFi.begin(config.getSSID(), config.getKey());
-  if (WiFi.waitForConnectResult() != WL_CONNECTED)
+
+  // Backlog records are timestamped from the clock once it's set
+  configTime(0, 0, "pool.ntp.org");
+}
+
+void loop()
+{
+  if (!otaStarted)
   {
-    delay(1000);
-    ESP.restart();
+    if (!WiFi.isConnected())
+    {
+      delay(publisherIdle_ms);
+      return;
+    }
+
+    ArduinoOTA.setHostname(config.getMDNS());
+    ArduinoOTA.begin();
+    otaStarted = true;
   }
 
-  ArduinoOTA.setHostname(config.getMDNS());
-  ArduinoOTA.begin();
+  ArduinoOTA.handle();
+}
 
-  tempHumSensor = Adafruit_Si7021();
-  if (!tempHumSensor.begin())
+// The data file is optional, without it the compiled in definitions are
+// used as they are. Returns where the definitions came from, for the
+// boot report.
+const char *loadVictronDefs()
+{
+  if (!SPIFFS.exists(defsPath))
   {
-    delay(1000);
-    ESP.restart();
+    return "compiled";
+  }
+
+  File victronDDFile = SPIFFS.open(defsPath, "r");
+  if (!victronDDFile)
+  {
+    bootProfile.addError("Can't open victron_data_def.json");
+    return "compiled";
   }
+  VicSpiffsFile checksumReader(victronDDFile);
+  uint32_t crc = VEDirectText::defsChecksum(checksumReader);
+  victronDDFile.close();
 
-  mqttDiscovery.discoverAndConnectBroker();
+  Preferences prefs;
+  if (!prefs.begin(defsPrefs, false))
+  {
+    bootProfile.addError("No NVS for the definitions cache");
+  }
+  else if (prefs.getUInt("crc", 0) == crc)
+  {
+    uint8_t blob[MAX_VIC_OVERRIDES_BLOB];
+    size_t len = prefs.getBytes("blob", blob, sizeof(blob));
+    if ((len > 0) && VictronDefs::loadOverrides(blob, len))
+    {
+      prefs.end();
+      return "cached";
+    }
+  }
 
-  // Load victron defs
-  File victronDDFile = SPIFFS.open("/victron_data_def.json", "r");
+  const char *source = "parsed";
+  victronDDFile = SPIFFS.open(defsPath, "r");
+  VicSpiffsFile victronDDReader(victronDDFile);
   if (!victronDDFile)
   {
-    Serial.println("Failed to open victron_data_def.json for reading");
-    return;
+    bootProfile.addError("Can't open victron_data_def.json");
+    source = "compiled";
+  }
+  else if (!VEDirectText::loadDefs(victronDDReader))
+  {
+    bootProfile.addError("%s", VEDirectText::getLoadDefsError());
+    source = "compiled";
   }
   else
   {
-    VEDirectText::loadDefs(victronDDFile);
+    // The checksum goes in last, so a reset part way through is just
+    // another miss next boot
+    uint8_t blob[MAX_VIC_OVERRIDES_BLOB];
+    size_t len = VictronDefs::saveOverrides(blob, sizeof(blob));
+    if ((len > 0) && (prefs.putBytes("blob", blob, len) == len))
+    {
+      prefs.putUInt("crc", crc);
+    }
   }
   victronDDFile.close();
+  prefs.end();
 
-  // Done with files
-  SPIFFS.end();
+  return source;
+}
 
-  // Initialize inputs
-  Serial.begin(19200);
-  strcpy(inputs[0].mqttBase, "pmcg-esp32/victron/bmv-712");
-  inputs[0].port = &Serial;
-  inputs[0].pos = 0;
+// The UARTs run on the ESP-IDF driver rather than HardwareSerial so the
+// reader tasks can sleep on the UART events
+bool beginUART(int port, int rxPin, int txPin)
+{
+  if ((port < 0) || (port >= UART_NUM_MAX) || uartUsed[port])
+  {
+    return false;
+  }
 
-  Serial1.begin(19200, SERIAL_8N1, 12, 14);
-  strcpy(inputs[1].mqttBase, "pmcg-esp32/victron/solar/100-50");
-  inputs[1].port = &Serial1;
-  inputs[1].pos = 0;
+  if (!uarts[port].begin((uart_port_t)port, vicBaud, rxPin, txPin))
+  {
+    return false;
+  }
+  uartUsed[port] = true;
+
+  return true;
+}
 
-  Serial2.begin(19200);
-  strcpy(inputs[2].mqttBase, "pmcg-esp32/victron/solar/100-30");
-  inputs[2].port = &Serial2;
-  inputs[2].pos = 0;
+// Inputs that can't be set up are left out, the rest still run
+void setupInputs()
+{
+  VicMuxConfig muxConfigs[MAX_VIC_MUXES];
+  muxCount = config.getMuxes(muxConfigs, MAX_VIC_MUXES);
+  for (size_t m = 0; m < muxCount; m++)
+  {
+    VicMuxConfig &muxConfig = muxConfigs[m];
+    muxReaders[m].count = 0;
+    muxReaders[m].dwell_ms = muxConfig.dwell_ms;
+    if ((!beginUART(muxConfig.uart, muxConfig.rxPin, muxConfig.txPin)) ||
+        (!muxReaders[m].mux.begin(&uarts[muxConfig.uart], muxConfig.select, muxConfig.selectCount)))
+    {
+      bootProfile.addError("Can't set up mux %d", (int)m);
+      muxReaders[m].dwell_ms = 0;
+    }
+  }
+
+  size_t configCount = config.getInputs(inputConfigs, MAX_VIC_INPUTS);
+  for (size_t i = 0; i < configCount; i++)
+  {
+    VicInputConfig &inputConfig = inputConfigs[i];
+    if (inputConfig.base[0] == '\0')
+    {
+      bootProfile.addError("Input %d has no base topic", (int)i);
+      continue;
+    }
+
+    // Separately, so a full heap costs the inputs that don't fit rather
+    // than all of them
+    VicInput *allocated = new (std::nothrow) VicInput();
+    if (allocated == 0)
+    {
+      bootProfile.addError("No memory for input %d", (int)i);
+      continue;
+    }
+    VicInput &input = *allocated;
+
+    if (inputConfig.mux >= 0)
+    {
+      VicMuxReader *reader = (inputConfig.mux < (int)muxCount) ? &muxReaders[inputConfig.mux] : 0;
+      if ((reader == 0) ||
+          (reader->dwell_ms == 0) ||
+          (inputConfig.channel >= reader->mux.getChannelCount()) ||
+          (reader->count >= MAX_VED_MUX_CHANNELS))
+      {
+        bootProfile.addError("Input %d has a bad mux or channel", (int)i);
+        delete allocated;
+        continue;
+      }
+
+      reader->inputs[reader->count] = &input;
+      reader->channels[reader->count] = inputConfig.channel;
+      reader->count++;
+      input.source = reader->mux.getSource();
+    }
+    else
+    {
+      if (!beginUART(inputConfig.uart, inputConfig.rxPin, inputConfig.txPin))
+      {
+        bootProfile.addError("Input %d has a bad or shared UART", (int)i);
+        delete allocated;
+        continue;
+      }
+
+      directInputs[directCount++] = &input;
+      input.source = &uarts[inputConfig.uart];
+    }
 
-  nextThingMillis = millis() + reportRate_ms;
+    strncpy(input.mqttBase, inputConfig.base, sizeof(input.mqttBase) - 1);
+    input.pollRegisters = inputConfig.poll;
+    input.pollCount = inputConfig.pollCount;
+    if (!input.filter.loadPolicies(inputConfig.policies))
+    {
+      bootProfile.addError("Bad policies for input %d", (int)i);
+    }
+    inputs[inputCount++] = allocated;
+  }
 }
 
-void loop()
+void readerTask(void *param)
 {
-  ArduinoOTA.handle();
+  VicInput *input = (VicInput *)param;
+  unsigned long nextHexPollMillis = millis() + hexPollRate_ms;
 
-  if (millis() > nextThingMillis)
+  for (;;)
   {
-    doTempHumSensor();
+    // Sleep until the UART has a burst for us or the next poll is due.
+    // Compared as a signed difference so it holds when millis() wraps.
+    int32_t until = (int32_t)(nextHexPollMillis - millis());
+    uint32_t wait_ms = (until > 0) ? until : 0;
+
+    VicPublisher::readInput(*input, wait_ms);
 
-    nextThingMillis += reportRate_ms;
+    if ((int32_t)(millis() - nextHexPollMillis) >= 0)
+    {
+      VicPublisher::pollHex(*input);
+
+      nextHexPollMillis += hexPollRate_ms;
+    }
   }
+}
+
+// Takes turns between the devices on a multiplexer, staying on each
+// until a whole block has come in or it's taking too long
+void muxReaderTask(void *param)
+{
+  VicMuxReader *reader = (VicMuxReader *)param;
 
-  for (int i = 0; i < 3; i++)
+  for (;;)
   {
-    DynamicJsonDocument updates(4096);
-    while (inputs[i].port->available())
+    for (size_t c = 0; c < reader->count; c++)
     {
-      inputs[i].readLine[inputs[i].pos] = inputs[i].port->read();
-      if ((!(inputs[i].pos < MAX_LINE)) || (inputs[i].readLine[inputs[i].pos] == '\n'))
+      VicInput *input = reader->inputs[c];
+      reader->mux.select(reader->channels[c]);
+      input->processor.restart();
+
+      uint32_t blocks = input->processor.getGoodBlocks() + input->processor.getBadBlocks();
+      unsigned long start = millis();
+      unsigned long nextHexPollMillis = start;
+      while ((millis() - start < reader->dwell_ms) &&
+             (input->processor.getGoodBlocks() + input->processor.getBadBlocks() == blocks))
       {
-        // Process line
-        inputs[i].readLine[inputs[i].pos] = 0;
+        if ((int32_t)(millis() - nextHexPollMillis) >= 0)
+        {
+          VicPublisher::pollHex(*input);
 
-        inputs[i].processor.handleLine(updates, inputs[i].readLine);
+          nextHexPollMillis += hexPollRate_ms;
+        }
 
-        inputs[i].pos = 0;
+        // Signed, so it holds when millis() wraps
+        int32_t until = (int32_t)(nextHexPollMillis - millis());
+        uint32_t wait_ms = (until > 0) ? until : 0;
+        VicPublisher::readInput(*input, wait_ms);
       }
-      else
+    }
+  }
+}
+
+void publisherTask(void *param)
+{
+  unsigned long nextHeapMillis = millis() + heapRate_ms;
+
+  for (;;)
+  {
+    uint32_t passStart = micros();
+
+    if (!networkUp)
+    {
+      // Retried each pass until the network is up
+      if (WiFi.isConnected() && mqttDiscovery.begin())
       {
-        inputs[i].pos++;
+        // Only marked here, when the publisher can use the network
+        bootProfile.mark(VIC_BOOT_WIFI);
+        reconnect.begin();
+        networkUp = true;
       }
     }
-
-    if ((!updates.isNull()) && mqttClient.connected())
+    else if (reconnect.poll())
     {
-      char json[1024];
-      char topic[500];
-      char key[50];
+      doReconnectStats();
 
-      JsonObject obj = updates.as<JsonObject>();
-      for (JsonPair kv : obj)
+      if (!bootReported)
       {
-        serializeJsonPretty(kv.value(), json);
-        strcpy(key, kv.key().c_str());
-        int keyLen = strlen(key);
-        for (int i = 0; i < keyLen; i++)
+        bootProfile.mark(VIC_BOOT_BROKER);
+        doBootStats();
+        bootReported = true;
+      }
+    }
+
+    if (!bootProfile.isMarked(VIC_BOOT_FIRST_BLOCK))
+    {
+      for (size_t i = 0; i < inputCount; i++)
+      {
+        if (inputs[i]->processor.getGoodBlocks() > 0)
         {
-          if (key[i] == '#')
-          {
-            key[i] = '-';
-          }
+          bootProfile.mark(VIC_BOOT_FIRST_BLOCK);
+          break;
         }
-        sprintf(topic, "%s/%s", inputs[i].mqttBase, key);
-        mqttClient.publish(topic, 0, false, json, strlen(json));
       }
+    }
 
-      // Serial.print("Updates available, sending: ");
-      // Serial.println(json);
+    if (runBenchmark && mqttClient.connected())
+    {
+      doBenchmark();
+      runBenchmark = false;
+    }
 
-      // serializeJsonPretty(currentData, json);
-      // Serial.print("Current data: ");
-      // Serial.println(json);
+    if (sensorPresent)
+    {
+      doTempHumSensor();
     }
+
+    if (millis() > nextHeapMillis)
+    {
+      doHeapStats();
+      doTimingStats();
+
+      nextHeapMillis += heapRate_ms;
+    }
+
+    publisher.poll();
+
+    uint32_t pass = micros() - passStart;
+    if (pass > maxPublisherPass_us)
+    {
+      maxPublisherPass_us = pass;
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(publisherIdle_ms));
+  }
+}
+
+void doBenchmark()
+{
+  char json[MAX_BENCH_DOC];
+  StaticJsonDocument<MAX_BENCH_DOC> result;
+
+  VicEncoding::benchmark(&boardClock, result);
+  serializeJson(result, json);
+  mqttClient.publish("pmcg-esp32/benchmark", 0, false, json, strlen(json));
+}
+
+void doHeapStats()
+{
+  if (!mqttClient.connected())
+  {
+    return;
+  }
+
+  uint32_t freeHeap = ESP.getFreeHeap();
+  uint32_t maxAlloc = ESP.getMaxAllocHeap();
+  uint32_t fragmentation = (freeHeap > 0) ? 100 - ((uint64_t)maxAlloc * 100 / freeHeap) : 0;
+
+  char buf[150];
+  snprintf(buf, sizeof(buf),
+           "{\"free\": %lu, \"minFree\": %lu, \"maxAlloc\": %lu, \"fragmentation\": %lu, \"stackFree\": %lu}",
+           (unsigned long)freeHeap,
+           (unsigned long)ESP.getMinFreeHeap(),
+           (unsigned long)maxAlloc,
+           (unsigned long)fragmentation,
+           (unsigned long)uxTaskGetStackHighWaterMark(NULL));
+  mqttClient.publish("pmcg-esp32/heap", 0, false, buf, strlen(buf));
+}
+
+void doTimingStats()
+{
+  if (!mqttClient.connected())
+  {
+    return;
   }
+
+  char buf[150];
+  snprintf(buf, sizeof(buf),
+           "{\"passMax_us\": %lu, \"sensorMax_us\": %lu, \"sensorErrors\": %lu, \"fifoFill_us\": %lu}",
+           (unsigned long)maxPublisherPass_us,
+           (unsigned long)tempHumSensor.getMaxPoll_us(),
+           (unsigned long)tempHumSensor.getErrors(),
+           (unsigned long)(UART_FIFO_LEN * 10 * 1000000ULL / vicBaud));
+  mqttClient.publish("pmcg-esp32/timing", 0, false, buf, strlen(buf));
+
+  maxPublisherPass_us = 0;
+  tempHumSensor.resetMaxPoll();
 }
 
+void doReconnectStats()
+{
+  const VicReconnectStats &stats = reconnect.getStats();
+  const VicBrokerOffer &broker = reconnect.getBroker();
+
+  char buf[300];
+  snprintf(buf, sizeof(buf),
+           "{\"connects\": %lu, \"attempts\": %lu, \"discoveries\": %lu, \"last_ms\": %lu, \"max_ms\": %lu, \"cached\": %s, "
+           "\"broker\": \"%d.%d.%d.%d:%u\", \"rtt_us\": %lu, \"load\": %u, \"brokers\": %u}",
+           (unsigned long)stats.connects,
+           (unsigned long)stats.attempts,
+           (unsigned long)stats.discoveries,
+           (unsigned long)stats.last_ms,
+           (unsigned long)stats.max_ms,
+           stats.cached ? "true" : "false",
+           broker.broker.ip[0], broker.broker.ip[1], broker.broker.ip[2], broker.broker.ip[3],
+           (unsigned)broker.broker.port,
+           (unsigned long)broker.rtt_us,
+           (unsigned)broker.load,
+           (unsigned)reconnect.getBrokerCount());
+  mqttClient.publish("pmcg-esp32/reconnect", 0, false, buf, strlen(buf));
+}
+
+// With any config and definition errors from setup(), the board has no
+// console to report them on
+void doBootStats()
+{
+  char buf[MAX_VIC_BOOT_REPORT];
+  if (bootProfile.format(buf, sizeof(buf), resetReasonName(), defsSource) > 0)
+  {
+    mqttClient.publish("pmcg-esp32/boot", 0, false, buf, strlen(buf));
+  }
+}
+
+const char *resetReasonName()
+{
+  switch (esp_reset_reason())
+  {
+  case ESP_RST_POWERON:
+    return "poweron";
+  case ESP_RST_BROWNOUT:
+    return "brownout";
+  case ESP_RST_PANIC:
+    return "panic";
+  case ESP_RST_SW:
+    return "software";
+  case ESP_RST_INT_WDT:
+  case ESP_RST_TASK_WDT:
+  case ESP_RST_WDT:
+    return "watchdog";
+  case ESP_RST_EXT:
+    return "external";
+  case ESP_RST_DEEPSLEEP:
+    return "deepsleep";
+  default:
+    return "other";
+  }
+}
+
+// Goes out when either value moves past its deadband, or as a heartbeat
+// after maxInterval seconds. Offline readings go to the ring log.
 void doTempHumSensor()
 {
+  if (!tempHumSensor.poll(millis()))
+  {
+    return;
+  }
+
+  float humidity = tempHumSensor.getHumidity();
+  float temperature = tempHumSensor.getTemperature();
+  if (sensorReported &&
+      (fabsf(temperature - lastTemperature) <= sensorConfig.tempDeadband) &&
+      (fabsf(humidity - lastHumidity) <= sensorConfig.humidityDeadband) &&
+      (millis() - lastSensorMillis < sensorConfig.maxInterval_s * 1000UL))
+  {
+    return;
+  }
+
+  lastTemperature = temperature;
+  lastHumidity = humidity;
+  lastSensorMillis = millis();
+  sensorReported = true;
+
   if (mqttClient.connected())
   {
     char buf[20];
 
-    sprintf(buf, "%.02f", tempHumSensor.readHumidity());
+    sprintf(buf, "%.02f", humidity);
     mqttClient.publish("pmcg-esp32/humidity", 0, false, buf, strlen(buf));
 
-    sprintf(buf, "%.02f", tempHumSensor.readTemperature());
+    sprintf(buf, "%.02f", temperature);
     mqttClient.publish("pmcg-esp32/temperature", 0, false, buf, strlen(buf));
   }
-}
\ No newline at end of file
+  else
+  {
+    publisher.logValue(VIC_LOG_BOARD, VIC_LOG_HUMIDITY, lroundf(humidity * 100));
+    publisher.logValue(VIC_LOG_BOARD, VIC_LOG_TEMPERATURE, lroundf(temperature * 100));
+  }
+}
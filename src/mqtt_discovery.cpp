@@ -1,68 +1,134 @@
 #include <WiFi.h>
 #include <AsyncUDP.h>
+#include <Preferences.h>
 #include "mqtt_discovery.hpp"
 
-const uint8_t magic[] = {0xde, 0xad, 0xfa, 0xce,
-                         0xb0, 0x0b, 0x1e, 0xdd};
-const size_t magicLen = 8;
+// NVS namespace for the cached broker
+const char *prefsName = "broker";
 
 MQTTDiscovery::MQTTDiscovery(uint16_t discoveryPort, uint16_t localPort, AsyncMqttClient *mqttClient)
-    : _discoveryPort(discoveryPort), _localPort(localPort), _mqttClient(mqttClient)
+    : _discoveryPort(discoveryPort), _localPort(localPort), _mqttClient(mqttClient),
+      _dropped(false)
 {
+    portMUX_TYPE unlocked = portMUX_INITIALIZER_UNLOCKED;
+    _lock = unlocked;
 }
 
-void MQTTDiscovery::discoverAndConnectBroker()
+// Starts listening for discovery replies
+bool MQTTDiscovery::begin()
+{
+    if (!_udp.listen(_localPort))
+    {
+        return false;
+    }
+
+    _udp.onPacket([](void *arg, AsyncUDPPacket packet) {
+        MQTTDiscovery *theObjectFormerlyKnownAsThis = (MQTTDiscovery *)arg;
+        theObjectFormerlyKnownAsThis->onPacket(&packet);
+    },
+                  this);
+
+    _mqttClient->onDisconnect([this](AsyncMqttClientDisconnectReason reason) {
+        onDisconnect(reason);
+    });
+
+    return true;
+}
+
+bool MQTTDiscovery::connected()
+{
+    return _mqttClient->connected();
+}
+
+void MQTTDiscovery::connect(const VicBrokerAddr &broker)
+{
+    IPAddress brokerAddr = IPAddress(broker.ip[0], broker.ip[1], broker.ip[2], broker.ip[3]);
+    _mqttClient->setServer(brokerAddr, broker.port);
+    _mqttClient->connect();
+}
+
+void MQTTDiscovery::disconnect()
+{
+    _mqttClient->disconnect(true);
+}
+
+bool MQTTDiscovery::takeDropped()
+{
+    bool dropped = _dropped;
+    _dropped = false;
+    return dropped;
+}
+
+void MQTTDiscovery::sendDiscovery()
 {
     IPAddress myAddress = WiFi.localIP();
+    uint8_t ip[4] = {myAddress[0], myAddress[1], myAddress[2], myAddress[3]};
+
+    uint8_t data[VIC_DISCOVERY_REQUEST_LEN];
+    portENTER_CRITICAL(&_lock);
+    size_t len = _discovery.makeRequest(data, ip, _localPort, micros());
+    portEXIT_CRITICAL(&_lock);
 
-    uint8_t data[1024];
-    size_t len = 0;
-    for (int i = 0; i < magicLen; i++)
+    _udp.broadcastTo(data, len, _discoveryPort);
+}
+
+bool MQTTDiscovery::takeDiscovered(VicBrokerOffer &offer)
+{
+    portENTER_CRITICAL(&_lock);
+    bool found = _discovery.take(offer);
+    portEXIT_CRITICAL(&_lock);
+
+    return found;
+}
+
+bool MQTTDiscovery::loadBroker(VicBrokerAddr &broker)
+{
+    if (!_prefs.begin(prefsName, true))
     {
-        data[len++] = magic[i];
+        return false;
     }
-    data[len++] = myAddress[0];
-    data[len++] = myAddress[1];
-    data[len++] = myAddress[2];
-    data[len++] = myAddress[3];
-    data[len++] = (_localPort >> 8) & 0x00ff;
-    data[len++] = _localPort & 0x00ff;
-
-    if (_udp.listen(_localPort))
-    {
-        _udp.onPacket([](void *arg, AsyncUDPPacket packet) {
-            MQTTDiscovery *theObjectFormerlyKnownAsThis = (MQTTDiscovery *)arg;
-            theObjectFormerlyKnownAsThis->onPacket(&packet);
-        },
-                      this);
 
-        _udp.broadcastTo(data, len, _discoveryPort);
+    uint32_t ip = _prefs.getUInt("ip", 0);
+    broker.port = _prefs.getUShort("port", 0);
+    _prefs.end();
+
+    broker.ip[0] = ip >> 24;
+    broker.ip[1] = ip >> 16;
+    broker.ip[2] = ip >> 8;
+    broker.ip[3] = ip;
+    return broker.isValid();
+}
+
+// Only called when the broker changes, so NVS is rarely written
+void MQTTDiscovery::saveBroker(const VicBrokerAddr &broker)
+{
+    if (!_prefs.begin(prefsName, false))
+    {
+        return;
     }
+
+    _prefs.putUInt("ip", ((uint32_t)broker.ip[0] << 24) | (broker.ip[1] << 16) |
+                             (broker.ip[2] << 8) | broker.ip[3]);
+    _prefs.putUShort("port", broker.port);
+    _prefs.end();
 }
 
+//
+// Private functions
+//
+
 void MQTTDiscovery::onPacket(AsyncUDPPacket *packet)
 {
-    uint8_t *data = packet->data();
-    size_t dataLen = packet->length();
+    uint32_t now = micros();
 
-    if (dataLen == 14)
-    {
-        bool match = true;
-        for (int i = 0; i < magicLen; i++)
-        {
-            if (data[i] != magic[i])
-            {
-                match = false;
-                break;
-            }
-        }
-
-        if (match)
-        {
-            IPAddress brokerAddr = IPAddress(data[8], data[9], data[10], data[11]);
-            uint16_t brokerPort = (data[12] << 8) + data[13];
-            _mqttClient->setServer(brokerAddr, brokerPort);
-            _mqttClient->connect();
-        }
-    }
-}
\ No newline at end of file
+    portENTER_CRITICAL(&_lock);
+    _discovery.onReply(packet->data(), packet->length(), now);
+    portEXIT_CRITICAL(&_lock);
+}
+
+// Also called when a connect attempt fails, which saves waiting out the
+// connect timeout
+void MQTTDiscovery::onDisconnect(AsyncMqttClientDisconnectReason reason)
+{
+    _dropped = true;
+}
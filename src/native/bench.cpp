@@ -0,0 +1,424 @@
+//
+// Throughput benchmark for the "native_bench" PlatformIO environment.
+// Replays captures through the whole path, VEDirectText to
+// VicPublisher to an MQTT sink that only counts, as fast as it goes:
+//
+//   pio run -e native_bench
+//   .pio/build/native_bench/program [-c config.json] [-j] capture...
+//
+//   -c  config.json as on the board, for the publishing options and the
+//       inputs' topics and policies
+//   -j  also print the results as one line of JSON, to keep and compare
+//       between changes
+//
+// One capture per input, up to MAX_VIC_INPUTS. Each round feeds every
+// input up to the end of its next block and runs the publisher, then
+// moves the clock on a second, as if the devices sent a block each a
+// second. A block's latency is the time to read its bytes, process them
+// and publish what changed.
+//
+// Before the replay, each capture is decoded from memory on its own,
+// through VEDirectParser alone, then VEDirectText formatting every
+// changed field with the per-type decoder table, then the same again
+// with the type looked up by name for every field the way formatValue()
+// used to. These three are lines a second, without the publisher.
+//
+// Heap allocations are counted through malloc, so only with glibc.
+// tools/gen_ve_trace.py makes synthetic captures if there are no real
+// ones.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+#include "config.hpp"
+#include "ve_direct_file_source.hpp"
+#include "ve_direct_parser.hpp"
+#include "ve_direct_text.hpp"
+#include "vic_encoding.hpp"
+#include "vic_file_flash.hpp"
+#include "vic_ring_log.hpp"
+#include "vic_publisher.hpp"
+#include "vic_hal_host.hpp"
+
+#ifdef __GLIBC__
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+
+static uint64_t g_allocs = 0;
+
+extern "C" void *malloc(size_t size)
+{
+  g_allocs++;
+  return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+  g_allocs++;
+  return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+  g_allocs++;
+  return __libc_realloc(ptr, size);
+}
+#else
+static uint64_t g_allocs = 0;
+#endif
+
+// Counts the lines going past on their way to the parser
+class LineCountingSource : public VEDirectSource
+{
+public:
+  LineCountingSource(VEDirectSource *source)
+      : _source(source),
+        _lines(0),
+        _bytes(0) {}
+
+  size_t read(uint8_t *dest, size_t size, uint32_t timeout_ms) override
+  {
+    size_t len = _source->read(dest, size, timeout_ms);
+    for (size_t i = 0; i < len; i++)
+    {
+      _lines += (dest[i] == '\n');
+    }
+    _bytes += len;
+
+    return len;
+  }
+
+  size_t write(const uint8_t *data, size_t len) override
+  {
+    return _source->write(data, len);
+  }
+
+  bool atEnd() override
+  {
+    return _source->atEnd();
+  }
+
+  uint64_t getLines() { return _lines; }
+  uint64_t getBytes() { return _bytes; }
+
+private:
+  VEDirectSource *_source;
+  uint64_t _lines;
+  uint64_t _bytes;
+};
+
+VicHostClock wallClock;
+VicManualClock traceClock(1600000000);
+
+// Not mounted, so nothing is logged
+VicFileFlash logFlash;
+VicRingLog offlineLog(&logFlash);
+
+VicInput inputs[MAX_VIC_INPUTS];
+VEDirectFileSource files[MAX_VIC_INPUTS];
+
+Config config;
+
+void usage(const char *program)
+{
+  fprintf(stderr, "Usage: %s [-c config.json] [-j] capture...\n", program);
+  exit(2);
+}
+
+uint32_t blockCount(VicInput &input)
+{
+  return input.processor.getGoodBlocks() + input.processor.getBadBlocks();
+}
+
+// Lines a second through each decode stage, see the top of the file
+struct DecodeResult
+{
+  uint64_t lines;
+  double parse;
+  double typed;
+  double byName;
+};
+
+// The old dispatch resolved the type from its name with a strcmp()
+// chain on every field, this does the same ahead of the decoder table
+static VicType typeByName(const char *typeName)
+{
+  for (int t = 0; t < VIC_NUM_TYPES; t++)
+  {
+    if (strcmp(typeName, VictronDefs::typeName((VicType)t)) == 0)
+    {
+      return (VicType)t;
+    }
+  }
+
+  return VIC_TYPE_UNKNOWN;
+}
+
+static double decodePass(const std::vector<uint8_t> &data, uint64_t lines, int stage)
+{
+  // Enough passes to run for a measurable time on small captures
+  const int passes = std::max<size_t>(1, (4 << 20) / std::max<size_t>(1, data.size()));
+  char value[MAX_VALUE];
+  char units[16];
+  volatile size_t sink = 0;
+
+  uint32_t start = wallClock.micros();
+  for (int pass = 0; pass < passes; pass++)
+  {
+    if (stage == 0)
+    {
+      VEDirectParser parser;
+      for (size_t i = 0; i < data.size(); i++)
+      {
+        sink += parser.feed(data[i]);
+      }
+      continue;
+    }
+
+    VEDirectText text;
+    for (size_t i = 0; i < data.size(); i += 64)
+    {
+      text.handleBytes(&data[i], std::min<size_t>(64, data.size() - i));
+      for (int id = text.nextChange(-1); id >= 0; id = text.nextChange(id))
+      {
+        const VicFieldDef *fieldDef = VictronDefs::getField(id);
+        VicType type = (stage == 1) ? fieldDef->type : typeByName(VictronDefs::typeName(fieldDef->type));
+        VEDirectText::formatValue(value, sizeof(value), units, sizeof(units),
+                                  text.getSlot(id)->value, text.getText(id), type);
+        sink += value[0];
+      }
+      text.clearChanges();
+    }
+  }
+  uint32_t elapsed = wallClock.micros() - start;
+
+  return (double)lines * passes / ((elapsed > 0) ? elapsed / 1e6 : 1e-6);
+}
+
+static bool decodeCapture(const char *path, DecodeResult &result)
+{
+  FILE *f = fopen(path, "rb");
+  if (f == 0)
+  {
+    return false;
+  }
+  std::vector<uint8_t> data;
+  uint8_t buf[4096];
+  size_t len;
+  while ((len = fread(buf, 1, sizeof(buf), f)) > 0)
+  {
+    data.insert(data.end(), buf, buf + len);
+  }
+  fclose(f);
+
+  result.lines = std::count(data.begin(), data.end(), '\n');
+  result.parse = decodePass(data, result.lines, 0);
+  result.typed = decodePass(data, result.lines, 1);
+  result.byName = decodePass(data, result.lines, 2);
+
+  return true;
+}
+
+uint32_t percentile(const std::vector<uint32_t> &sorted, int pct)
+{
+  if (sorted.empty())
+  {
+    return 0;
+  }
+
+  return sorted[std::min(sorted.size() - 1, (sorted.size() * pct) / 100)];
+}
+
+int main(int argc, char **argv)
+{
+  const char *configPath = 0;
+  bool json = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "c:j")) != -1)
+  {
+    switch (opt)
+    {
+    case 'c':
+      configPath = optarg;
+      break;
+    case 'j':
+      json = true;
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+
+  size_t inputCount = argc - optind;
+  if ((inputCount == 0) || (inputCount > MAX_VIC_INPUTS))
+  {
+    usage(argv[0]);
+  }
+
+  VicPublishOptions options;
+  VicInputConfig inputConfigs[MAX_VIC_INPUTS];
+  size_t inputConfigCount = 0;
+  if (configPath != 0)
+  {
+    VicStdioFile configFile;
+    if ((!configFile.open(configPath)) || (!config.readConfig(configFile)))
+    {
+      fprintf(stderr, "Can't read %s\n", configPath);
+      return 1;
+    }
+
+    options.batch = config.getBatchPublish();
+    options.encoding = VicEncoding::formatFromName(config.getEncoding());
+    options.windowCount = config.getWindows(options.windows, MAX_VIC_WINDOWS);
+    options.raw = config.getRawPublish();
+    inputConfigCount = config.getInputs(inputConfigs, MAX_VIC_INPUTS);
+  }
+
+  std::vector<LineCountingSource *> sources;
+  for (size_t i = 0; i < inputCount; i++)
+  {
+    if (!files[i].open(argv[optind + i]))
+    {
+      fprintf(stderr, "Can't open %s\n", argv[optind + i]);
+      return 1;
+    }
+    sources.push_back(new LineCountingSource(&files[i]));
+    snprintf(inputs[i].mqttBase, sizeof(inputs[i].mqttBase), "pmcg-esp32/victron/input-%d", (int)i);
+    if (i < inputConfigCount)
+    {
+      // Captures stand in for the configured inputs in order
+      strncpy(inputs[i].mqttBase, inputConfigs[i].base, sizeof(inputs[i].mqttBase) - 1);
+      inputs[i].filter.loadPolicies(inputConfigs[i].policies);
+    }
+    inputs[i].source = sources[i];
+  }
+
+  if (!VicDerived::build())
+  {
+    fprintf(stderr, "%s\n", VicDerived::getBuildError());
+    return 1;
+  }
+
+  std::vector<DecodeResult> decodes(inputCount);
+  printf("%-24s %14s %14s %14s\n", "decode, lines/s", "parser", "typed", "by name");
+  for (size_t i = 0; i < inputCount; i++)
+  {
+    if (!decodeCapture(argv[optind + i], decodes[i]))
+    {
+      fprintf(stderr, "Can't read %s\n", argv[optind + i]);
+      return 1;
+    }
+    printf("%-24s %14.0f %14.0f %14.0f\n", argv[optind + i],
+           decodes[i].parse, decodes[i].typed, decodes[i].byName);
+  }
+
+  VicPrintMqttSink mqttSink(0);
+  VicPublisher publisher(&mqttSink, &traceClock, &offlineLog);
+  VicInput *inputList[MAX_VIC_INPUTS];
+  for (size_t i = 0; i < inputCount; i++)
+  {
+    inputList[i] = &inputs[i];
+  }
+  publisher.begin(inputList, inputCount, options);
+
+  // Preallocated so the samples don't show up as allocations
+  std::vector<uint32_t> latencies;
+  latencies.reserve(1 << 20);
+
+  uint64_t busy_us = 0;
+  uint64_t allocs = 0;
+  bool more = true;
+  while (more)
+  {
+    more = false;
+    for (size_t i = 0; i < inputCount; i++)
+    {
+      if (sources[i]->atEnd())
+      {
+        continue;
+      }
+      more = true;
+
+      uint64_t allocsBefore = g_allocs;
+      uint32_t start = wallClock.micros();
+
+      uint32_t blocksBefore = blockCount(inputs[i]);
+      while ((blockCount(inputs[i]) == blocksBefore) && (!sources[i]->atEnd()))
+      {
+        VicPublisher::readInput(inputs[i], 0);
+      }
+      publisher.poll();
+
+      uint32_t elapsed = wallClock.micros() - start;
+      allocs += g_allocs - allocsBefore;
+      busy_us += elapsed;
+
+      if ((blockCount(inputs[i]) != blocksBefore) && (latencies.size() < latencies.capacity()))
+      {
+        latencies.push_back(elapsed);
+      }
+    }
+
+    traceClock.advance(1000);
+  }
+
+  uint64_t lines = 0;
+  uint64_t bytes = 0;
+  uint64_t blocks = 0;
+  for (size_t i = 0; i < inputCount; i++)
+  {
+    lines += sources[i]->getLines();
+    bytes += sources[i]->getBytes();
+    blocks += blockCount(inputs[i]);
+    fprintf(stdout, "%s: %lu good blocks, %lu bad, %lu queue drops\n",
+            argv[optind + i],
+            (unsigned long)inputs[i].processor.getGoodBlocks(),
+            (unsigned long)inputs[i].processor.getBadBlocks(),
+            (unsigned long)inputs[i].queue.getDrops());
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  double seconds = (busy_us > 0) ? busy_us / 1e6 : 1e-6;
+  double perBlock = blocks ? (double)allocs / blocks : 0;
+
+  printf("%-12s %12s %14s\n", "", "total", "per second");
+  printf("%-12s %12lu %14.0f\n", "bytes", (unsigned long)bytes, bytes / seconds);
+  printf("%-12s %12lu %14.0f\n", "lines", (unsigned long)lines, lines / seconds);
+  printf("%-12s %12lu %14.0f\n", "blocks", (unsigned long)blocks, blocks / seconds);
+  printf("%-12s %12lu %14.0f\n", "publishes", (unsigned long)mqttSink.getPublishes(), mqttSink.getPublishes() / seconds);
+  printf("allocations  %.2f per block\n", perBlock);
+  printf("latency      p50 %u us, p99 %u us, max %u us\n",
+         percentile(latencies, 50), percentile(latencies, 99),
+         latencies.empty() ? 0 : latencies.back());
+  printf("At a block a second each, this host keeps up with %.0f devices\n", blocks / seconds);
+
+  if (json)
+  {
+    printf("{\"inputs\": %u, \"bytes\": %lu, \"lines\": %lu, \"blocks\": %lu, \"publishes\": %lu, "
+           "\"seconds\": %.6f, \"linesPerSec\": %.0f, \"blocksPerSec\": %.0f, \"publishesPerSec\": %.0f, "
+           "\"allocsPerBlock\": %.2f, \"p50_us\": %u, \"p99_us\": %u, \"decode\": [",
+           (unsigned)inputCount, (unsigned long)bytes, (unsigned long)lines, (unsigned long)blocks,
+           (unsigned long)mqttSink.getPublishes(), seconds, lines / seconds, blocks / seconds,
+           mqttSink.getPublishes() / seconds, perBlock,
+           percentile(latencies, 50), percentile(latencies, 99));
+    for (size_t i = 0; i < inputCount; i++)
+    {
+      printf("%s{\"capture\": \"%s\", \"parserLinesPerSec\": %.0f, \"typedLinesPerSec\": %.0f, \"byNameLinesPerSec\": %.0f}",
+             (i > 0) ? ", " : "", argv[optind + i], decodes[i].parse, decodes[i].typed, decodes[i].byName);
+    }
+    printf("]}\n");
+  }
+
+  for (size_t i = 0; i < inputCount; i++)
+  {
+    delete sources[i];
+  }
+
+  return 0;
+}
@@ -0,0 +1,210 @@
+//
+// Host entry point for the "native" PlatformIO environment. Feeds raw
+// VE.Direct captures through the same ingest and publishing code as the
+// board and prints what would be published, so the hot path can be run
+// under perf, valgrind and friends:
+//
+//   pio run -e native
+//   .pio/build/native/program [-c config.json] [-d victron_data_def.json]
+//                             [-l log.bin] [-o] [-q] capture...
+//
+//   -c  config.json as on the board, for the publishing options and the
+//       inputs' topics and policies
+//   -d  field definition overrides, as data/victron_data_def.json
+//   -l  offline log on a file standing in for the "vlog" partition
+//   -o  run as if the broker were away, so everything goes to the log
+//   -q  count messages instead of printing them
+//
+// One capture per input, up to MAX_VIC_INPUTS. Captures are read as fast
+// as they parse, not at the devices' 1 Hz.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "config.hpp"
+#include "ve_direct_text.hpp"
+#include "ve_direct_file_source.hpp"
+#include "vic_encoding.hpp"
+#include "vic_file_flash.hpp"
+#include "vic_ring_log.hpp"
+#include "vic_publisher.hpp"
+#include "vic_hal_host.hpp"
+
+// Same geometry as the "vlog" partition in partitions.csv
+const size_t logSize = 0x100000;
+const size_t logSectorSize = 4096;
+
+VicHostClock hostClock;
+VicFileFlash logFlash;
+VicRingLog offlineLog(&logFlash);
+
+VicInput inputs[MAX_VIC_INPUTS];
+VEDirectFileSource sources[MAX_VIC_INPUTS];
+
+Config config;
+
+void usage(const char *program)
+{
+  fprintf(stderr, "Usage: %s [-c config.json] [-d victron_data_def.json] [-l log.bin] [-o] [-q] capture...\n",
+          program);
+  exit(2);
+}
+
+int main(int argc, char **argv)
+{
+  const char *configPath = 0;
+  const char *defsPath = 0;
+  const char *logPath = 0;
+  bool offline = false;
+  bool quiet = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "c:d:l:oq")) != -1)
+  {
+    switch (opt)
+    {
+    case 'c':
+      configPath = optarg;
+      break;
+    case 'd':
+      defsPath = optarg;
+      break;
+    case 'l':
+      logPath = optarg;
+      break;
+    case 'o':
+      offline = true;
+      break;
+    case 'q':
+      quiet = true;
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+
+  size_t inputCount = argc - optind;
+  if ((inputCount == 0) || (inputCount > MAX_VIC_INPUTS))
+  {
+    usage(argv[0]);
+  }
+
+  VicPublishOptions options;
+  VicInputConfig inputConfigs[MAX_VIC_INPUTS];
+  size_t inputConfigCount = 0;
+  if (configPath != 0)
+  {
+    VicStdioFile configFile;
+    if ((!configFile.open(configPath)) || (!config.readConfig(configFile)))
+    {
+      fprintf(stderr, "Can't read %s\n", configPath);
+      return 1;
+    }
+
+    options.batch = config.getBatchPublish();
+    options.encoding = VicEncoding::formatFromName(config.getEncoding());
+    options.windowCount = config.getWindows(options.windows, MAX_VIC_WINDOWS);
+    options.raw = config.getRawPublish();
+    inputConfigCount = config.getInputs(inputConfigs, MAX_VIC_INPUTS);
+    options.replayRate = config.getReplayRate();
+    options.backlogSeries = config.getBacklogSeries();
+  }
+
+  if (defsPath != 0)
+  {
+    VicStdioFile defsFile;
+    if (!defsFile.open(defsPath))
+    {
+      fprintf(stderr, "Can't read %s\n", defsPath);
+      return 1;
+    }
+    else if (!VEDirectText::loadDefs(defsFile))
+    {
+      fprintf(stderr, "%s\n", VEDirectText::getLoadDefsError());
+      return 1;
+    }
+  }
+
+  if (!VicDerived::build())
+  {
+    fprintf(stderr, "%s\n", VicDerived::getBuildError());
+    return 1;
+  }
+
+  if (logPath != 0)
+  {
+    if ((!logFlash.open(logPath, logSize, logSectorSize)) || (!offlineLog.mount()))
+    {
+      fprintf(stderr, "Can't mount the log on %s\n", logPath);
+      return 1;
+    }
+  }
+
+  for (size_t i = 0; i < inputCount; i++)
+  {
+    if (!sources[i].open(argv[optind + i]))
+    {
+      fprintf(stderr, "Can't open %s\n", argv[optind + i]);
+      return 1;
+    }
+    snprintf(inputs[i].mqttBase, sizeof(inputs[i].mqttBase), "pmcg-esp32/victron/input-%d", (int)i);
+    if (i < inputConfigCount)
+    {
+      // Captures stand in for the configured inputs in order
+      strncpy(inputs[i].mqttBase, inputConfigs[i].base, sizeof(inputs[i].mqttBase) - 1);
+      inputs[i].filter.loadPolicies(inputConfigs[i].policies);
+    }
+    inputs[i].source = &sources[i];
+  }
+
+  VicPrintMqttSink mqttSink(quiet ? 0 : stdout);
+  mqttSink.setConnected(!offline);
+
+  VicPublisher publisher(&mqttSink, &hostClock, &offlineLog);
+  VicInput *inputList[MAX_VIC_INPUTS];
+  for (size_t i = 0; i < inputCount; i++)
+  {
+    inputList[i] = &inputs[i];
+  }
+  publisher.begin(inputList, inputCount, options);
+
+  // Round robin over the captures, a chunk each, draining after every
+  // round so the queues never back up
+  uint32_t start = hostClock.millis();
+  bool more = true;
+  while (more)
+  {
+    more = false;
+    for (size_t i = 0; i < inputCount; i++)
+    {
+      if (!sources[i].atEnd())
+      {
+        VicPublisher::readInput(inputs[i], 0);
+        more = true;
+      }
+    }
+
+    publisher.poll();
+  }
+  offlineLog.flush();
+  uint32_t elapsed = hostClock.millis() - start;
+
+  for (size_t i = 0; i < inputCount; i++)
+  {
+    fprintf(stderr, "%s: %lu bytes, %lu good blocks, %lu bad, %lu queue drops\n",
+            argv[optind + i],
+            (unsigned long)sources[i].getBytesRead(),
+            (unsigned long)inputs[i].processor.getGoodBlocks(),
+            (unsigned long)inputs[i].processor.getBadBlocks(),
+            (unsigned long)inputs[i].queue.getDrops());
+  }
+  fprintf(stderr, "%lu messages, %lu bytes, %lu logged, in %lu ms\n",
+          (unsigned long)mqttSink.getPublishes(),
+          (unsigned long)mqttSink.getBytes(),
+          (unsigned long)offlineLog.getBacklog(),
+          (unsigned long)elapsed);
+
+  return 0;
+}
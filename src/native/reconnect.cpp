@@ -0,0 +1,318 @@
+//
+// Broker reconnect exercise for the "native_reconnect" PlatformIO
+// environment. Runs VicReconnect, as on the board, over plain sockets
+// against tools/broker_standin.py, which answers discovery and stands in
+// for the MQTT broker, and can be told to drop replies and restart:
+//
+//   python tools/broker_standin.py --restart-every 20 --down 5 --move
+//   pio run -e native_reconnect
+//   .pio/build/native_reconnect/program [-b address] [-p port]
+//                                       [-s cache] [-t seconds]
+//
+//   -b  where discovery requests go, 127.0.0.1 unless given. Broadcast
+//       addresses need a real interface, not loopback.
+//   -p  the discovery port, 2112 as on the board
+//   -s  file standing in for NVS, to keep the broker between runs
+//   -t  stop after this many seconds, otherwise run until killed
+//
+// With several stand-ins behind tools/discovery_agent.py it shows which
+// broker is picked and the failover when one goes away.
+//
+// Prints every state change and offer and, on each connect, the stats
+// the board publishes on pmcg-esp32/reconnect. Round trips are only as
+// fine as the 10 ms poll here, the board times replies as they arrive.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "vic_discovery.hpp"
+#include "vic_reconnect.hpp"
+#include "vic_hal_host.hpp"
+
+const uint16_t localPort = 2113;
+const uint32_t keepAlive_ms = 30000;
+
+static const char *stateNames[] = {"connected", "connecting", "discovery", "backoff"};
+
+VicHostClock hostClock;
+
+// VicBrokerLink over POSIX sockets. The MQTT side only goes as far as
+// CONNECT, CONNACK and keep alive pings, which is all a reconnect needs.
+class SocketBrokerLink : public VicBrokerLink
+{
+public:
+  SocketBrokerLink(const char *discoveryAddress, uint16_t discoveryPort, const char *cachePath)
+      : _discoveryAddress(discoveryAddress), _discoveryPort(discoveryPort), _cachePath(cachePath),
+        _udp(-1), _tcp(-1), _sentConnect(false), _connected(false), _dropped(false), _lastPingMillis(0)
+  {
+  }
+
+  bool begin()
+  {
+    _udp = socket(AF_INET, SOCK_DGRAM, 0);
+    int on = 1;
+    setsockopt(_udp, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on));
+    setsockopt(_udp, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    fcntl(_udp, F_SETFL, O_NONBLOCK);
+
+    sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(localPort);
+    return bind(_udp, (sockaddr *)&local, sizeof(local)) == 0;
+  }
+
+  bool connected() override
+  {
+    if (_tcp < 0)
+    {
+      return false;
+    }
+
+    if (!_sentConnect)
+    {
+      int error = 0;
+      socklen_t len = sizeof(error);
+      getsockopt(_tcp, SOL_SOCKET, SO_ERROR, &error, &len);
+      if ((error != 0) && (error != EINPROGRESS))
+      {
+        disconnect();
+        _dropped = true;
+        return false;
+      }
+
+      // clean session, 60 s keep alive, client ID "pmcg-host"
+      static const uint8_t connect[] = {0x10, 21, 0, 4, 'M', 'Q', 'T', 'T', 4, 0x02, 0, 60,
+                                        0, 9, 'p', 'm', 'c', 'g', '-', 'h', 'o', 's', 't'};
+      if (send(_tcp, connect, sizeof(connect), MSG_NOSIGNAL) == (ssize_t)sizeof(connect))
+      {
+        _sentConnect = true;
+        _lastPingMillis = hostClock.millis();
+      }
+      return false;
+    }
+
+    uint8_t data[64];
+    ssize_t len = recv(_tcp, data, sizeof(data), MSG_DONTWAIT);
+    if ((len == 0) || ((len < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK)))
+    {
+      disconnect();
+      _dropped = true;
+      return false;
+    }
+    if ((len >= 4) && (!_connected) && (data[0] == 0x20) && (data[3] == 0))
+    {
+      _connected = true;
+    }
+
+    if (_connected && (hostClock.millis() - _lastPingMillis >= keepAlive_ms))
+    {
+      static const uint8_t ping[] = {0xc0, 0};
+      send(_tcp, ping, sizeof(ping), MSG_NOSIGNAL);
+      _lastPingMillis = hostClock.millis();
+    }
+
+    return _connected;
+  }
+
+  void connect(const VicBrokerAddr &broker) override
+  {
+    disconnect();
+
+    _tcp = socket(AF_INET, SOCK_STREAM, 0);
+    fcntl(_tcp, F_SETFL, O_NONBLOCK);
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    memcpy(&addr.sin_addr, broker.ip, 4);
+    addr.sin_port = htons(broker.port);
+    ::connect(_tcp, (sockaddr *)&addr, sizeof(addr));
+
+    printf("%8.3f connecting to %d.%d.%d.%d:%d\n", hostClock.millis() / 1000.0,
+           broker.ip[0], broker.ip[1], broker.ip[2], broker.ip[3], broker.port);
+  }
+
+  void disconnect() override
+  {
+    if (_tcp >= 0)
+    {
+      close(_tcp);
+    }
+    _tcp = -1;
+    _sentConnect = false;
+    _connected = false;
+  }
+
+  bool takeDropped() override
+  {
+    bool dropped = _dropped;
+    _dropped = false;
+    return dropped;
+  }
+
+  void sendDiscovery() override
+  {
+    static const uint8_t loopback[4] = {127, 0, 0, 1};
+    uint8_t data[VIC_DISCOVERY_REQUEST_LEN];
+    size_t len = _discovery.makeRequest(data, loopback, localPort, hostClock.micros());
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    inet_pton(AF_INET, _discoveryAddress, &addr.sin_addr);
+    addr.sin_port = htons(_discoveryPort);
+    sendto(_udp, data, len, 0, (sockaddr *)&addr, sizeof(addr));
+
+    printf("%8.3f discovery sent\n", hostClock.millis() / 1000.0);
+  }
+
+  bool takeDiscovered(VicBrokerOffer &offer) override
+  {
+    uint8_t data[64];
+    ssize_t len;
+    while ((len = recv(_udp, data, sizeof(data), 0)) > 0)
+    {
+      _discovery.onReply(data, len, hostClock.micros());
+    }
+
+    if (!_discovery.take(offer))
+    {
+      return false;
+    }
+
+    printf("%8.3f offer from %d.%d.%d.%d:%d, v%d, rtt %u us, load %d, score %u\n",
+           hostClock.millis() / 1000.0,
+           offer.broker.ip[0], offer.broker.ip[1], offer.broker.ip[2], offer.broker.ip[3],
+           offer.broker.port, offer.version, (unsigned)offer.rtt_us, offer.load,
+           (unsigned)VicReconnect::score(offer));
+    return true;
+  }
+
+  bool loadBroker(VicBrokerAddr &broker) override
+  {
+    FILE *f = (_cachePath != 0) ? fopen(_cachePath, "r") : 0;
+    if (f == 0)
+    {
+      return false;
+    }
+
+    unsigned int ip[4];
+    unsigned int port;
+    if (fscanf(f, "%u.%u.%u.%u %u", &ip[0], &ip[1], &ip[2], &ip[3], &port) == 5)
+    {
+      for (int i = 0; i < 4; i++)
+      {
+        broker.ip[i] = ip[i];
+      }
+      broker.port = port;
+    }
+    fclose(f);
+
+    return broker.isValid();
+  }
+
+  void saveBroker(const VicBrokerAddr &broker) override
+  {
+    FILE *f = (_cachePath != 0) ? fopen(_cachePath, "w") : 0;
+    if (f != 0)
+    {
+      fprintf(f, "%d.%d.%d.%d %d\n", broker.ip[0], broker.ip[1], broker.ip[2], broker.ip[3], broker.port);
+      fclose(f);
+    }
+  }
+
+private:
+  const char *_discoveryAddress;
+  uint16_t _discoveryPort;
+  const char *_cachePath;
+  int _udp;
+  int _tcp;
+  bool _sentConnect;
+  bool _connected;
+  bool _dropped;
+  uint32_t _lastPingMillis;
+  VicDiscovery _discovery;
+};
+
+static void usage(const char *name)
+{
+  fprintf(stderr, "Usage: %s [-b address] [-p port] [-s cache] [-t seconds]\n", name);
+  exit(1);
+}
+
+int main(int argc, char **argv)
+{
+  const char *discoveryAddress = "127.0.0.1";
+  uint16_t discoveryPort = 2112;
+  const char *cachePath = 0;
+  uint32_t runFor_s = 0;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "b:p:s:t:")) != -1)
+  {
+    switch (opt)
+    {
+    case 'b':
+      discoveryAddress = optarg;
+      break;
+    case 'p':
+      discoveryPort = atoi(optarg);
+      break;
+    case 's':
+      cachePath = optarg;
+      break;
+    case 't':
+      runFor_s = atoi(optarg);
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+
+  SocketBrokerLink link(discoveryAddress, discoveryPort, cachePath);
+  if (!link.begin())
+  {
+    fprintf(stderr, "Can't listen on UDP port %d\n", localPort);
+    return 1;
+  }
+
+  VicReconnect reconnect(&link, &hostClock);
+  reconnect.begin();
+
+  VicReconnectState lastState = reconnect.getState();
+  printf("%8.3f %s\n", hostClock.millis() / 1000.0, stateNames[lastState]);
+  while ((runFor_s == 0) || (hostClock.millis() < runFor_s * 1000))
+  {
+    if (reconnect.poll())
+    {
+      const VicReconnectStats &stats = reconnect.getStats();
+      const VicBrokerOffer &broker = reconnect.getBroker();
+      printf("%8.3f connected to %d.%d.%d.%d:%d, connects %u, attempts %u, discoveries %u, took %u ms (max %u), %s\n",
+             hostClock.millis() / 1000.0,
+             broker.broker.ip[0], broker.broker.ip[1], broker.broker.ip[2], broker.broker.ip[3], broker.broker.port,
+             (unsigned)stats.connects, (unsigned)stats.attempts, (unsigned)stats.discoveries,
+             (unsigned)stats.last_ms, (unsigned)stats.max_ms, stats.cached ? "known broker" : "discovered");
+    }
+
+    if (reconnect.getState() != lastState)
+    {
+      lastState = reconnect.getState();
+      printf("%8.3f %s\n", hostClock.millis() / 1000.0, stateNames[lastState]);
+    }
+    fflush(stdout);
+
+    usleep(10000);
+  }
+
+  return 0;
+}
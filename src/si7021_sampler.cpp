@@ -0,0 +1,189 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include "si7021_sampler.hpp"
+
+// Commands, see the Si7021-A20 datasheet
+#define SI7021_MEASURE_RH_NO_HOLD 0xF5
+#define SI7021_READ_PREVIOUS_TEMP 0xE0
+#define SI7021_RESET 0xFE
+
+// CRC-8, x^8 + x^5 + x^4 + 1, initialised to 0
+static uint8_t si7021Crc(const uint8_t *data, size_t len)
+{
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : (crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+Si7021Sampler::Si7021Sampler()
+    : _wire(0), _state(SI7021_IDLE), _samples(1), _interval_ms(1000),
+      _nextSampleMillis(0), _startMillis(0),
+      _count(0), _sumHumidity(0), _sumTemperature(0),
+      _temperature(0), _humidity(0),
+      _maxPoll_us(0), _errors(0)
+{
+}
+
+// Resets the sensor, the only wait is the 15 ms it takes to come back
+bool Si7021Sampler::begin(TwoWire *wire, uint8_t samples, uint16_t interval_ms)
+{
+    _wire = wire;
+    _samples = ((samples > 0) && (samples <= MAX_SI7021_SAMPLES)) ? samples : 1;
+    _interval_ms = interval_ms;
+
+    _wire->begin();
+    _wire->beginTransmission(SI7021_ADDRESS);
+    _wire->write(SI7021_RESET);
+    if (_wire->endTransmission() != 0)
+    {
+        return false;
+    }
+    delay(15);
+
+    _state = SI7021_IDLE;
+    _nextSampleMillis = millis();
+    return true;
+}
+
+bool Si7021Sampler::poll(uint32_t now_ms)
+{
+    uint32_t start = micros();
+    bool ready = false;
+
+    if (_state == SI7021_IDLE)
+    {
+        if ((int32_t)(now_ms - _nextSampleMillis) >= 0)
+        {
+            _nextSampleMillis += _interval_ms;
+            if ((int32_t)(now_ms - _nextSampleMillis) >= 0)
+            {
+                // Fell behind, don't try to catch up
+                _nextSampleMillis = now_ms + _interval_ms;
+            }
+
+            if (startConversion())
+            {
+                _startMillis = now_ms;
+                _state = SI7021_CONVERTING;
+            }
+            else
+            {
+                _errors++;
+            }
+        }
+    }
+    else if (now_ms - _startMillis >= SI7021_CONVERSION_MS)
+    {
+        // The sensor NAKs its address until the conversion is done
+        if (collect())
+        {
+            _state = SI7021_IDLE;
+            if (_count >= _samples)
+            {
+                _humidity = ((125.0f * _sumHumidity) / ((float)_count * 65536)) - 6;
+                _humidity = (_humidity < 0) ? 0 : ((_humidity > 100) ? 100 : _humidity);
+                _temperature = ((175.72f * _sumTemperature) / ((float)_count * 65536)) - 46.85f;
+
+                _count = 0;
+                _sumHumidity = 0;
+                _sumTemperature = 0;
+                ready = true;
+            }
+        }
+        else if (now_ms - _startMillis >= SI7021_TIMEOUT_MS)
+        {
+            _state = SI7021_IDLE;
+            _errors++;
+        }
+    }
+
+    uint32_t elapsed = micros() - start;
+    if (elapsed > _maxPoll_us)
+    {
+        _maxPoll_us = elapsed;
+    }
+
+    return ready;
+}
+
+float Si7021Sampler::getTemperature()
+{
+    return _temperature;
+}
+
+float Si7021Sampler::getHumidity()
+{
+    return _humidity;
+}
+
+uint32_t Si7021Sampler::getMaxPoll_us()
+{
+    return _maxPoll_us;
+}
+
+uint32_t Si7021Sampler::getErrors()
+{
+    return _errors;
+}
+
+void Si7021Sampler::resetMaxPoll()
+{
+    _maxPoll_us = 0;
+}
+
+//
+// Private functions
+//
+
+bool Si7021Sampler::startConversion()
+{
+    _wire->beginTransmission(SI7021_ADDRESS);
+    _wire->write(SI7021_MEASURE_RH_NO_HOLD);
+    return _wire->endTransmission() == 0;
+}
+
+// False while the conversion is still running. A reading with a bad
+// CRC is dropped and the next sample goes ahead as usual.
+bool Si7021Sampler::collect()
+{
+    uint8_t data[3];
+    if (_wire->requestFrom((uint8_t)SI7021_ADDRESS, (uint8_t)3) != 3)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < 3; i++)
+    {
+        data[i] = _wire->read();
+    }
+    if (si7021Crc(data, 2) != data[2])
+    {
+        _errors++;
+        return true;
+    }
+    uint16_t humidity = (data[0] << 8) | data[1];
+
+    // The temperature measured for the RH compensation, no new conversion
+    _wire->beginTransmission(SI7021_ADDRESS);
+    _wire->write(SI7021_READ_PREVIOUS_TEMP);
+    if ((_wire->endTransmission() != 0) ||
+        (_wire->requestFrom((uint8_t)SI7021_ADDRESS, (uint8_t)2) != 2))
+    {
+        _errors++;
+        return true;
+    }
+    uint16_t temperature = _wire->read() << 8;
+    temperature |= _wire->read();
+
+    _sumHumidity += humidity;
+    _sumTemperature += temperature;
+    _count++;
+    return true;
+}
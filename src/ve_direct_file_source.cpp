@@ -0,0 +1,67 @@
+#include <stdio.h>
+#include "ve_direct_file_source.hpp"
+
+VEDirectFileSource::VEDirectFileSource()
+    : _file(0), _bytesRead(0), _bytesWritten(0)
+{
+}
+
+VEDirectFileSource::~VEDirectFileSource()
+{
+    close();
+}
+
+bool VEDirectFileSource::open(const char *path)
+{
+    close();
+
+    _file = fopen(path, "rb");
+    _bytesRead = 0;
+    _bytesWritten = 0;
+
+    return _file != 0;
+}
+
+void VEDirectFileSource::close()
+{
+    if (_file != 0)
+    {
+        fclose(_file);
+        _file = 0;
+    }
+}
+
+size_t VEDirectFileSource::read(uint8_t *dest, size_t size, uint32_t timeout_ms)
+{
+    if (_file == 0)
+    {
+        return 0;
+    }
+
+    size_t len = fread(dest, 1, size, _file);
+    _bytesRead += len;
+
+    return len;
+}
+
+size_t VEDirectFileSource::write(const uint8_t *data, size_t len)
+{
+    _bytesWritten += len;
+
+    return len;
+}
+
+bool VEDirectFileSource::atEnd()
+{
+    return (_file == 0) || (feof(_file) != 0);
+}
+
+uint32_t VEDirectFileSource::getBytesRead()
+{
+    return _bytesRead;
+}
+
+uint32_t VEDirectFileSource::getBytesWritten()
+{
+    return _bytesWritten;
+}
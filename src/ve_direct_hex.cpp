@@ -0,0 +1,195 @@
+#include "ve_direct_hex.hpp"
+
+static const char g_hexDigits[] = "0123456789ABCDEF";
+
+// Registers that duplicate a text protocol field, with the factor that
+// converts the register's units to the text field's units. Polling
+// these updates the field between text blocks.
+static const VicHexRegister g_vicHexRegisters[] = {
+    {0x0201, "CS", 1, false, 1, 1},     // Device state
+    {0x0FFE, "TTG", 2, false, 1, 1},    // Time to go, min
+    {0x0FFF, "SOC", 2, false, 1, 10},   // State of charge, 0.01 %
+    {0xED7D, "VS", 2, false, 10, 1},    // Aux voltage, 0.01 V
+    {0xED8C, "I", 4, true, 1, 1},       // Battery current, mA
+    {0xED8D, "V", 2, true, 10, 1},      // Main voltage, 0.01 V
+    {0xED8E, "P", 2, true, 1, 1},       // Battery power, W
+    {0xEDBB, "VPV", 2, false, 10, 1},   // Panel voltage, 0.01 V
+    {0xEDBC, "PPV", 4, false, 1, 100},  // Panel power, 0.01 W
+    {0xEDD5, "V", 2, false, 10, 1},     // Charger voltage, 0.01 V
+    {0xEDD7, "I", 2, false, 100, 1},    // Charger current, 0.1 A
+    {0xEDDA, "ERR", 1, false, 1, 1},    // Charger error code
+    {0xEEFF, "CE", 4, true, 100, 1},    // Consumed Ah, 0.1 Ah
+};
+
+static int hexNibble(char c)
+{
+    if ((c >= '0') && (c <= '9'))
+    {
+        return c - '0';
+    }
+    if ((c >= 'A') && (c <= 'F'))
+    {
+        return c - 'A' + 10;
+    }
+    if ((c >= 'a') && (c <= 'f'))
+    {
+        return c - 'a' + 10;
+    }
+
+    return -1;
+}
+
+bool VEDirectHex::decode(const char *hex, size_t len, VEDirectHexFrame *frame)
+{
+    // Command digit, at least the checksum byte, and whole byte pairs
+    if ((len < 3) || ((len % 2) != 1))
+    {
+        return false;
+    }
+
+    int command = hexNibble(hex[0]);
+    if (command < 0)
+    {
+        return false;
+    }
+
+    size_t count = (len - 1) / 2;
+    if (count - 1 > VED_HEX_MAX_DATA)
+    {
+        return false;
+    }
+
+    uint8_t sum = command;
+    for (size_t i = 0; i < count; i++)
+    {
+        int hi = hexNibble(hex[1 + (i * 2)]);
+        int lo = hexNibble(hex[2 + (i * 2)]);
+        if ((hi < 0) || (lo < 0))
+        {
+            return false;
+        }
+
+        uint8_t b = (hi << 4) | lo;
+        sum += b;
+        if (i < count - 1)
+        {
+            frame->data[i] = b;
+        }
+    }
+
+    if (sum != VED_HEX_CHECK)
+    {
+        return false;
+    }
+
+    frame->command = command;
+    frame->len = count - 1;
+
+    return true;
+}
+
+size_t VEDirectHex::encode(char *dest, size_t size,
+                           uint8_t command,
+                           const uint8_t *data, size_t len)
+{
+    // ':' + command + data + checksum + '\n' + terminator
+    if (size < (len * 2) + 6)
+    {
+        return 0;
+    }
+
+    size_t pos = 0;
+    uint8_t sum = command & 0x0f;
+    dest[pos++] = ':';
+    dest[pos++] = g_hexDigits[command & 0x0f];
+    for (size_t i = 0; i < len; i++)
+    {
+        dest[pos++] = g_hexDigits[data[i] >> 4];
+        dest[pos++] = g_hexDigits[data[i] & 0x0f];
+        sum += data[i];
+    }
+
+    uint8_t check = VED_HEX_CHECK - sum;
+    dest[pos++] = g_hexDigits[check >> 4];
+    dest[pos++] = g_hexDigits[check & 0x0f];
+    dest[pos++] = '\n';
+    dest[pos] = '\0';
+
+    return pos;
+}
+
+size_t VEDirectHex::encodeGet(char *dest, size_t size, uint16_t reg)
+{
+    uint8_t data[3] = {(uint8_t)(reg & 0xff), (uint8_t)(reg >> 8), 0};
+
+    return encode(dest, size, VED_HEX_CMD_GET, data, sizeof(data));
+}
+
+size_t VEDirectHex::encodeSet(char *dest, size_t size, uint16_t reg,
+                              const uint8_t *value, size_t len)
+{
+    uint8_t data[VED_HEX_MAX_DATA];
+    if (len + 3 > VED_HEX_MAX_DATA)
+    {
+        return 0;
+    }
+
+    data[0] = reg & 0xff;
+    data[1] = reg >> 8;
+    data[2] = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        data[3 + i] = value[i];
+    }
+
+    return encode(dest, size, VED_HEX_CMD_SET, data, len + 3);
+}
+
+bool VEDirectHex::isRegisterFrame(const VEDirectHexFrame *frame)
+{
+    return ((frame->command == VED_HEX_RSP_GET) ||
+            (frame->command == VED_HEX_RSP_SET) ||
+            (frame->command == VED_HEX_RSP_ASYNC)) &&
+           (frame->len >= 3);
+}
+
+uint16_t VEDirectHex::getRegister(const VEDirectHexFrame *frame)
+{
+    return frame->data[0] | (frame->data[1] << 8);
+}
+
+uint8_t VEDirectHex::getFlags(const VEDirectHexFrame *frame)
+{
+    return frame->data[2];
+}
+
+const uint8_t *VEDirectHex::getValue(const VEDirectHexFrame *frame, size_t *len)
+{
+    *len = frame->len - 3;
+
+    return frame->data + 3;
+}
+
+const VicHexRegister *VEDirectHex::findRegister(uint16_t reg)
+{
+    size_t lo = 0;
+    size_t hi = sizeof(g_vicHexRegisters) / sizeof(g_vicHexRegisters[0]);
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if (g_vicHexRegisters[mid].reg == reg)
+        {
+            return &(g_vicHexRegisters[mid]);
+        }
+        else if (reg < g_vicHexRegisters[mid].reg)
+        {
+            hi = mid;
+        }
+        else
+        {
+            lo = mid + 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include <Arduino.h>
+#include "ve_direct_mux.hpp"
+
+VEDirectMux::VEDirectMux()
+    : _uart(0), _selectCount(0), _channel(0)
+{
+}
+
+bool VEDirectMux::begin(VEDirectUART *uart, const int8_t *selectPins, size_t selectCount)
+{
+    if ((selectCount == 0) || (selectCount > MAX_VED_MUX_SELECT))
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < selectCount; i++)
+    {
+        if (selectPins[i] < 0)
+        {
+            return false;
+        }
+
+        _selectPins[i] = selectPins[i];
+        pinMode(_selectPins[i], OUTPUT);
+    }
+
+    _uart = uart;
+    _selectCount = selectCount;
+    select(0);
+
+    return true;
+}
+
+void VEDirectMux::select(uint8_t channel)
+{
+    _channel = channel;
+    for (size_t i = 0; i < _selectCount; i++)
+    {
+        digitalWrite(_selectPins[i], (channel >> i) & 1);
+    }
+
+    // The switch settles in well under a microsecond, a byte takes
+    // about 500 us at 19200 baud, so a byte in flight is at worst cut
+    // short and the parser drops it with its block
+    _uart->flush();
+}
+
+uint8_t VEDirectMux::getChannel()
+{
+    return _channel;
+}
+
+size_t VEDirectMux::getChannelCount()
+{
+    return (size_t)1 << _selectCount;
+}
+
+VEDirectSource *VEDirectMux::getSource()
+{
+    return _uart;
+}
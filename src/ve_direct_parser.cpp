@@ -0,0 +1,213 @@
+#include <string.h>
+#include "ve_direct_parser.hpp"
+
+VEDirectParser::VEDirectParser()
+    : _goodBlocks(0), _badBlocks(0), _resyncs(0), _droppedHex(0)
+{
+    reset();
+}
+
+void VEDirectParser::reset()
+{
+    _state = ST_IDLE;
+    _hexPrevState = ST_IDLE;
+    _label[0] = '\0';
+    _value[0] = '\0';
+    _labelLen = 0;
+    _valueLen = 0;
+    _hex[0] = '\0';
+    _hexLen = 0;
+    _hexOverflow = false;
+    _checksum = 0;
+    _blockBad = false;
+    _synced = false;
+}
+
+const char *VEDirectParser::getLabel()
+{
+    return _label;
+}
+
+const char *VEDirectParser::getValue()
+{
+    return _value;
+}
+
+// Frame contents between the ':' and the '\n'
+const char *VEDirectParser::getHex()
+{
+    return _hex;
+}
+
+size_t VEDirectParser::getHexLen()
+{
+    return _hexLen;
+}
+
+uint32_t VEDirectParser::getGoodBlocks()
+{
+    return _goodBlocks;
+}
+
+uint32_t VEDirectParser::getBadBlocks()
+{
+    return _badBlocks;
+}
+
+uint32_t VEDirectParser::getResyncs()
+{
+    return _resyncs;
+}
+
+uint32_t VEDirectParser::getDroppedHex()
+{
+    return _droppedHex;
+}
+
+VEDirectParser::Event VEDirectParser::feed(uint8_t c)
+{
+    // HEX frames can be spliced into the text stream at any point (even
+    // mid-field) and are not part of the text block checksum
+    if (_state == ST_HEX)
+    {
+        if (c == '\n')
+        {
+            _state = _hexPrevState;
+            _hex[_hexLen] = '\0';
+            if ((!_hexOverflow) && (_hexLen > 0))
+            {
+                return EVENT_HEX;
+            }
+            _droppedHex++;
+        }
+        else if (c == '\r')
+        {
+            // Tolerate "\r\n" endings
+        }
+        else if (_hexLen < VED_MAX_HEX - 1)
+        {
+            _hex[_hexLen++] = c;
+        }
+        else
+        {
+            _hexOverflow = true;
+        }
+        return EVENT_NONE;
+    }
+    if ((c == ':') && (_state != ST_CHECKSUM))
+    {
+        _hexPrevState = _state;
+        _hexLen = 0;
+        _hexOverflow = false;
+        _state = ST_HEX;
+        return EVENT_NONE;
+    }
+
+    _checksum += c;
+
+    switch (_state)
+    {
+    case ST_IDLE:
+        if ((c != '\r') && (c != '\n'))
+        {
+            _label[0] = c;
+            _labelLen = 1;
+            _state = ST_LABEL;
+        }
+        break;
+
+    case ST_LABEL:
+        if (c == '\t')
+        {
+            _label[_labelLen] = '\0';
+            _valueLen = 0;
+            _state = (strcmp(_label, "Checksum") == 0) ? ST_CHECKSUM : ST_VALUE;
+        }
+        else if ((c == '\r') || (c == '\n') || (_labelLen >= VED_MAX_LABEL - 1))
+        {
+            resync();
+            if (c == '\n')
+            {
+                _state = ST_IDLE;
+            }
+        }
+        else
+        {
+            _label[_labelLen++] = c;
+        }
+        break;
+
+    case ST_VALUE:
+        if ((c == '\r') || (c == '\n'))
+        {
+            // '\r' starts the next field's "\r\n"
+            _value[_valueLen] = '\0';
+            _state = ST_IDLE;
+            if (_synced)
+            {
+                return EVENT_FIELD;
+            }
+        }
+        else if (_valueLen >= VED_MAX_VALUE - 1)
+        {
+            resync();
+        }
+        else
+        {
+            _value[_valueLen++] = c;
+        }
+        break;
+
+    case ST_CHECKSUM:
+        // The checksum byte can be any value, even '\r' or '\n'
+        _state = ST_IDLE;
+        return endBlock();
+
+    case ST_RESYNC:
+        if (c == '\n')
+        {
+            _state = ST_IDLE;
+        }
+        break;
+
+    case ST_HEX:
+        break;
+    }
+
+    return EVENT_NONE;
+}
+
+VEDirectParser::Event VEDirectParser::endBlock()
+{
+    Event event = EVENT_NONE;
+
+    if (_synced)
+    {
+        if ((_checksum == 0) && (!_blockBad))
+        {
+            _goodBlocks++;
+            event = EVENT_BLOCK_GOOD;
+        }
+        else
+        {
+            _badBlocks++;
+            event = EVENT_BLOCK_BAD;
+        }
+    }
+
+    // Anything before the first Checksum is a partial block, fields are
+    // only reported from here on
+    _synced = true;
+
+    _checksum = 0;
+    _blockBad = false;
+
+    return event;
+}
+
+void VEDirectParser::resync()
+{
+    _resyncs++;
+    _blockBad = true;
+    _state = ST_RESYNC;
+}
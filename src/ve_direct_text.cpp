@@ -1,739 +1,1037 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <ArduinoJson.h>
-#include <SPIFFS.h>
 #include "ve_direct_text.hpp"
-
-#define CALL_MEMBER_FN(object, ptrToMember) ((object).*(ptrToMember))
+#include "victron_defs.hpp"
+#include "ve_direct_hex.hpp"
 
 //
 // Static data & functions
 //
 
-DynamicJsonDocument VEDirectText::g_victronDefs(32768);
 char VEDirectText::g_loadDefsError[MAX_ERROR_LEN];
 
-bool VEDirectText::loadDefs(File dataFile)
+// Field and map definitions are compiled in (see victron_defs.hpp),
+// the data file only overrides field types, adds new fields, derives
+// fields from others or replaces fields' publish policies. Derived
+// fields have to be compiled again afterwards, see VicDerived::build().
+bool VEDirectText::loadDefs(VicFile &dataFile)
 {
     g_loadDefsError[0] = 0;
-    DeserializationError error = deserializeJson(g_victronDefs, dataFile);
+
+    StaticJsonDocument<192> filter;
+    filter["fields"][0]["name"] = true;
+    filter["fields"][0]["type"] = true;
+    filter["fields"][0]["expr"] = true;
+    filter["derived"][0]["name"] = true;
+    filter["derived"][0]["type"] = true;
+    filter["derived"][0]["expr"] = true;
+    filter["policies"] = true;
+
+    DynamicJsonDocument defs(MAX_DEFS_DOC);
+    DeserializationError error = deserializeJson(defs, dataFile,
+                                                 DeserializationOption::Filter(filter));
     if (error)
     {
         sprintf(g_loadDefsError, "VEDirectText::loadDefs: Error parsing data file '%s' [%s]", dataFile.name(), error.c_str());
         return false;
     }
 
-    return true;
-}
+    const char *sections[] = {"fields", "derived"};
+    for (const char *section : sections)
+    {
+        JsonArray fieldDefs = defs[section];
+        for (JsonVariant v : fieldDefs)
+        {
+            const char *name = v["name"] | "";
+            const char *typeName = v["type"] | "";
+            if (!VictronDefs::addField(name, VictronDefs::typeFromName(typeName)))
+            {
+                sprintf(g_loadDefsError, "VEDirectText::loadDefs: Bad field definition '%s' [%s] in '%s'", name, typeName, dataFile.name());
+                return false;
+            }
 
-const char *VEDirectText::getLoadDefsError()
-{
-    return g_loadDefsError;
-}
+            // An expression the field already has takes no override slot
+            const char *expr = v["expr"];
+            const char *current = VictronDefs::getExpr(VictronDefs::lookupField(name)->id);
+            if ((expr != 0) && ((current == 0) || (strcmp(expr, current) != 0)) &&
+                !VictronDefs::setExpr(name, expr))
+            {
+                sprintf(g_loadDefsError, "VEDirectText::loadDefs: Bad expression for '%s' [%s] in '%s'", name, expr, dataFile.name());
+                return false;
+            }
+        }
+    }
 
-//
-// Normal functions
-//
+    // "default" as in the generator, for fields without a policy of
+    // their own. Keys left out keep the field's current policy, and only
+    // a policy that differs from it takes an override slot, so the file
+    // the firmware was built from adds none.
+    JsonObject policies = defs["policies"];
+    JsonObject defaultPolicy = policies["default"];
+    if (!defaultPolicy.isNull())
+    {
+        VictronDefs::setDefaultPolicy(parsePolicy(defaultPolicy, *VictronDefs::getDefaultPolicy()));
+    }
 
-VicPair::VicPair()
-    : key(""), value("") {}
+    for (JsonPair kv : policies)
+    {
+        const char *name = kv.key().c_str();
+        if (strcmp(name, "default") == 0)
+        {
+            continue;
+        }
 
-VicFieldListener::VicFieldListener()
-    : fieldName("") {}
+        const VicFieldDef *fieldDef = VictronDefs::lookupField(name);
+        JsonObject p = kv.value();
+        if ((fieldDef == 0) || p.isNull())
+        {
+            sprintf(g_loadDefsError, "VEDirectText::loadDefs: Bad policy '%s' in '%s'", name, dataFile.name());
+            return false;
+        }
 
-VEDirectText::VEDirectText()
-    : _lastError("")
-{
-    addFieldListener("vpv", &VEDirectText::vpvUpdated);
-    addFieldListener("ppv", &VEDirectText::ppvUpdated);
-    addFieldListener("v", &VEDirectText::vUpdated);
-    addFieldListener("i", &VEDirectText::iUpdated);
-    addFieldListener("p", &VEDirectText::pUpdated);
-}
+        const VicPolicy *current = VictronDefs::getPolicy(fieldDef->id);
+        VicPolicy policy = parsePolicy(p, *current);
+        if (!VictronDefs::samePolicy(policy, *current) && !VictronDefs::setPolicy(name, policy))
+        {
+            sprintf(g_loadDefsError, "VEDirectText::loadDefs: Too many policy overrides at '%s' in '%s'", name, dataFile.name());
+            return false;
+        }
+    }
 
-const char *VEDirectText::getLastError()
-{
-    return _lastError;
+    return true;
 }
 
-VicPair *VEDirectText::findKey(const char *key)
+// CRC-32 of the whole data file, to tell whether overrides cached from
+// it are still current without parsing it
+uint32_t VEDirectText::defsChecksum(VicFile &dataFile)
 {
-    for (int i = 0; i < MAX_VIC_PAIR; i++)
+    uint32_t crc = 0xffffffff;
+    char buf[256];
+    size_t len;
+    while ((len = dataFile.readBytes(buf, sizeof(buf))) > 0)
     {
-        if (strcmp(key, _currentData[i].key) == 0)
+        for (size_t i = 0; i < len; i++)
         {
-            return (&(_currentData[i]));
+            crc ^= (uint8_t)buf[i];
+            for (int bit = 0; bit < 8; bit++)
+            {
+                crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+            }
         }
     }
 
-    return (0);
+    return ~crc;
+}
+
+const char *VEDirectText::getLoadDefsError()
+{
+    return g_loadDefsError;
 }
 
-VicPair *VEDirectText::findEmptyPair()
+// One entry of a "policies" section, keys left out keep base's values
+VicPolicy VEDirectText::parsePolicy(JsonObject p, const VicPolicy &base)
 {
-    for (int i = 0; i < MAX_VIC_PAIR; i++)
+    VicPolicy policy = {0, 0, 0, 0};
+    if (!(p["onChange"] | false))
     {
-        if (_currentData[i].key[0] == '\0')
-        {
-            return (&(_currentData[i]));
-        }
+        policy = base;
+        policy.deadband = p["deadband"] | policy.deadband;
+        policy.deadbandPctTenth = (p["deadbandPct"] | (policy.deadbandPctTenth / 10.0f)) * 10 + 0.5f;
+        policy.minInterval_s = p["minInterval"] | policy.minInterval_s;
+        policy.maxInterval_s = p["maxInterval"] | policy.maxInterval_s;
     }
 
-    return (0);
+    return policy;
 }
 
-void VEDirectText::addFieldListener(const char *fieldName,
-                                    VicFieldListenerCallback callback)
+//
+// Value decoders, one per VicType. Each writes the formatted value and
+// units into the caller's buffers, from the parsed value or, for text
+// types, the value as received.
+//
+
+typedef void (*VicDecoder)(char *destValue, size_t sizeValue,
+                           char *destUnits, size_t sizeUnits,
+                           int32_t value, const char *text);
+
+static void formatBitmask(char *destValue,
+                          size_t sizeValue,
+                          int32_t reasons,
+                          VicMapId map,
+                          const char *none)
 {
-    // Find empty slot
-    for (int i = 0; i < MAX_VIC_FIELD_LISTENER; i++)
+    if (reasons == 0)
     {
-        if (_fieldListeners[i].fieldName[0] == '\0')
-        {
-            // Empty slot, set fields and return
-            strcpy(_fieldListeners[i].fieldName, fieldName);
-            _fieldListeners[i].callback = callback;
-            return;
-        }
+        snprintf(destValue, sizeValue, "%s", none);
+        return;
     }
-}
 
-void VEDirectText::callFieldListener(const char *fieldName,
-                                     DynamicJsonDocument &updates,
-                                     const char *fieldValue,
-                                     const char *unitsValue)
-{
-    for (int i = 0; i < MAX_VIC_FIELD_LISTENER; i++)
+    const VicMap *m = VictronDefs::getMap(map);
+    const char *format = "%s";
+    destValue[0] = '\0';
+    for (size_t i = 0; (i < m->count) && (sizeValue > 1); i++)
     {
-        if (strcmp(_fieldListeners[i].fieldName, fieldName) == 0)
+        if ((m->entries[i].key & reasons) != 0)
         {
-            CALL_MEMBER_FN(*this, _fieldListeners[i].callback)
-            (updates, fieldValue, unitsValue);
+            int charsWritten = snprintf(destValue,
+                                        sizeValue,
+                                        format,
+                                        m->entries[i].value);
+            if (charsWritten >= (int)sizeValue)
+            {
+                break;
+            }
+            destValue += charsWritten;
+            sizeValue -= charsWritten;
+            format = " | %s";
         }
     }
 }
 
-void VEDirectText::updateCurrentData(DynamicJsonDocument &updates,
-                                     const char *fieldKey,
-                                     const char *fieldValue,
-                                     const char *unitsKey,
-                                     const char *unitsValue)
+static void formatMapped(char *destValue,
+                         size_t sizeValue,
+                         int32_t code,
+                         VicMapId map,
+                         const char *unknownFormat)
 {
-    int fieldChanged = 0;
-    int unitsChanged = 0;
-
-    VicPair *fieldKeyPair = findKey(fieldKey);
-    if (fieldKeyPair != 0)
+    const char *mapped = VictronDefs::lookupMap(map, code);
+    if (mapped != 0)
     {
-        if (strcmp(fieldValue, fieldKeyPair->value) != 0)
-        {
-            // Value for field key changed
-            fieldChanged = 1;
-
-            // Update current data and updates
-            strcpy(fieldKeyPair->value, fieldValue);
-            updates[(char *)fieldKey]["value"] = (char *)fieldValue;
-        }
+        snprintf(destValue, sizeValue, "%s", mapped);
     }
     else
     {
-        // Field key/value added
-        fieldChanged = 1;
-
-        // Add to current data and updates
-        fieldKeyPair = findEmptyPair();
-        if (fieldKeyPair != 0)
-        {
-            strcpy(fieldKeyPair->key, fieldKey);
-            strcpy(fieldKeyPair->value, fieldValue);
-        }
-        updates[(char *)fieldKey]["value"] = (char *)fieldValue;
+        snprintf(destValue, sizeValue, unknownFormat, (long)code);
     }
+}
 
-    VicPair *unitsKeyPair = findKey(unitsKey);
-    if (unitsKeyPair != 0)
+// Integer value as a decimal of value / 10^decimals, formatted without
+// going through float so no digits are lost
+static void formatFixed(char *destValue, size_t sizeValue,
+                        int32_t value,
+                        int decimals)
+{
+    uint32_t divisor = 1;
+    for (int i = 0; i < decimals; i++)
     {
-        if (strcmp(unitsValue, unitsKeyPair->value) != 0)
-        {
-            // Value for units key changed
-            unitsChanged = 1;
+        divisor *= 10;
+    }
 
-            // If the field key/value aren't already in the update, add them
-            if (!fieldChanged)
-            {
-                updates[(char *)fieldKey]["value"] = (char *)fieldValue;
-            }
+    uint32_t magnitude = (value < 0) ? -(int64_t)value : value;
+    snprintf(destValue, sizeValue, "%s%lu.%0*lu",
+             (value < 0) ? "-" : "",
+             (unsigned long)(magnitude / divisor),
+             decimals,
+             (unsigned long)(magnitude % divisor));
+}
 
-            // Add units key/value to currentData and updates
-            strcpy(unitsKeyPair->value, unitsValue);
-            updates[(char *)fieldKey]["units"] = (char *)unitsValue;
-        }
+// Integer value with optional switch to the larger unit at 1000
+static void formatAutoRange(char *destValue, size_t sizeValue,
+                            char *destUnits, size_t sizeUnits,
+                            int32_t value,
+                            const char *smallUnits,
+                            const char *largeUnits)
+{
+    if (abs(value) < 1000)
+    {
+        snprintf(destValue, sizeValue, "%ld", (long)value);
+        snprintf(destUnits, sizeUnits, "%s", smallUnits);
     }
     else
     {
-        // Units key/value added
-        unitsChanged = 1;
+        formatFixed(destValue, sizeValue, value, 3);
+        snprintf(destUnits, sizeUnits, "%s", largeUnits);
+    }
+}
 
-        // If the field key/value aren't already in the update, add them
-        if (!fieldChanged)
-        {
-            updates[(char *)fieldKey]["value"] = (char *)fieldValue;
-        }
+static void formatPlain(char *destValue, size_t sizeValue,
+                        char *destUnits, size_t sizeUnits,
+                        int32_t value,
+                        const char *units)
+{
+    snprintf(destValue, sizeValue, "%ld", (long)value);
+    snprintf(destUnits, sizeUnits, "%s", units);
+}
 
-        // Add units key/value to currentData and updates
-        unitsKeyPair = findEmptyPair();
-        if (unitsKeyPair != 0)
-        {
-            strcpy(unitsKeyPair->key, unitsKey);
-            strcpy(unitsKeyPair->value, unitsValue);
-        }
-        updates[(char *)fieldKey]["units"] = (char *)unitsValue;
-    }
+static void formatScaled(char *destValue, size_t sizeValue,
+                         char *destUnits, size_t sizeUnits,
+                         int32_t value,
+                         int decimals,
+                         const char *units)
+{
+    formatFixed(destValue, sizeValue, value, decimals);
+    snprintf(destUnits, sizeUnits, "%s", units);
+}
+
+static void decodeText(char *destValue, size_t sizeValue,
+                       char *destUnits, size_t sizeUnits,
+                       int32_t value, const char *text)
+{
+    snprintf(destValue, sizeValue, "%s", text);
+    destUnits[0] = '\0';
+}
+
+static void decodeNone(char *destValue, size_t sizeValue,
+                       char *destUnits, size_t sizeUnits,
+                       int32_t value, const char *text)
+{
+    formatPlain(destValue, sizeValue, destUnits, sizeUnits, value, "");
+}
+
+static void decodePct(char *destValue, size_t sizeValue,
+                      char *destUnits, size_t sizeUnits,
+                      int32_t value, const char *text)
+{
+    formatPlain(destValue, sizeValue, destUnits, sizeUnits, value, "%");
+}
+
+static void decodePctTenth(char *destValue, size_t sizeValue,
+                           char *destUnits, size_t sizeUnits,
+                           int32_t value, const char *text)
+{
+    formatScaled(destValue, sizeValue, destUnits, sizeUnits, value, 1, "%");
+}
+
+static void decodeVoltCenti(char *destValue, size_t sizeValue,
+                            char *destUnits, size_t sizeUnits,
+                            int32_t value, const char *text)
+{
+    formatScaled(destValue, sizeValue, destUnits, sizeUnits, value, 2, "V");
+}
 
-    // If the field changed but the units didn't, incllude the units
-    // in the update anyway
-    if (fieldChanged && (!unitsChanged))
+static void decodeKwhCenti(char *destValue, size_t sizeValue,
+                           char *destUnits, size_t sizeUnits,
+                           int32_t value, const char *text)
+{
+    if (abs(value) < 100)
     {
-        updates[(char *)fieldKey]["units"] = (char *)unitsValue;
+        snprintf(destValue, sizeValue, "%ld", (long)value * 10);
+        snprintf(destUnits, sizeUnits, "Wh");
     }
-
-    // Call field listener, if defined for this field
-    if (fieldChanged || unitsChanged)
+    else
     {
-        callFieldListener(fieldKey, updates, fieldValue, unitsValue);
+        formatFixed(destValue, sizeValue, value, 2);
+        snprintf(destUnits, sizeUnits, "kWh");
     }
 }
 
-void VEDirectText::handleLine(DynamicJsonDocument &updates, char *line)
+static void decodeAmpTenth(char *destValue, size_t sizeValue,
+                           char *destUnits, size_t sizeUnits,
+                           int32_t value, const char *text)
 {
-    char *field = strtok(line, "\t");
-    char *value = strtok(0, "\r");
+    formatScaled(destValue, sizeValue, destUnits, sizeUnits, value, 1, "A");
+}
 
-    if ((field != 0) && (value != 0))
-    {
-        JsonArray fieldDefs = g_victronDefs["fields"];
-        const char *vicType = "??";
-#define FT_LEN 100
-        char formattedValue[FT_LEN];
-        char formattedUnits[FT_LEN];
-        for (JsonVariant v : fieldDefs)
-        {
-            JsonObject fieldDef = v.as<JsonObject>();
+static void decodeWatt(char *destValue, size_t sizeValue,
+                       char *destUnits, size_t sizeUnits,
+                       int32_t value, const char *text)
+{
+    formatPlain(destValue, sizeValue, destUnits, sizeUnits, value, "W");
+}
 
-            if (strcmp(field, fieldDef["name"]) == 0)
-            {
-                vicType = fieldDef["type"];
-                formatValue(formattedValue, FT_LEN,
-                            formattedUnits, FT_LEN,
-                            value, vicType);
+static void decodeVA(char *destValue, size_t sizeValue,
+                     char *destUnits, size_t sizeUnits,
+                     int32_t value, const char *text)
+{
+    formatPlain(destValue, sizeValue, destUnits, sizeUnits, value, "VA");
+}
 
-                char *tmp = field;
-                while (*tmp != 0)
-                {
-                    *tmp = tolower(*tmp);
-                    tmp++;
-                }
-                char unitsKey[50];
-                sprintf(unitsKey, "%s_units", field);
+static void decodeDegC(char *destValue, size_t sizeValue,
+                       char *destUnits, size_t sizeUnits,
+                       int32_t value, const char *text)
+{
+    formatPlain(destValue, sizeValue, destUnits, sizeUnits, value, "°C");
+}
 
-                updateCurrentData(updates,
-                                  field, formattedValue,
-                                  unitsKey, formattedUnits);
-            }
-        }
+static void decodeFw(char *destValue, size_t sizeValue,
+                     char *destUnits, size_t sizeUnits,
+                     int32_t value, const char *text)
+{
+    int candidate = 0;
+    int offset = 0;
+    if (text[0] == 'C')
+    {
+        candidate = 1;
+        offset = 1;
     }
+    char major = text[offset];
+    const char *minor = (major != '\0') ? text + offset + 1 : "";
+    snprintf(destValue, sizeValue, candidate ? "%c.%s (RC)" : "%c.%s", major, minor);
+    destUnits[0] = '\0';
 }
 
-void VEDirectText::formatValue(char *destValue,
-                               size_t sizeValue,
-                               char *destUnits,
-                               size_t sizeUnits,
-                               const char *value,
-                               const char *vicType)
+static void decodeMa(char *destValue, size_t sizeValue,
+                     char *destUnits, size_t sizeUnits,
+                     int32_t value, const char *text)
 {
-    if (strcmp(vicType, "%") == 0)
+    formatAutoRange(destValue, sizeValue, destUnits, sizeUnits, value, "mA", "A");
+}
+
+static void decodeMah(char *destValue, size_t sizeValue,
+                      char *destUnits, size_t sizeUnits,
+                      int32_t value, const char *text)
+{
+    formatAutoRange(destValue, sizeValue, destUnits, sizeUnits, value, "mAh", "Ah");
+}
+
+static void decodeMv(char *destValue, size_t sizeValue,
+                     char *destUnits, size_t sizeUnits,
+                     int32_t value, const char *text)
+{
+    formatAutoRange(destValue, sizeValue, destUnits, sizeUnits, value, "mV", "V");
+}
+
+static void decodeMapAr(char *destValue, size_t sizeValue,
+                        char *destUnits, size_t sizeUnits,
+                        int32_t value, const char *text)
+{
+    formatBitmask(destValue, sizeValue, value, VIC_MAP_AR, "No alarm");
+    destUnits[0] = '\0';
+}
+
+static void decodeMapOr(char *destValue, size_t sizeValue,
+                        char *destUnits, size_t sizeUnits,
+                        int32_t value, const char *text)
+{
+    formatBitmask(destValue, sizeValue, value, VIC_MAP_OR, "On");
+    destUnits[0] = '\0';
+}
+
+static void decodeMapCs(char *destValue, size_t sizeValue,
+                        char *destUnits, size_t sizeUnits,
+                        int32_t value, const char *text)
+{
+    formatMapped(destValue, sizeValue, value, VIC_MAP_CS, "Unknown state (%ld)");
+    destUnits[0] = '\0';
+}
+
+static void decodeMapErr(char *destValue, size_t sizeValue,
+                         char *destUnits, size_t sizeUnits,
+                         int32_t value, const char *text)
+{
+    formatMapped(destValue, sizeValue, value, VIC_MAP_ERR, "Unknown error (%ld)");
+    destUnits[0] = '\0';
+}
+
+static void decodeMapMode(char *destValue, size_t sizeValue,
+                          char *destUnits, size_t sizeUnits,
+                          int32_t value, const char *text)
+{
+    formatMapped(destValue, sizeValue, value, VIC_MAP_MODE, "Unknown mode (%ld)");
+    destUnits[0] = '\0';
+}
+
+static void decodeMapMppt(char *destValue, size_t sizeValue,
+                          char *destUnits, size_t sizeUnits,
+                          int32_t value, const char *text)
+{
+    formatMapped(destValue, sizeValue, value, VIC_MAP_MPPT, "Unknown mppt (%ld)");
+    destUnits[0] = '\0';
+}
+
+static void decodeMapPid(char *destValue, size_t sizeValue,
+                         char *destUnits, size_t sizeUnits,
+                         int32_t value, const char *text)
+{
+    formatMapped(destValue, sizeValue, value, VIC_MAP_PID, "Unknown product (0x%lX)");
+    destUnits[0] = '\0';
+}
+
+static void decodeMinutes(char *destValue, size_t sizeValue,
+                          char *destUnits, size_t sizeUnits,
+                          int32_t value, const char *text)
+{
+    formatPlain(destValue, sizeValue, destUnits, sizeUnits, value, "min");
+}
+
+static void decodeOnOff(char *destValue, size_t sizeValue,
+                        char *destUnits, size_t sizeUnits,
+                        int32_t value, const char *text)
+{
+    snprintf(destValue, sizeValue, "%s", value ? "ON" : "OFF");
+    destUnits[0] = '\0';
+}
+
+static void decodeSeconds(char *destValue, size_t sizeValue,
+                          char *destUnits, size_t sizeUnits,
+                          int32_t value, const char *text)
+{
+    formatPlain(destValue, sizeValue, destUnits, sizeUnits, value, "sec");
+}
+
+// Indexed by VicType, keep in enum order
+static const VicDecoder g_vicDecoders[] = {
+    decodeText,      // VIC_TYPE_UNKNOWN
+    decodePct,       // VIC_TYPE_PCT
+    decodePctTenth,  // VIC_TYPE_PCT_TENTH
+    decodeVoltCenti, // VIC_TYPE_VOLT_CENTI
+    decodeKwhCenti,  // VIC_TYPE_KWH_CENTI
+    decodeAmpTenth,  // VIC_TYPE_AMP_TENTH
+    decodeWatt,      // VIC_TYPE_WATT
+    decodeVA,        // VIC_TYPE_VA
+    decodeNone,      // VIC_TYPE_COUNTER
+    decodeDegC,      // VIC_TYPE_DEG_C
+    decodeFw,        // VIC_TYPE_FW
+    decodeText,      // VIC_TYPE_FWE
+    decodeMa,        // VIC_TYPE_MA
+    decodeMah,       // VIC_TYPE_MAH
+    decodeMv,        // VIC_TYPE_MV
+    decodeMapAr,     // VIC_TYPE_MAP_AR
+    decodeMapOr,     // VIC_TYPE_MAP_OR
+    decodeMapCs,     // VIC_TYPE_MAP_CS
+    decodeMapErr,    // VIC_TYPE_MAP_ERR
+    decodeMapMode,   // VIC_TYPE_MAP_MODE
+    decodeMapMppt,   // VIC_TYPE_MAP_MPPT
+    decodeMapPid,    // VIC_TYPE_MAP_PID
+    decodeMinutes,   // VIC_TYPE_MINUTES
+    decodeOnOff,     // VIC_TYPE_ONOFF
+    decodeNone,      // VIC_TYPE_DAY_SEQ
+    decodeSeconds,   // VIC_TYPE_SECONDS
+    decodeText,      // VIC_TYPE_SERIAL
+    decodeText,      // VIC_TYPE_STRING
+};
+
+static_assert(sizeof(g_vicDecoders) / sizeof(g_vicDecoders[0]) == VIC_NUM_TYPES,
+              "g_vicDecoders must have one entry per VicType");
+
+// Parse a received value for a numeric type, false if it isn't a number
+// (some devices send "---" for values they don't have). PID and OR come
+// as 0x... hex, OR with bit 31 in use, so unsigned values keep all 32
+// bits.
+static bool parseValue(const char *text, VicType type, int32_t *value)
+{
+    if (type == VIC_TYPE_ONOFF)
+    {
+        *value = (strcmp(text, "ON") == 0) ? 1 : 0;
+        return true;
+    }
+
+    char *end;
+    int base = ((type == VIC_TYPE_MAP_PID) || (type == VIC_TYPE_MAP_OR)) ? 16 : 10;
+    uint32_t parsed = (text[0] == '-') ? (uint32_t)strtol(text, &end, base)
+                                       : (uint32_t)strtoul(text, &end, base);
+    if ((end == text) || (*end != '\0'))
     {
-        snprintf(destValue, sizeValue, "%s", value);
-        snprintf(destUnits, sizeUnits, "%%");
+        return false;
     }
-    else if (strcmp(vicType, "0.1 %") == 0)
+
+    *value = (int32_t)parsed;
+    return true;
+}
+
+//
+// Normal functions
+//
+
+VicPair::VicPair()
+    : key(""), value("") {}
+
+VicSlot::VicSlot()
+    : value(0), flags(0) {}
+
+VicTextSlot::VicTextSlot()
+    : fieldId(VIC_NO_FIELD), text("") {}
+
+VicRegisterSlot::VicRegisterSlot()
+    : reg(0), changed(false), len(0) {}
+
+VicDelta::VicDelta()
+    : kind(VIC_DELTA_FIELD), fieldId(VIC_NO_FIELD), reg(0), value(0), len(0) {}
+
+VEDirectText::VEDirectText()
+    : _lastError(""),
+      _anyChanged(false),
+      _blockEnded(false),
+      _blockFieldCount(0),
+      _blockOverflow(false),
+      _badHexFrames(0)
+{
+    memset(_changed, 0, sizeof(_changed));
+    memset(_derivedInputs, 0, sizeof(_derivedInputs));
+}
+
+const char *VEDirectText::getLastError()
+{
+    return _lastError;
+}
+
+const VicSlot *VEDirectText::getSlot(uint8_t fieldId)
+{
+    if ((fieldId >= MAX_VIC_FIELDS) ||
+        ((_slots[fieldId].flags & VIC_SLOT_SET) == 0))
     {
-        float tmp = (float)atoi(value);
-        snprintf(destValue, sizeValue, "%.1f", tmp / 10);
-        snprintf(destUnits, sizeUnits, "%%");
+        return 0;
     }
-    else if (strcmp(vicType, "0.01 V") == 0)
+
+    return &(_slots[fieldId]);
+}
+
+const char *VEDirectText::getText(uint8_t fieldId)
+{
+    VicTextSlot *textSlot = findTextSlot(fieldId, false);
+    if (textSlot == 0)
     {
-        float tmp = (float)atoi(value);
-        snprintf(destValue, sizeValue, "%.2f", tmp / 100);
-        snprintf(destUnits, sizeUnits, "V");
+        return "";
     }
-    else if (strcmp(vicType, "0.01 kWh") == 0)
+
+    return textSlot->text;
+}
+
+VicTextSlot *VEDirectText::findTextSlot(uint8_t fieldId, bool create)
+{
+    for (int i = 0; i < MAX_VIC_TEXT_SLOTS; i++)
     {
-        float tmp = (float)atoi(value);
-        if (fabs(tmp) < 100.0)
+        if (_textSlots[i].fieldId == fieldId)
         {
-            snprintf(destValue, sizeValue, "%d", (int)(tmp * 10));
-            snprintf(destUnits, sizeUnits, "Wh");
+            return &(_textSlots[i]);
         }
-        else
+        if (create && (_textSlots[i].fieldId == VIC_NO_FIELD))
         {
-            snprintf(destValue, sizeValue, "%.2f", tmp / 100);
-            snprintf(destUnits, sizeUnits, "kWh");
+            _textSlots[i].fieldId = fieldId;
+            return &(_textSlots[i]);
         }
     }
-    else if (strcmp(vicType, "0.1 A") == 0)
+
+    return 0;
+}
+
+void VEDirectText::updateValue(const VicFieldDef *fieldDef,
+                               int32_t value,
+                               bool reported)
+{
+    if (fieldDef->id >= MAX_VIC_FIELDS)
     {
-        float tmp = (float)atoi(value);
-        snprintf(destValue, sizeValue, "%.1f", tmp / 10);
-        snprintf(destUnits, sizeUnits, "A");
+        return;
     }
-    else if (strcmp(vicType, "W") == 0)
+
+    VicSlot *slot = &(_slots[fieldDef->id]);
+    if (reported)
     {
-        snprintf(destValue, sizeValue, "%s", value);
-        snprintf(destUnits, sizeUnits, "W");
+        slot->flags |= VIC_SLOT_REPORTED;
     }
-    else if (strcmp(vicType, "count") == 0)
+
+    if (((slot->flags & VIC_SLOT_SET) != 0) && (slot->value == value))
     {
-        snprintf(destValue, sizeValue, "%s", value);
-        destUnits[0] = '\0';
+        return;
     }
-    else if (strcmp(vicType, "deg_C") == 0)
+
+    slot->value = value;
+    slot->flags |= VIC_SLOT_SET;
+
+    markChanged(fieldDef->id);
+}
+
+void VEDirectText::updateText(const VicFieldDef *fieldDef,
+                              const char *text)
+{
+    if (fieldDef->id >= MAX_VIC_FIELDS)
     {
-        snprintf(destValue, sizeValue, "%s", value);
-        snprintf(destUnits, sizeUnits, "°C");
+        return;
     }
-    else if (strcmp(vicType, "fw") == 0)
+
+    VicTextSlot *textSlot = findTextSlot(fieldDef->id, true);
+    if (textSlot == 0)
     {
-        int candidate = 0;
-        int offset = 0;
-        if (value[0] == 'C')
-        {
-            candidate = 1;
-            offset = 1;
-        }
-        char major = value[offset];
-        char minor[10];
-        strcpy(minor, value + offset + 1);
-        if (candidate)
-        {
-            snprintf(destValue, sizeValue, "%c.%s (RC)", major, minor);
-            destUnits[0] = '\0';
-        }
-        else
-        {
-            snprintf(destValue, sizeValue, "%c.%s", major, minor);
-            destUnits[0] = '\0';
-        }
+        return;
     }
-    else if (strcmp(vicType, "mA") == 0)
+
+    VicSlot *slot = &(_slots[fieldDef->id]);
+    if (((slot->flags & VIC_SLOT_SET) != 0) && (strcmp(textSlot->text, text) == 0))
     {
-        float tmp = (float)atoi(value);
-        if (fabs(tmp) < 1000)
-        {
-            snprintf(destValue, sizeValue, "%s", value);
-            snprintf(destUnits, sizeUnits, "mA");
-        }
-        else
-        {
-            snprintf(destValue, sizeValue, "%.1f", tmp / 1000);
-            snprintf(destUnits, sizeUnits, "A");
-        }
+        return;
     }
-    else if (strcmp(vicType, "mAh") == 0)
+
+    snprintf(textSlot->text, MAX_VIC_TEXT, "%s", text);
+    slot->flags |= VIC_SLOT_SET | VIC_SLOT_REPORTED;
+
+    markChanged(fieldDef->id);
+}
+
+void VEDirectText::markChanged(uint8_t fieldId)
+{
+    _changed[fieldId / 32] |= 1ul << (fieldId % 32);
+    _derivedInputs[fieldId / 32] |= 1ul << (fieldId % 32);
+    _anyChanged = true;
+}
+
+// In dependency order, so a field derived from another derived field
+// sees that one's new value in the same pass
+void VEDirectText::updateDerived()
+{
+    size_t count = VicDerived::getNodeCount();
+    for (size_t n = 0; n < count; n++)
     {
-        float tmp = (float)atoi(value);
-        if (fabs(tmp) < 1000)
+        const VicDerivedNode *node = VicDerived::getNode(n);
+        if (((_slots[node->fieldId].flags & VIC_SLOT_REPORTED) != 0) ||
+            !VicDerived::dependsOn(*node, _derivedInputs))
         {
-            snprintf(destValue, sizeValue, "%s", value);
-            snprintf(destUnits, sizeUnits, "mAh");
+            continue;
         }
-        else
+
+        int32_t value;
+        if (VicDerived::evaluate(*node, _slots, &value))
         {
-            snprintf(destValue, sizeValue, "%.2f", tmp / 1000);
-            snprintf(destUnits, sizeUnits, "Ah");
+            updateValue(VictronDefs::getField(node->fieldId), value, false);
         }
     }
-    else if (strcmp(vicType, "mV") == 0)
+
+    memset(_derivedInputs, 0, sizeof(_derivedInputs));
+}
+
+// Unmapped registers are kept raw, the first MAX_VIC_REGISTERS seen get
+// a slot and any others are dropped
+void VEDirectText::updateRegister(uint16_t reg, const uint8_t *data, size_t len)
+{
+    VicRegisterSlot *slot = 0;
+    for (int i = 0; i < MAX_VIC_REGISTERS; i++)
     {
-        float tmp = (float)atoi(value);
-        if (fabs(tmp) < 1000)
-        {
-            snprintf(destValue, sizeValue, "%s", value);
-            snprintf(destUnits, sizeUnits, "mV");
-        }
-        else
+        if ((_registers[i].reg == reg) || (_registers[i].reg == 0))
         {
-            snprintf(destValue, sizeValue, "%.2f", tmp / 1000);
-            snprintf(destUnits, sizeUnits, "V");
+            slot = &(_registers[i]);
+            break;
         }
     }
-    else if (strcmp(vicType, "map_ar") == 0)
+    if ((slot == 0) || (len > VED_HEX_MAX_DATA))
     {
-        int reasons = strtoul(value, 0, 0);
-        if (reasons == 0)
-        {
-            snprintf(destValue, sizeValue, "No alarm");
-        }
-        else
-        {
-            JsonArray map = g_victronDefs["map_ar"];
-            const char *format = "%s";
-            for (JsonVariant v : map)
-            {
-                JsonObject mapEntry = v.as<JsonObject>();
-
-                if ((((int)mapEntry["key"]) & reasons) != 0)
-                {
-                    int charsWritten = snprintf(destValue,
-                                                sizeValue,
-                                                format,
-                                                (const char *)mapEntry["value"]);
-                    destValue += charsWritten;
-                    sizeValue -= charsWritten;
-                    format = " | %s";
-                }
-            }
-        }
-        destUnits[0] = '\0';
+        return;
     }
-    else if (strcmp(vicType, "map_or") == 0)
-    {
-        int reasons = strtoul(value, 0, 0);
-        if (reasons == 0)
-        {
-            snprintf(destValue, sizeValue, "On");
-        }
-        else
-        {
-            JsonArray map = g_victronDefs["map_or"];
-            const char *format = "%s";
-            for (JsonVariant v : map)
-            {
-                JsonObject mapEntry = v.as<JsonObject>();
 
-                if ((((int)mapEntry["key"]) & reasons) != 0)
-                {
-                    int charsWritten = snprintf(destValue,
-                                                sizeValue,
-                                                format,
-                                                (const char *)mapEntry["value"]);
-                    destValue += charsWritten;
-                    sizeValue -= charsWritten;
-                    format = " | %s";
-                }
-            }
-        }
-        destUnits[0] = '\0';
-    }
-    else if (strcmp(vicType, "map_cs") == 0)
+    if ((slot->reg == reg) && (slot->len == len) &&
+        (memcmp(slot->data, data, len) == 0))
     {
-        int found = 0;
-        int code = strtoul(value, 0, 0);
-        JsonArray map = g_victronDefs["map_cs"];
-        for (JsonVariant v : map)
-        {
-            JsonObject mapEntry = v.as<JsonObject>();
-
-            if (mapEntry["key"] == code)
-            {
-                found = 1;
-                snprintf(destValue, sizeValue, "%s", (const char *)mapEntry["value"]);
-                break;
-            }
-        }
-        if (!found)
-        {
-            snprintf(destValue, sizeValue, "Unknown state (%s)", value);
-        }
-        destUnits[0] = '\0';
+        return;
     }
-    else if (strcmp(vicType, "map_err") == 0)
-    {
-        int found = 0;
-        int code = strtoul(value, 0, 0);
-        JsonArray map = g_victronDefs["map_err"];
-        for (JsonVariant v : map)
-        {
-            JsonObject mapEntry = v.as<JsonObject>();
 
-            if (mapEntry["key"] == code)
-            {
-                found = 1;
-                snprintf(destValue, sizeValue, "%s", (const char *)mapEntry["value"]);
-                break;
-            }
-        }
-        if (!found)
-        {
-            snprintf(destValue, sizeValue, "Unknown error (%s)", value);
-        }
-        destUnits[0] = '\0';
-    }
-    else if (strcmp(vicType, "map_mode") == 0)
-    {
-        int found = 0;
-        int code = strtoul(value, 0, 0);
-        JsonArray map = g_victronDefs["map_mode"];
-        for (JsonVariant v : map)
-        {
-            JsonObject mapEntry = v.as<JsonObject>();
+    slot->reg = reg;
+    slot->len = len;
+    memcpy(slot->data, data, len);
+    slot->changed = true;
+    _anyChanged = true;
+}
 
-            if (mapEntry["key"] == code)
-            {
-                found = 1;
-                snprintf(destValue, sizeValue, "%s", (const char *)mapEntry["value"]);
-                break;
-            }
-        }
-        if (!found)
-        {
-            snprintf(destValue, sizeValue, "Unknown mode (%s)", value);
-        }
-        destUnits[0] = '\0';
-    }
-    else if (strcmp(vicType, "map_mppt") == 0)
-    {
-        int found = 0;
-        int code = strtoul(value, 0, 0);
-        JsonArray map = g_victronDefs["map_mppt"];
-        for (JsonVariant v : map)
-        {
-            JsonObject mapEntry = v.as<JsonObject>();
+bool VEDirectText::hasChanges()
+{
+    return _anyChanged || _blockEnded;
+}
 
-            if (mapEntry["key"] == code)
-            {
-                found = 1;
-                snprintf(destValue, sizeValue, "%s", (const char *)mapEntry["value"]);
-                break;
-            }
-        }
-        if (!found)
+// Next changed field ID after fieldId, -1 to start, -1 when done
+int VEDirectText::nextChange(int fieldId)
+{
+    for (int id = fieldId + 1; id < MAX_VIC_FIELDS;)
+    {
+        uint32_t bits = _changed[id / 32] >> (id % 32);
+        if (bits != 0)
         {
-            snprintf(destValue, sizeValue, "Unknown mppt (%s)", value);
+            return id + __builtin_ctz(bits);
         }
-        destUnits[0] = '\0';
+        id = (id | 31) + 1;
     }
-    else if (strcmp(vicType, "map_pid") == 0)
-    {
-        int found = 0;
-        JsonArray map = g_victronDefs["map_pid"];
-        for (JsonVariant v : map)
-        {
-            JsonObject mapEntry = v.as<JsonObject>();
 
-            if (strcmp(mapEntry["key"], value) == 0)
-            {
-                found = 1;
-                snprintf(destValue, sizeValue, "%s", (const char *)mapEntry["value"]);
-                break;
-            }
-        }
-        if (!found)
+    return -1;
+}
+
+// Next changed register slot after index, -1 to start, -1 when done
+int VEDirectText::nextRegisterChange(int index)
+{
+    for (int i = index + 1; i < MAX_VIC_REGISTERS; i++)
+    {
+        if (_registers[i].changed)
         {
-            snprintf(destValue, sizeValue, "Unknown product (%s)", value);
+            return i;
         }
-        destUnits[0] = '\0';
     }
-    else if (strcmp(vicType, "min") == 0)
-    {
-        snprintf(destValue, sizeValue, "%s", value);
-        snprintf(destUnits, sizeUnits, "min");
-    }
-    else if (strcmp(vicType, "onoff") == 0)
-    {
-        snprintf(destValue, sizeValue, "%s", value);
-        destUnits[0] = '\0';
-    }
-    else if (strcmp(vicType, "range[0..364]") == 0)
-    {
-        snprintf(destValue, sizeValue, "%s", value);
-        destUnits[0] = '\0';
-    }
-    else if (strcmp(vicType, "sec") == 0)
-    {
-        snprintf(destValue, sizeValue, "%s", value);
-        snprintf(destUnits, sizeUnits, "sec");
-    }
-    else if (strcmp(vicType, "serial") == 0)
-    {
-        snprintf(destValue, sizeValue, "%s", value);
-        destUnits[0] = '\0';
-    }
-    else if (strcmp(vicType, "string") == 0)
+
+    return -1;
+}
+
+const VicRegisterSlot *VEDirectText::getRegister(int index)
+{
+    if ((index < 0) || (index >= MAX_VIC_REGISTERS) || (_registers[index].reg == 0))
     {
-        snprintf(destValue, sizeValue, "%s", value);
-        destUnits[0] = '\0';
+        return 0;
     }
+
+    return &(_registers[index]);
 }
 
-void VEDirectText::vpvUpdated(DynamicJsonDocument &updates,
-                              const char *fieldValue,
-                              const char *unitsValue)
+// Every text field with a value goes out again on the next
+// takeChanges(), e.g. once the broker is back. They only change
+// rarely, and aren't logged while it's away.
+void VEDirectText::markTextChanged()
 {
-    VicPair *ppv = findKey("ppv");
-    if (ppv != 0)
+    for (int i = 0; i < MAX_VIC_TEXT_SLOTS; i++)
     {
-        float watts = (float)atoi(ppv->value);
-        float volts = atof(fieldValue);
-        if (strcmp(unitsValue, "mV") == 0)
+        uint8_t fieldId = _textSlots[i].fieldId;
+        if ((fieldId != VIC_NO_FIELD) && ((_slots[fieldId].flags & VIC_SLOT_SET) != 0))
         {
-            volts /= 1000.0;
+            _changed[fieldId / 32] |= 1ul << (fieldId % 32);
+            _anyChanged = true;
         }
-        float amps = watts / volts;
+    }
+}
 
-        updateIpv(updates, amps);
+void VEDirectText::clearChanges()
+{
+    memset(_changed, 0, sizeof(_changed));
+    for (int i = 0; i < MAX_VIC_REGISTERS; i++)
+    {
+        _registers[i].changed = false;
     }
+    _anyChanged = false;
+    _blockEnded = false;
 }
 
-void VEDirectText::ppvUpdated(DynamicJsonDocument &updates,
-                              const char *fieldValue,
-                              const char *unitsValue)
+// Move pending changes onto the queue as deltas, then a block marker
+// if a text block was committed since the last call. Only what was
+// pushed is cleared: when the queue fills up the rest stays pending,
+// in order, and goes on a later call with the values current then.
+// Returns false if anything is left.
+bool VEDirectText::takeChanges(VicDeltaQueue &queue)
 {
-    VicPair *vpv = findKey("vpv");
-    VicPair *vpv_units = findKey("vpv_units");
-    if ((vpv != 0) && (vpv_units != 0))
+    VicDelta delta;
+
+    for (int id = nextChange(-1); id >= 0; id = nextChange(id))
     {
-        float volts = atof(vpv->value);
-        if (strcmp(vpv_units->value, "mV") == 0)
+        delta.kind = VIC_DELTA_FIELD;
+        delta.fieldId = id;
+        delta.value = _slots[id].value;
+        delta.len = snprintf((char *)delta.data, sizeof(delta.data), "%s", getText(id));
+        if (!queue.push(delta))
         {
-            volts /= 1000.0;
+            return false;
         }
-        float watts = (float)atoi(fieldValue);
-        float amps = watts / volts;
-
-        updateIpv(updates, amps);
+        _changed[id / 32] &= ~(1ul << (id % 32));
     }
 
-    VicPair *p = findKey("p");
-    if (p != 0)
+    for (int r = nextRegisterChange(-1); r >= 0; r = nextRegisterChange(r))
     {
-        int wattsBat = atoi(p->value);
-        int wattsPv = atoi(fieldValue);
-        float efficiencyPct = 0.0;
-        if ((wattsPv != 0) && (wattsBat != 0))
+        delta.kind = VIC_DELTA_REGISTER;
+        delta.fieldId = VIC_NO_FIELD;
+        delta.reg = _registers[r].reg;
+        delta.len = _registers[r].len;
+        memcpy(delta.data, _registers[r].data, _registers[r].len);
+        if (!queue.push(delta))
         {
-            efficiencyPct = ((float)wattsBat / (float)wattsPv) * 100.0;
+            return false;
         }
-
-        updateEff(updates, efficiencyPct);
+        _registers[r].changed = false;
     }
-}
 
-void VEDirectText::vUpdated(DynamicJsonDocument &updates,
-                            const char *fieldValue,
-                            const char *unitsValue)
-{
-    VicPair *i = findKey("i");
-    VicPair *i_units = findKey("i_units");
-    if ((i != 0) && (i_units != 0))
+    if (_blockEnded)
     {
-        float amps = atof(i->value);
-        if (strcmp(i_units->value, "mA") == 0)
-        {
-            amps /= 1000.0;
-        }
-        float volts = atof(fieldValue);
-        if (strcmp(unitsValue, "mV") == 0)
+        delta.kind = VIC_DELTA_BLOCK;
+        delta.fieldId = VIC_NO_FIELD;
+        delta.reg = 0;
+        delta.len = 0;
+        if (!queue.push(delta))
         {
-            volts /= 1000.0;
+            _anyChanged = false;
+            return false;
         }
-        float watts = volts * amps;
+    }
+
+    clearChanges();
+    return true;
+}
 
-        updateP(updates, watts);
+// Formatting is only done here, for the fields actually published
+bool VEDirectText::formatField(uint8_t fieldId,
+                               char *destValue,
+                               size_t sizeValue,
+                               char *destUnits,
+                               size_t sizeUnits)
+{
+    const VicSlot *slot = getSlot(fieldId);
+    const VicFieldDef *fieldDef = VictronDefs::getField(fieldId);
+    if ((slot == 0) || (fieldDef == 0))
+    {
+        return false;
     }
+
+    formatValue(destValue, sizeValue,
+                destUnits, sizeUnits,
+                slot->value,
+                getText(fieldId),
+                fieldDef->type);
+
+    return true;
 }
 
-void VEDirectText::iUpdated(DynamicJsonDocument &updates,
-                            const char *fieldValue,
-                            const char *unitsValue)
+// Drops whatever was half received, e.g. after a multiplexer switched
+// to another device. Nothing is reported until the next full block.
+void VEDirectText::restart()
 {
-    VicPair *v = findKey("v");
-    VicPair *v_units = findKey("v_units");
-    if ((v != 0) && (v_units != 0))
+    _parser.reset();
+    _blockFieldCount = 0;
+    _blockOverflow = false;
+}
+
+// Fields are buffered until the parser has validated the block's
+// checksum, only then are they committed
+void VEDirectText::handleBytes(const uint8_t *data,
+                               size_t len)
+{
+    for (size_t i = 0; i < len; i++)
     {
-        float volts = atof(v->value);
-        if (strcmp(v_units->value, "mV") == 0)
+        switch (_parser.feed(data[i]))
         {
-            volts /= 1000.0;
-        }
-        float amps = atof(fieldValue);
-        if (strcmp(unitsValue, "mA") == 0)
-        {
-            amps /= 1000.0;
-        }
-        float watts = volts * amps;
+        case VEDirectParser::EVENT_FIELD:
+            if (_blockFieldCount < MAX_BLOCK_FIELDS)
+            {
+                strcpy(_block[_blockFieldCount].key, _parser.getLabel());
+                strcpy(_block[_blockFieldCount].value, _parser.getValue());
+                _blockFieldCount++;
+            }
+            else
+            {
+                _blockOverflow = true;
+            }
+            break;
 
-        updateP(updates, watts);
+        case VEDirectParser::EVENT_BLOCK_GOOD:
+            if (!_blockOverflow)
+            {
+                for (int j = 0; j < _blockFieldCount; j++)
+                {
+                    handleField(_block[j].key, _block[j].value);
+                }
+                updateDerived();
+                _blockEnded = true;
+            }
+            _blockFieldCount = 0;
+            _blockOverflow = false;
+            break;
+
+        case VEDirectParser::EVENT_BLOCK_BAD:
+            _blockFieldCount = 0;
+            _blockOverflow = false;
+            break;
+
+        case VEDirectParser::EVENT_HEX:
+            handleHex(_parser.getHex(), _parser.getHexLen());
+            break;
+
+        case VEDirectParser::EVENT_NONE:
+            break;
+        }
     }
 }
 
-void VEDirectText::pUpdated(DynamicJsonDocument &updates,
-                            const char *fieldValue,
-                            const char *unitsValue)
+void VEDirectText::handleField(const char *field,
+                               const char *value)
 {
-    VicPair *ppv = findKey("ppv");
-    if (ppv != 0)
+    const VicFieldDef *fieldDef = VictronDefs::findField(field);
+    if (fieldDef == 0)
+    {
+        return;
+    }
+
+    if (VictronDefs::isTextType(fieldDef->type))
+    {
+        updateText(fieldDef, value);
+    }
+    else
     {
-        int wattsPv = atoi(ppv->value);
-        int wattsBat = atoi(fieldValue);
-        float efficiencyPct = 0.0;
-        if ((wattsPv != 0) && (wattsBat != 0))
+        int32_t parsed;
+        if (parseValue(value, fieldDef->type, &parsed))
         {
-            efficiencyPct = ((float)wattsBat / (float)wattsPv) * 100.0;
+            updateValue(fieldDef, parsed, true);
         }
-
-        updateEff(updates, efficiencyPct);
     }
 }
 
-void VEDirectText::updateIpv(DynamicJsonDocument &updates,
-                             float amps)
+// GET responses and async notifications for registers that mirror a
+// text field update that field straight away, anything else (history,
+// settings...) is kept raw, see getRegister()
+void VEDirectText::handleHex(const char *hex,
+                             size_t len)
 {
-    const char *units = "A";
-    char tmp[50];
-    if (amps < 1.0)
+    VEDirectHexFrame frame;
+    if (!VEDirectHex::decode(hex, len, &frame))
     {
-        amps *= 10.0;
-        int roundAmps = roundf(amps);
-        roundAmps *= 100;
-        if (roundAmps == 1000)
+        _badHexFrames++;
+        return;
+    }
+
+    if ((!VEDirectHex::isRegisterFrame(&frame)) ||
+        (VEDirectHex::getFlags(&frame) != 0))
+    {
+        return;
+    }
+
+    uint16_t reg = VEDirectHex::getRegister(&frame);
+    size_t valueLen;
+    const uint8_t *value = VEDirectHex::getValue(&frame, &valueLen);
+
+    const VicHexRegister *regDef = VEDirectHex::findRegister(reg);
+    if ((regDef != 0) && (valueLen == regDef->size))
+    {
+        uint32_t raw = 0;
+        for (size_t i = 0; i < valueLen; i++)
         {
-            units = "A";
-            sprintf(tmp, "%.1f", 1.0);
+            raw |= ((uint32_t)value[i]) << (8 * i);
+        }
+
+        int64_t scaled;
+        if (regDef->isSigned && (valueLen < 4) &&
+            (raw & (1ul << ((8 * valueLen) - 1))))
+        {
+            scaled = (int64_t)raw - (1ll << (8 * valueLen));
+        }
+        else if (regDef->isSigned)
+        {
+            scaled = (int32_t)raw;
         }
         else
         {
-            units = "mA";
-            sprintf(tmp, "%d", roundAmps);
+            scaled = raw;
+        }
+        scaled = (scaled * regDef->mul) / regDef->div;
+
+        const VicFieldDef *fieldDef = VictronDefs::findField(regDef->label);
+        if (fieldDef != 0)
+        {
+            updateValue(fieldDef, scaled, true);
+            updateDerived();
         }
     }
     else
     {
-        sprintf(tmp, "%.1f", amps);
+        updateRegister(reg, value, valueLen);
     }
+}
 
-    updateCurrentData(updates,
-                      "ipv", tmp,
-                      "ipv_units", units);
+uint32_t VEDirectText::getBadHexFrames()
+{
+    return _badHexFrames;
 }
 
-void VEDirectText::updateP(DynamicJsonDocument &updates,
-                           int watts)
+uint32_t VEDirectText::getGoodBlocks()
 {
-    char tmp[50];
-    sprintf(tmp, "%d", watts);
+    return _parser.getGoodBlocks();
+}
 
-    updateCurrentData(updates,
-                      "p", tmp,
-                      "p_units", "W");
+uint32_t VEDirectText::getBadBlocks()
+{
+    return _parser.getBadBlocks();
 }
 
-void VEDirectText::updateEff(DynamicJsonDocument &updates,
-                             float pct)
+void VEDirectText::formatValue(char *destValue,
+                               size_t sizeValue,
+                               char *destUnits,
+                               size_t sizeUnits,
+                               int32_t value,
+                               const char *text,
+                               VicType vicType)
 {
-    char tmp[50];
-    sprintf(tmp, "%d", (int)roundf(pct));
+    if (vicType >= VIC_NUM_TYPES)
+    {
+        vicType = VIC_TYPE_UNKNOWN;
+    }
 
-    updateCurrentData(updates,
-                      "eff", tmp,
-                      "eff_units", "%");
+    g_vicDecoders[vicType](destValue, sizeValue,
+                           destUnits, sizeUnits,
+                           value, text);
 }
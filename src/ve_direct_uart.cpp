@@ -0,0 +1,139 @@
+#include <driver/uart.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include "ve_direct_uart.hpp"
+
+VEDirectUART::VEDirectUART()
+    : _port(UART_NUM_0), _events(0), _started(false), _overflows(0)
+{
+}
+
+bool VEDirectUART::begin(uart_port_t port, uint32_t baud, int rxPin, int txPin)
+{
+    uart_config_t uartConfig = {};
+    uartConfig.baud_rate = baud;
+    uartConfig.data_bits = UART_DATA_8_BITS;
+    uartConfig.parity = UART_PARITY_DISABLE;
+    uartConfig.stop_bits = UART_STOP_BITS_1;
+    uartConfig.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+
+    if (uart_param_config(port, &uartConfig) != ESP_OK)
+    {
+        return false;
+    }
+
+    if (uart_set_pin(port, txPin, rxPin,
+                     UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE) != ESP_OK)
+    {
+        return false;
+    }
+
+    // No TX buffer, the few HEX poll bytes go straight into the TX FIFO
+    if (uart_driver_install(port, VED_UART_RX_BUFFER, 0,
+                            VED_UART_EVENT_QUEUE, &_events, 0) != ESP_OK)
+    {
+        return false;
+    }
+
+    uart_intr_config_t intrConfig = {};
+    intrConfig.intr_enable_mask = UART_RXFIFO_FULL_INT_ENA_M |
+                                  UART_RXFIFO_TOUT_INT_ENA_M |
+                                  UART_FRM_ERR_INT_ENA_M |
+                                  UART_RXFIFO_OVF_INT_ENA_M;
+    intrConfig.rxfifo_full_thresh = VED_UART_RX_FIFO_THRESH;
+    intrConfig.rx_timeout_thresh = VED_UART_RX_TIMEOUT;
+    intrConfig.txfifo_empty_intr_thresh = 10;
+    if (uart_intr_config(port, &intrConfig) != ESP_OK)
+    {
+        uart_driver_delete(port);
+        return false;
+    }
+
+    _port = port;
+    _started = true;
+
+    return true;
+}
+
+size_t VEDirectUART::read(uint8_t *dest, size_t size, uint32_t timeout_ms)
+{
+    if (!_started)
+    {
+        return 0;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+
+    for (;;)
+    {
+        // Whatever the driver already holds, the events for it may have
+        // been consumed by an earlier call
+        size_t buffered = 0;
+        uart_get_buffered_data_len(_port, &buffered);
+        if (buffered > 0)
+        {
+            int len = uart_read_bytes(_port, dest,
+                                      (buffered < size) ? buffered : size, 0);
+            return (len > 0) ? len : 0;
+        }
+
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout)
+        {
+            return 0;
+        }
+
+        uart_event_t event;
+        if (xQueueReceive(_events, &event, timeout - elapsed) != pdTRUE)
+        {
+            return 0;
+        }
+
+        switch (event.type)
+        {
+        case UART_FIFO_OVF:
+        case UART_BUFFER_FULL:
+            // Bytes are already lost, drop the rest of the burst too and
+            // let the parser fail the block on its checksum
+            _overflows++;
+            uart_flush_input(_port);
+            xQueueReset(_events);
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+size_t VEDirectUART::write(const uint8_t *data, size_t len)
+{
+    if (!_started)
+    {
+        return 0;
+    }
+
+    int written = uart_write_bytes(_port, (const char *)data, len);
+
+    return (written > 0) ? written : 0;
+}
+
+// Drops everything received so far, e.g. when a multiplexer switches
+// to another device
+void VEDirectUART::flush()
+{
+    if (!_started)
+    {
+        return;
+    }
+
+    uart_flush_input(_port);
+    xQueueReset(_events);
+}
+
+uint32_t VEDirectUART::getOverflows()
+{
+    return _overflows;
+}
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <string.h>
+#include <ArduinoJson.h>
+#include "vic_aggregator.hpp"
+#include "victron_defs.hpp"
+
+VicAggSlot::VicAggSlot()
+    : min(0), max(0), last(0), sum(0), duration_ms(0), since_ms(0), flags(0) {}
+
+VicAggregator::VicAggregator()
+    : _fieldCount(0), _windowCount(0)
+{
+    memset(_slotOf, VIC_AGG_NONE, sizeof(_slotOf));
+}
+
+bool VicAggregator::addWindow(uint16_t window_s, uint32_t now_ms)
+{
+    if ((window_s == 0) || (_windowCount >= MAX_VIC_WINDOWS) || (_fieldCount > 0))
+    {
+        return false;
+    }
+
+    _window_s[_windowCount] = window_s;
+    _windowStart_ms[_windowCount] = now_ms;
+    _windowCount++;
+
+    return true;
+}
+
+size_t VicAggregator::getWindowCount()
+{
+    return _windowCount;
+}
+
+uint16_t VicAggregator::getWindow(size_t window)
+{
+    return (window < _windowCount) ? _window_s[window] : 0;
+}
+
+// Accounts for the value held since the last change or report
+void VicAggregator::advance(VicAggSlot &slot, uint32_t now_ms)
+{
+    uint32_t dt = now_ms - slot.since_ms;
+    slot.sum += (int64_t)slot.last * dt;
+    slot.duration_ms += dt;
+    slot.since_ms = now_ms;
+}
+
+void VicAggregator::add(const VicDelta &delta, uint32_t now_ms)
+{
+    if ((delta.kind != VIC_DELTA_FIELD) || (delta.fieldId >= MAX_VIC_FIELDS) || (_windowCount == 0))
+    {
+        return;
+    }
+
+    uint8_t index = _slotOf[delta.fieldId];
+    if (index == VIC_AGG_SKIP)
+    {
+        return;
+    }
+    if (index == VIC_AGG_NONE)
+    {
+        const VicFieldDef *fieldDef = VictronDefs::getField(delta.fieldId);
+        if ((fieldDef == 0) ||
+            !VictronDefs::isMeasurementType(fieldDef->type) ||
+            (_fieldCount >= MAX_VIC_AGG_FIELDS))
+        {
+            _slotOf[delta.fieldId] = VIC_AGG_SKIP;
+            return;
+        }
+
+        index = _fieldCount++;
+        _slotOf[delta.fieldId] = index;
+        _fieldOf[index] = delta.fieldId;
+    }
+
+    for (size_t w = 0; w < _windowCount; w++)
+    {
+        VicAggSlot &slot = _slots[w][index];
+        if ((slot.flags & VIC_AGG_SEEN) == 0)
+        {
+            slot.min = delta.value;
+            slot.max = delta.value;
+            slot.sum = 0;
+            slot.duration_ms = 0;
+            slot.since_ms = now_ms;
+            slot.flags |= VIC_AGG_SEEN;
+        }
+        else
+        {
+            advance(slot, now_ms);
+            if (delta.value < slot.min)
+            {
+                slot.min = delta.value;
+            }
+            if (delta.value > slot.max)
+            {
+                slot.max = delta.value;
+            }
+        }
+        slot.last = delta.value;
+    }
+}
+
+bool VicAggregator::isDue(size_t window, uint32_t now_ms)
+{
+    return (window < _windowCount) &&
+           (now_ms - _windowStart_ms[window] >= (uint32_t)_window_s[window] * 1000);
+}
+
+static double scaled(double value, uint8_t decimals)
+{
+    for (uint8_t i = 0; i < decimals; i++)
+    {
+        value /= 10;
+    }
+
+    return value;
+}
+
+// Adds an object per field seen so far, keyed like the per-field
+// topics, and starts the next window from the current values
+void VicAggregator::report(size_t window, uint32_t now_ms, JsonObject dest)
+{
+    if (window >= _windowCount)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < _fieldCount; i++)
+    {
+        VicAggSlot &slot = _slots[window][i];
+        advance(slot, now_ms);
+
+        const VicFieldDef *fieldDef = VictronDefs::getField(_fieldOf[i]);
+        const VicTypeScale *scale = VictronDefs::getTypeScale(fieldDef->type);
+        double mean = (slot.duration_ms > 0) ? (double)slot.sum / slot.duration_ms
+                                             : slot.last;
+
+        char key[MAX_VIC_FIELDNAME];
+        snprintf(key, sizeof(key), "%s", fieldDef->key);
+        for (char *c = key; *c != '\0'; c++)
+        {
+            if (*c == '#')
+            {
+                *c = '-';
+            }
+        }
+
+        // Non-const char * so the document keeps its own copy
+        JsonObject field = dest.createNestedObject((char *)key);
+        field["min"] = scaled(slot.min, scale->decimals);
+        field["max"] = scaled(slot.max, scale->decimals);
+        field["mean"] = scaled(mean, scale->decimals);
+        field["last"] = scaled(slot.last, scale->decimals);
+        field["units"] = scale->units;
+
+        // Raw units times ms to Ah or Wh
+        switch (fieldDef->type)
+        {
+        case VIC_TYPE_MA:
+            field["ah"] = slot.sum / 3.6e9;
+            break;
+
+        case VIC_TYPE_AMP_TENTH:
+            field["ah"] = slot.sum / 3.6e7;
+            break;
+
+        case VIC_TYPE_WATT:
+            field["wh"] = slot.sum / 3.6e6;
+            break;
+
+        default:
+            break;
+        }
+
+        slot.min = slot.last;
+        slot.max = slot.last;
+        slot.sum = 0;
+        slot.duration_ms = 0;
+    }
+
+    _windowStart_ms[window] += (uint32_t)_window_s[window] * 1000;
+}
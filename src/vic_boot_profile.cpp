@@ -0,0 +1,112 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include "vic_boot_profile.hpp"
+
+static const char *g_bootPhaseNames[VIC_BOOT_COUNT] = {
+    "spiffs",
+    "config",
+    "defs",
+    "log",
+    "inputs",
+    "firstBlock",
+    "wifi",
+    "broker"};
+
+VicBootProfile::VicBootProfile(VicClock *clock)
+    : _clock(clock),
+      _errorCount(0)
+{
+    for (size_t p = 0; p < VIC_BOOT_COUNT; p++)
+    {
+        _at_ms[p] = 0;
+        _marked[p] = false;
+    }
+}
+
+// The time is written before the flag, so a reader that sees the flag
+// sees the time
+void VicBootProfile::mark(VicBootPhase phase)
+{
+    if ((phase >= VIC_BOOT_COUNT) || _marked[phase])
+    {
+        return;
+    }
+
+    _at_ms[phase] = _clock->millis();
+    _marked[phase] = true;
+}
+
+bool VicBootProfile::isMarked(VicBootPhase phase) const
+{
+    return (phase < VIC_BOOT_COUNT) && _marked[phase];
+}
+
+uint32_t VicBootProfile::get(VicBootPhase phase) const
+{
+    return isMarked(phase) ? _at_ms[phase] : 0;
+}
+
+// Quotes and control characters are replaced, so the error can go in
+// the report as it is
+void VicBootProfile::addError(const char *format, ...)
+{
+    if (_errorCount++ >= MAX_VIC_BOOT_ERRORS)
+    {
+        return;
+    }
+
+    char *error = _errors[_errorCount - 1];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(error, MAX_VIC_BOOT_ERROR, format, args);
+    va_end(args);
+
+    for (char *c = error; *c != '\0'; c++)
+    {
+        if ((*c == '"') || (*c == '\\'))
+        {
+            *c = '\'';
+        }
+        else if ((unsigned char)*c < ' ')
+        {
+            *c = ' ';
+        }
+    }
+}
+
+size_t VicBootProfile::format(char *dest, size_t size, const char *reason, const char *defs) const
+{
+    int len = snprintf(dest, size, "{\"reason\": \"%s\", \"defs\": \"%s\"", reason, defs);
+    for (size_t p = 0; (p < VIC_BOOT_COUNT) && (len > 0) && ((size_t)len < size); p++)
+    {
+        if (_marked[p])
+        {
+            len += snprintf(dest + len, size - len, ", \"%s_ms\": %lu",
+                            g_bootPhaseNames[p], (unsigned long)_at_ms[p]);
+        }
+    }
+    if ((_errorCount > 0) && (len > 0) && ((size_t)len < size))
+    {
+        len += snprintf(dest + len, size - len, ", \"errors\": [");
+        size_t kept = (_errorCount < MAX_VIC_BOOT_ERRORS) ? _errorCount : MAX_VIC_BOOT_ERRORS;
+        for (size_t e = 0; (e < kept) && (len > 0) && ((size_t)len < size); e++)
+        {
+            len += snprintf(dest + len, size - len, "%s\"%s\"", (e > 0) ? ", " : "", _errors[e]);
+        }
+        if ((len > 0) && ((size_t)len < size))
+        {
+            len += snprintf(dest + len, size - len, "], \"errorCount\": %lu", (unsigned long)_errorCount);
+        }
+    }
+    if ((len > 0) && ((size_t)len < size))
+    {
+        len += snprintf(dest + len, size - len, "}");
+    }
+
+    return ((len > 0) && ((size_t)len < size)) ? len : 0;
+}
+
+const char *VicBootProfile::getName(VicBootPhase phase)
+{
+    return (phase < VIC_BOOT_COUNT) ? g_bootPhaseNames[phase] : "";
+}
@@ -0,0 +1,425 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include "vic_derived.hpp"
+#include "ve_direct_text.hpp"
+
+//
+// Static data
+//
+
+VicDerivedNode VicDerived::g_nodes[MAX_VIC_DERIVED];
+size_t VicDerived::g_nodeCount = 0;
+VicDerivedOp VicDerived::g_ops[MAX_VIC_DERIVED_OPS];
+size_t VicDerived::g_opCount = 0;
+char VicDerived::g_buildError[128];
+
+//
+// Expression parser, recursive descent straight to postfix ops
+//
+//   expr    := term (('+' | '-') term)*
+//   term    := unary (('*' | '/') unary)*
+//   unary   := '-' unary | primary
+//   primary := number | field | '(' expr ')'
+//
+
+struct VicExprParser
+{
+    const char *pos;
+    VicDerivedOp *ops;
+    size_t count;
+    size_t size;
+    uint32_t *inputs;
+    const char *error;
+};
+
+static bool parseExpr(VicExprParser &p);
+
+static char peek(VicExprParser &p)
+{
+    while (*p.pos == ' ')
+    {
+        p.pos++;
+    }
+
+    return *p.pos;
+}
+
+static bool emit(VicExprParser &p, VicDerivedOpCode code, uint8_t fieldId, float value)
+{
+    if (p.count >= p.size)
+    {
+        p.error = "too long";
+        return false;
+    }
+
+    p.ops[p.count].code = code;
+    p.ops[p.count].fieldId = fieldId;
+    p.ops[p.count].value = value;
+    p.count++;
+
+    return true;
+}
+
+static bool parsePrimary(VicExprParser &p)
+{
+    char c = peek(p);
+    if (c == '(')
+    {
+        p.pos++;
+        if (!parseExpr(p))
+        {
+            return false;
+        }
+        if (peek(p) != ')')
+        {
+            p.error = "missing )";
+            return false;
+        }
+        p.pos++;
+        return true;
+    }
+
+    if (isdigit((unsigned char)c) || (c == '.'))
+    {
+        char *end;
+        float value = strtof(p.pos, &end);
+        p.pos = end;
+        return emit(p, VIC_OP_CONST, 0, value);
+    }
+
+    if (isalpha((unsigned char)c))
+    {
+        const char *start = p.pos;
+        char name[MAX_VIC_FIELDNAME];
+        size_t len = 0;
+        while (isalnum((unsigned char)*p.pos) || (*p.pos == '_') || (*p.pos == '#'))
+        {
+            if (len >= MAX_VIC_FIELDNAME - 1)
+            {
+                p.error = "name too long";
+                return false;
+            }
+            name[len++] = *p.pos++;
+        }
+        name[len] = '\0';
+
+        const VicFieldDef *fieldDef = VictronDefs::lookupField(name);
+        if (fieldDef == 0)
+        {
+            p.error = "unknown field";
+            p.pos = start;
+            return false;
+        }
+        if (VictronDefs::isTextType(fieldDef->type))
+        {
+            p.error = "text field";
+            p.pos = start;
+            return false;
+        }
+
+        p.inputs[fieldDef->id / 32] |= 1ul << (fieldDef->id % 32);
+        return emit(p, VIC_OP_FIELD, fieldDef->id, VictronDefs::getTypeScale(fieldDef->type)->base);
+    }
+
+    p.error = "syntax error";
+    return false;
+}
+
+static bool parseUnary(VicExprParser &p)
+{
+    if (peek(p) == '-')
+    {
+        p.pos++;
+        return parseUnary(p) && emit(p, VIC_OP_NEG, 0, 0);
+    }
+
+    return parsePrimary(p);
+}
+
+static bool parseTerm(VicExprParser &p)
+{
+    if (!parseUnary(p))
+    {
+        return false;
+    }
+
+    for (char c = peek(p); (c == '*') || (c == '/'); c = peek(p))
+    {
+        p.pos++;
+        if (!parseUnary(p) || !emit(p, (c == '*') ? VIC_OP_MUL : VIC_OP_DIV, 0, 0))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool parseExpr(VicExprParser &p)
+{
+    if (!parseTerm(p))
+    {
+        return false;
+    }
+
+    for (char c = peek(p); (c == '+') || (c == '-'); c = peek(p))
+    {
+        p.pos++;
+        if (!parseTerm(p) || !emit(p, (c == '+') ? VIC_OP_ADD : VIC_OP_SUB, 0, 0))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool hasInput(const VicDerivedNode &node, uint8_t fieldId)
+{
+    return (node.inputs[fieldId / 32] & (1ul << (fieldId % 32))) != 0;
+}
+
+//
+// Static functions
+//
+
+// Compiles into the ops after the ones already built
+bool VicDerived::compile(uint8_t fieldId, const char *expr, VicDerivedNode *node)
+{
+    const VicFieldDef *fieldDef = VictronDefs::getField(fieldId);
+    if ((fieldDef == 0) || VictronDefs::isTextType(fieldDef->type))
+    {
+        snprintf(g_buildError, sizeof(g_buildError), "VicDerived::build: Field %d can't be derived", (int)fieldId);
+        return false;
+    }
+
+    memset(node, 0, sizeof(*node));
+    VicExprParser p;
+    p.pos = expr;
+    p.ops = g_ops + g_opCount;
+    p.count = 0;
+    p.size = MAX_VIC_DERIVED_OPS - g_opCount;
+    p.inputs = node->inputs;
+    p.error = 0;
+
+    if (parseExpr(p) && (peek(p) != '\0'))
+    {
+        p.error = "syntax error";
+    }
+
+    // Stack depth, each operand pushes one and each binary op pops one
+    size_t depth = 0;
+    for (size_t i = 0; (p.error == 0) && (i < p.count); i++)
+    {
+        switch (p.ops[i].code)
+        {
+        case VIC_OP_FIELD:
+        case VIC_OP_CONST:
+            if (++depth > MAX_VIC_DERIVED_STACK)
+            {
+                p.error = "too deep";
+            }
+            break;
+
+        case VIC_OP_NEG:
+            break;
+
+        default:
+            depth--;
+            break;
+        }
+    }
+
+    if (p.error == 0)
+    {
+        if (hasInput(*node, fieldId))
+        {
+            p.error = "derived from itself";
+        }
+        else if (g_opCount + p.count > 0xff)
+        {
+            p.error = "too long";
+        }
+    }
+
+    if (p.error != 0)
+    {
+        snprintf(g_buildError, sizeof(g_buildError), "VicDerived::build: '%s' = '%s', %s at '%s'",
+                 fieldDef->name, expr, p.error, p.pos);
+        return false;
+    }
+
+    node->fieldId = fieldId;
+    node->firstOp = g_opCount;
+    node->opCount = p.count;
+    node->scale = 1.0f / VictronDefs::getTypeScale(fieldDef->type)->base;
+    g_opCount += p.count;
+
+    return true;
+}
+
+// Nodes are compiled in field ID order, then moved into dependency
+// order one at a time: each round takes the first node that doesn't
+// read a field still waiting to be computed
+bool VicDerived::build()
+{
+    VicDerivedNode compiled[MAX_VIC_DERIVED];
+    size_t count = 0;
+
+    g_buildError[0] = '\0';
+    g_nodeCount = 0;
+    g_opCount = 0;
+
+    size_t fieldCount = VictronDefs::getFieldCount();
+    for (size_t id = 0; id < fieldCount; id++)
+    {
+        const char *expr = VictronDefs::getExpr(id);
+        if (expr == 0)
+        {
+            continue;
+        }
+        if (count >= MAX_VIC_DERIVED)
+        {
+            snprintf(g_buildError, sizeof(g_buildError), "VicDerived::build: More than %d derived fields", MAX_VIC_DERIVED);
+            return false;
+        }
+        if (!compile(id, expr, &compiled[count]))
+        {
+            g_opCount = 0;
+            return false;
+        }
+        count++;
+    }
+
+    bool placed[MAX_VIC_DERIVED] = {false};
+    for (size_t n = 0; n < count; n++)
+    {
+        size_t next = count;
+        for (size_t i = 0; (i < count) && (next == count); i++)
+        {
+            if (placed[i])
+            {
+                continue;
+            }
+
+            next = i;
+            for (size_t j = 0; j < count; j++)
+            {
+                if ((j != i) && !placed[j] && hasInput(compiled[i], compiled[j].fieldId))
+                {
+                    next = count;
+                    break;
+                }
+            }
+        }
+
+        if (next == count)
+        {
+            snprintf(g_buildError, sizeof(g_buildError), "VicDerived::build: Derived fields depend on each other");
+            g_nodeCount = 0;
+            g_opCount = 0;
+            return false;
+        }
+
+        placed[next] = true;
+        g_nodes[g_nodeCount++] = compiled[next];
+    }
+
+    return true;
+}
+
+const char *VicDerived::getBuildError()
+{
+    return g_buildError;
+}
+
+size_t VicDerived::getNodeCount()
+{
+    return g_nodeCount;
+}
+
+const VicDerivedNode *VicDerived::getNode(size_t index)
+{
+    if (index >= g_nodeCount)
+    {
+        return 0;
+    }
+
+    return &(g_nodes[index]);
+}
+
+bool VicDerived::dependsOn(const VicDerivedNode &node, const uint32_t *changed)
+{
+    for (size_t w = 0; w < VIC_FIELD_WORDS; w++)
+    {
+        if ((node.inputs[w] & changed[w]) != 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool VicDerived::evaluate(const VicDerivedNode &node, const VicSlot *slots, int32_t *result)
+{
+    float stack[MAX_VIC_DERIVED_STACK];
+    size_t depth = 0;
+
+    const VicDerivedOp *op = g_ops + node.firstOp;
+    for (size_t i = 0; i < node.opCount; i++, op++)
+    {
+        switch (op->code)
+        {
+        case VIC_OP_FIELD:
+            if ((slots[op->fieldId].flags & VIC_SLOT_SET) == 0)
+            {
+                return false;
+            }
+            stack[depth++] = slots[op->fieldId].value * op->value;
+            break;
+
+        case VIC_OP_CONST:
+            stack[depth++] = op->value;
+            break;
+
+        case VIC_OP_NEG:
+            stack[depth - 1] = -stack[depth - 1];
+            break;
+
+        default:
+        {
+            float b = stack[--depth];
+            float &a = stack[depth - 1];
+            switch (op->code)
+            {
+            case VIC_OP_ADD:
+                a += b;
+                break;
+            case VIC_OP_SUB:
+                a -= b;
+                break;
+            case VIC_OP_MUL:
+                a *= b;
+                break;
+            default:
+                a = (b != 0) ? a / b : 0;
+                break;
+            }
+            break;
+        }
+        }
+    }
+
+    float value = stack[0] * node.scale;
+    if (!(value > -2147483520.0f) || !(value < 2147483520.0f))
+    {
+        return false;
+    }
+
+    *result = lroundf(value);
+    return true;
+}
@@ -0,0 +1,76 @@
+#include <string.h>
+#include "vic_discovery.hpp"
+
+static const uint8_t magic[VIC_DISCOVERY_MAGIC_LEN] = {0xde, 0xad, 0xfa, 0xce,
+                                                        0xb0, 0x0b, 0x1e, 0xdd};
+
+VicDiscovery::VicDiscovery()
+    : _seq(0), _sent_us(0), _count(0)
+{
+}
+
+size_t VicDiscovery::makeRequest(uint8_t *dest, const uint8_t *ip, uint16_t replyPort, uint32_t now_us)
+{
+    _seq++;
+    _sent_us = now_us;
+    _count = 0;
+
+    size_t len = 0;
+    memcpy(dest, magic, VIC_DISCOVERY_MAGIC_LEN);
+    len += VIC_DISCOVERY_MAGIC_LEN;
+    memcpy(dest + len, ip, 4);
+    len += 4;
+    dest[len++] = replyPort >> 8;
+    dest[len++] = replyPort & 0xff;
+    dest[len++] = VIC_DISCOVERY_VERSION;
+    dest[len++] = _seq >> 8;
+    dest[len++] = _seq & 0xff;
+
+    return len;
+}
+
+bool VicDiscovery::onReply(const uint8_t *data, size_t len, uint32_t now_us)
+{
+    if (((len != VIC_DISCOVERY_REPLY_V1_LEN) && (len < VIC_DISCOVERY_REPLY_LEN)) ||
+        (memcmp(data, magic, VIC_DISCOVERY_MAGIC_LEN) != 0))
+    {
+        return false;
+    }
+
+    VicBrokerOffer offer;
+    memcpy(offer.broker.ip, data + 8, 4);
+    offer.broker.port = (data[12] << 8) | data[13];
+    offer.version = 1;
+    if (len >= VIC_DISCOVERY_REPLY_LEN)
+    {
+        uint16_t seq = (data[15] << 8) | data[16];
+        if ((data[14] < 2) || (seq != _seq))
+        {
+            return false;
+        }
+        offer.version = data[14];
+        offer.load = data[17];
+    }
+    offer.rtt_us = now_us - _sent_us;
+
+    if ((!offer.broker.isValid()) || (_count >= MAX_VIC_BROKERS))
+    {
+        return false;
+    }
+
+    _offers[_count++] = offer;
+    return true;
+}
+
+bool VicDiscovery::take(VicBrokerOffer &offer)
+{
+    if (_count == 0)
+    {
+        return false;
+    }
+
+    offer = _offers[0];
+    _count--;
+    memmove(_offers, _offers + 1, _count * sizeof(VicBrokerOffer));
+    return true;
+}
@@ -0,0 +1,332 @@
+#include <stdio.h>
+#include <string.h>
+#include <ArduinoJson.h>
+#include "vic_encoding.hpp"
+#include "victron_defs.hpp"
+
+#define MAX_BENCH_STATE_DOC 8192
+#define MAX_BENCH_PAYLOAD 4096
+
+VicEncodingFormat VicEncoding::formatFromName(const char *name)
+{
+    if ((name != 0) && (strcmp(name, "msgpack") == 0))
+    {
+        return VIC_ENCODING_MSGPACK;
+    }
+
+    return VIC_ENCODING_JSON;
+}
+
+// Topic key of a changed field or register. Fields are keyed by label
+// ('#' is not allowed in a topic), registers by reg_<id>.
+bool VicEncoding::deltaKey(const VicDelta &delta, char *key, size_t sizeKey)
+{
+    if (delta.kind == VIC_DELTA_REGISTER)
+    {
+        snprintf(key, sizeKey, "reg_%04x", delta.reg);
+        return true;
+    }
+
+    if (delta.kind != VIC_DELTA_FIELD)
+    {
+        return false;
+    }
+
+    return fieldKey(delta.fieldId, key, sizeKey);
+}
+
+// A field's topic key, its defined key with # made MQTT safe
+bool VicEncoding::fieldKey(uint8_t fieldId, char *key, size_t sizeKey)
+{
+    const VicFieldDef *fieldDef = VictronDefs::getField(fieldId);
+    if (fieldDef == 0)
+    {
+        return false;
+    }
+
+    snprintf(key, sizeKey, "%s", fieldDef->key);
+    for (char *c = key; *c != '\0'; c++)
+    {
+        if (*c == '#')
+        {
+            *c = '-';
+        }
+    }
+
+    return true;
+}
+
+static void formatRegister(const VicDelta &delta, char *value, size_t sizeValue)
+{
+    value[0] = '\0';
+    for (size_t i = 0; (i < delta.len) && ((i * 2) + 2 < sizeValue); i++)
+    {
+        sprintf(value + (i * 2), "%02X", delta.data[i]);
+    }
+}
+
+// Formats a changed field or register into its topic key, value and
+// units. Registers have no units.
+bool VicEncoding::formatDelta(const VicDelta &delta,
+                              char *key, size_t sizeKey,
+                              char *value, size_t sizeValue,
+                              char *units, size_t sizeUnits)
+{
+    if (!deltaKey(delta, key, sizeKey))
+    {
+        return false;
+    }
+
+    if (delta.kind == VIC_DELTA_REGISTER)
+    {
+        formatRegister(delta, value, sizeValue);
+        units[0] = '\0';
+        return true;
+    }
+
+    VEDirectText::formatValue(value, sizeValue, units, sizeUnits,
+                              delta.value, (const char *)delta.data,
+                              VictronDefs::getField(delta.fieldId)->type);
+
+    return true;
+}
+
+// Adds the raw value of a field, or the hex of a register, to a
+// MessagePack array. Non-const char * so the document keeps a copy.
+static void addRaw(JsonArray array, const VicDelta &delta)
+{
+    if (delta.kind == VIC_DELTA_REGISTER)
+    {
+        char value[MAX_VIC_FORMATTED];
+        formatRegister(delta, value, sizeof(value));
+        array.add(delta.reg);
+        array.add((char *)value);
+        return;
+    }
+
+    const VicFieldDef *fieldDef = VictronDefs::getField(delta.fieldId);
+    array.add(delta.fieldId);
+    if (VictronDefs::isTextType(fieldDef->type))
+    {
+        array.add((char *)delta.data);
+    }
+    else
+    {
+        array.add(delta.value);
+    }
+}
+
+// Payload for one field's own topic, 0 if there is nothing to send
+size_t VicEncoding::encodeDelta(VicEncodingFormat format,
+                                const VicDelta &delta,
+                                char *dest, size_t size)
+{
+    char key[MAX_VIC_KEY];
+    StaticJsonDocument<256> fieldDoc;
+
+    if (!deltaKey(delta, key, sizeof(key)))
+    {
+        return 0;
+    }
+
+    if (format == VIC_ENCODING_MSGPACK)
+    {
+        addRaw(fieldDoc.to<JsonArray>(), delta);
+        return serializeMsgPack(fieldDoc, dest, size);
+    }
+
+    char value[MAX_VIC_FORMATTED];
+    char units[MAX_VIC_FORMATTED];
+    formatDelta(delta, key, sizeof(key),
+                value, sizeof(value),
+                units, sizeof(units));
+
+    fieldDoc["value"] = (const char *)value;
+    if (delta.kind == VIC_DELTA_FIELD)
+    {
+        fieldDoc["units"] = (const char *)units;
+    }
+    return serializeJsonPretty(fieldDoc, dest, size);
+}
+
+void VicEncoding::addToState(VicEncodingFormat format,
+                             JsonDocument &state,
+                             const VicDelta &delta)
+{
+    char key[MAX_VIC_KEY];
+    char value[MAX_VIC_FORMATTED];
+    char units[MAX_VIC_FORMATTED];
+
+    if ((delta.kind != VIC_DELTA_FIELD) && (delta.kind != VIC_DELTA_REGISTER))
+    {
+        return;
+    }
+
+    if (format == VIC_ENCODING_MSGPACK)
+    {
+        const char *name = (delta.kind == VIC_DELTA_FIELD) ? "f" : "r";
+        JsonArray array = state[name];
+        if (array.isNull())
+        {
+            array = state.createNestedArray(name);
+        }
+        addRaw(array, delta);
+        return;
+    }
+
+    if (!formatDelta(delta, key, sizeof(key),
+                     value, sizeof(value),
+                     units, sizeof(units)))
+    {
+        return;
+    }
+
+    // Non-const char * so the document keeps its own copies
+    JsonObject field = state.createNestedObject((char *)key);
+    field["value"] = (char *)value;
+    if (delta.kind == VIC_DELTA_FIELD)
+    {
+        field["units"] = (char *)units;
+    }
+}
+
+// A state that overflowed the document is encoded with what fit
+size_t VicEncoding::encodeState(VicEncodingFormat format,
+                                JsonDocument &state,
+                                char *dest, size_t size)
+{
+    if (format == VIC_ENCODING_MSGPACK)
+    {
+        return serializeMsgPack(state, dest, size);
+    }
+
+    return serializeJson(state, dest, size);
+}
+
+size_t VicEncoding::encodeSchema(VicEncodingFormat format,
+                                 JsonDocument &schema,
+                                 char *dest, size_t size)
+{
+    schema.clear();
+    JsonArray fields = schema.createNestedArray("fields");
+
+    size_t count = VictronDefs::getFieldCount();
+    for (size_t id = 0; id < count; id++)
+    {
+        const VicFieldDef *fieldDef = VictronDefs::getField(id);
+        if (fieldDef == 0)
+        {
+            continue;
+        }
+
+        const VicTypeScale *scale = VictronDefs::getTypeScale(fieldDef->type);
+        JsonArray field = fields.createNestedArray();
+        field.add(fieldDef->id);
+        field.add(fieldDef->key);
+        field.add(scale->units);
+        field.add(scale->decimals);
+        field.add(VictronDefs::typeName(fieldDef->type));
+    }
+
+    if (format == VIC_ENCODING_MSGPACK)
+    {
+        return serializeMsgPack(schema, dest, size);
+    }
+
+    return serializeJson(schema, dest, size);
+}
+
+//
+// Encodes one change of every known field, per field and as a state,
+// in both formats and reports payload bytes and the time for
+// VIC_BENCH_ITERATIONS rounds of each. Topics are not counted.
+//
+
+static void benchDeltas(VicDelta *deltas, size_t *count)
+{
+    *count = 0;
+    size_t fieldCount = VictronDefs::getFieldCount();
+    for (size_t id = 0; (id < fieldCount) && (*count < MAX_VIC_FIELDS); id++)
+    {
+        const VicFieldDef *fieldDef = VictronDefs::getField(id);
+        if (fieldDef == 0)
+        {
+            continue;
+        }
+
+        VicDelta &delta = deltas[(*count)++];
+        delta.kind = VIC_DELTA_FIELD;
+        delta.fieldId = id;
+        delta.value = 1284 + id;
+        delta.len = snprintf((char *)delta.data, sizeof(delta.data), "%s",
+                             VictronDefs::isTextType(fieldDef->type) ? "HQ2028ABCDE" : "");
+    }
+}
+
+static void benchPerField(VicClock *clock,
+                          JsonObject result,
+                          VicEncodingFormat format,
+                          const VicDelta *deltas, size_t count,
+                          char *buf, size_t size)
+{
+    uint32_t bytes = 0;
+    uint32_t start = clock->micros();
+    for (int n = 0; n < VIC_BENCH_ITERATIONS; n++)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            bytes += VicEncoding::encodeDelta(format, deltas[i], buf, size);
+        }
+    }
+
+    result["messages"] = count;
+    result["bytes"] = bytes / VIC_BENCH_ITERATIONS;
+    result["us"] = (clock->micros() - start) / VIC_BENCH_ITERATIONS;
+}
+
+static void benchState(VicClock *clock,
+                       JsonObject result,
+                       VicEncodingFormat format,
+                       const VicDelta *deltas, size_t count,
+                       char *buf, size_t size)
+{
+    DynamicJsonDocument state(MAX_BENCH_STATE_DOC);
+    uint32_t bytes = 0;
+    uint32_t start = clock->micros();
+    for (int n = 0; n < VIC_BENCH_ITERATIONS; n++)
+    {
+        state.clear();
+        for (size_t i = 0; i < count; i++)
+        {
+            VicEncoding::addToState(format, state, deltas[i]);
+        }
+        bytes += VicEncoding::encodeState(format, state, buf, size);
+    }
+
+    result["messages"] = 1;
+    result["bytes"] = bytes / VIC_BENCH_ITERATIONS;
+    result["us"] = (clock->micros() - start) / VIC_BENCH_ITERATIONS;
+}
+
+void VicEncoding::benchmark(VicClock *clock, JsonDocument &result)
+{
+    // Only allocated for the run, this is a one-off
+    VicDelta *deltas = new VicDelta[MAX_VIC_FIELDS];
+    char *buf = new char[MAX_BENCH_PAYLOAD];
+    size_t count;
+
+    benchDeltas(deltas, &count);
+
+    result["iterations"] = VIC_BENCH_ITERATIONS;
+    benchPerField(clock, result.createNestedObject("json"),
+                  VIC_ENCODING_JSON, deltas, count, buf, MAX_BENCH_PAYLOAD);
+    benchPerField(clock, result.createNestedObject("msgpack"),
+                  VIC_ENCODING_MSGPACK, deltas, count, buf, MAX_BENCH_PAYLOAD);
+    benchState(clock, result.createNestedObject("jsonState"),
+               VIC_ENCODING_JSON, deltas, count, buf, MAX_BENCH_PAYLOAD);
+    benchState(clock, result.createNestedObject("msgpackState"),
+               VIC_ENCODING_MSGPACK, deltas, count, buf, MAX_BENCH_PAYLOAD);
+
+    delete[] buf;
+    delete[] deltas;
+}
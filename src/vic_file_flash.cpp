@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <string.h>
+#include "vic_file_flash.hpp"
+
+VicFileFlash::VicFileFlash()
+    : _file(0), _size(0), _sectorSize(0), _erases(0)
+{
+}
+
+VicFileFlash::~VicFileFlash()
+{
+    close();
+}
+
+bool VicFileFlash::open(const char *path, size_t size, size_t sectorSize)
+{
+    close();
+
+    if ((sectorSize == 0) || (size % sectorSize != 0))
+    {
+        return false;
+    }
+
+    _file = fopen(path, "r+b");
+    if (_file == 0)
+    {
+        _file = fopen(path, "w+b");
+    }
+    if (_file == 0)
+    {
+        return false;
+    }
+
+    _size = size;
+    _sectorSize = sectorSize;
+    _erases = 0;
+
+    // Anything the file doesn't cover yet reads as erased
+    fseek(_file, 0, SEEK_END);
+    long len = ftell(_file);
+    for (long i = (len < 0) ? 0 : len; i < (long)size; i++)
+    {
+        fputc(0xff, _file);
+    }
+    fflush(_file);
+
+    return true;
+}
+
+void VicFileFlash::close()
+{
+    if (_file != 0)
+    {
+        fclose(_file);
+        _file = 0;
+    }
+}
+
+size_t VicFileFlash::getSize()
+{
+    return _size;
+}
+
+size_t VicFileFlash::getSectorSize()
+{
+    return _sectorSize;
+}
+
+bool VicFileFlash::read(size_t offset, void *dest, size_t len)
+{
+    if ((_file == 0) || (offset + len > _size))
+    {
+        return false;
+    }
+
+    fseek(_file, offset, SEEK_SET);
+    return fread(dest, 1, len, _file) == len;
+}
+
+bool VicFileFlash::write(size_t offset, const void *src, size_t len)
+{
+    if ((_file == 0) || (offset + len > _size))
+    {
+        return false;
+    }
+
+    const uint8_t *bytes = (const uint8_t *)src;
+    uint8_t buf[256];
+    for (size_t done = 0; done < len;)
+    {
+        size_t chunk = (len - done < sizeof(buf)) ? len - done : sizeof(buf);
+        if (!read(offset + done, buf, chunk))
+        {
+            return false;
+        }
+        for (size_t i = 0; i < chunk; i++)
+        {
+            buf[i] &= bytes[done + i];
+        }
+        fseek(_file, offset + done, SEEK_SET);
+        if (fwrite(buf, 1, chunk, _file) != chunk)
+        {
+            return false;
+        }
+        done += chunk;
+    }
+    fflush(_file);
+
+    return true;
+}
+
+bool VicFileFlash::eraseSector(size_t offset)
+{
+    if ((_file == 0) || (offset % _sectorSize != 0) || (offset >= _size))
+    {
+        return false;
+    }
+
+    uint8_t buf[256];
+    memset(buf, 0xff, sizeof(buf));
+    fseek(_file, offset, SEEK_SET);
+    for (size_t done = 0; done < _sectorSize; done += sizeof(buf))
+    {
+        size_t chunk = (_sectorSize - done < sizeof(buf)) ? _sectorSize - done : sizeof(buf);
+        fwrite(buf, 1, chunk, _file);
+    }
+    fflush(_file);
+    _erases++;
+
+    return true;
+}
+
+uint32_t VicFileFlash::getErases()
+{
+    return _erases;
+}
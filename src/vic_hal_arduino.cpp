@@ -0,0 +1,52 @@
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <AsyncMqttClient.h>
+#include <time.h>
+#include "vic_hal_arduino.hpp"
+
+VicSpiffsFile::VicSpiffsFile(File file)
+    : _file(file) {}
+
+int VicSpiffsFile::read()
+{
+    return _file.read();
+}
+
+size_t VicSpiffsFile::readBytes(char *dest, size_t size)
+{
+    return _file.readBytes(dest, size);
+}
+
+const char *VicSpiffsFile::name()
+{
+    return _file.name();
+}
+
+uint32_t VicArduinoClock::millis()
+{
+    return ::millis();
+}
+
+uint32_t VicArduinoClock::micros()
+{
+    return ::micros();
+}
+
+uint32_t VicArduinoClock::time()
+{
+    return ::time(0);
+}
+
+VicAsyncMqttSink::VicAsyncMqttSink(AsyncMqttClient *client)
+    : _client(client) {}
+
+bool VicAsyncMqttSink::connected()
+{
+    return _client->connected();
+}
+
+bool VicAsyncMqttSink::publish(const char *topic, uint8_t qos, bool retain,
+                               const char *payload, size_t len)
+{
+    return _client->publish(topic, qos, retain, payload, len) != 0;
+}
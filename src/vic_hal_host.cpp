@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <time.h>
+#include "vic_hal_host.hpp"
+
+VicStdioFile::VicStdioFile()
+    : _file(0),
+      _name("") {}
+
+VicStdioFile::~VicStdioFile()
+{
+    close();
+}
+
+bool VicStdioFile::open(const char *path)
+{
+    close();
+
+    _file = fopen(path, "rb");
+    _name = path;
+
+    return _file != 0;
+}
+
+void VicStdioFile::close()
+{
+    if (_file != 0)
+    {
+        fclose(_file);
+        _file = 0;
+    }
+}
+
+int VicStdioFile::read()
+{
+    return (_file != 0) ? fgetc(_file) : -1;
+}
+
+size_t VicStdioFile::readBytes(char *dest, size_t size)
+{
+    return (_file != 0) ? fread(dest, 1, size, _file) : 0;
+}
+
+const char *VicStdioFile::name()
+{
+    return _name;
+}
+
+VicHostClock::VicHostClock()
+{
+    _start = nowMicros();
+}
+
+uint64_t VicHostClock::nowMicros()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+uint32_t VicHostClock::millis()
+{
+    return (nowMicros() - _start) / 1000;
+}
+
+uint32_t VicHostClock::micros()
+{
+    return nowMicros() - _start;
+}
+
+uint32_t VicHostClock::time()
+{
+    return ::time(0);
+}
+
+VicManualClock::VicManualClock(uint32_t start)
+    : _start(start),
+      _micros(0) {}
+
+void VicManualClock::advance(uint32_t ms)
+{
+    _micros += (uint64_t)ms * 1000;
+}
+
+uint32_t VicManualClock::millis()
+{
+    return _micros / 1000;
+}
+
+uint32_t VicManualClock::micros()
+{
+    return _micros;
+}
+
+uint32_t VicManualClock::time()
+{
+    return _start + (_micros / 1000000);
+}
+
+VicPrintMqttSink::VicPrintMqttSink(FILE *out)
+    : _out(out),
+      _connected(true),
+      _publishes(0),
+      _bytes(0) {}
+
+void VicPrintMqttSink::setConnected(bool connected)
+{
+    _connected = connected;
+}
+
+bool VicPrintMqttSink::connected()
+{
+    return _connected;
+}
+
+bool VicPrintMqttSink::publish(const char *topic, uint8_t qos, bool retain,
+                               const char *payload, size_t len)
+{
+    if (!_connected)
+    {
+        return false;
+    }
+
+    _publishes++;
+    _bytes += len;
+
+    if (_out == 0)
+    {
+        return true;
+    }
+
+    bool text = true;
+    for (size_t i = 0; i < len; i++)
+    {
+        uint8_t c = payload[i];
+        if ((c < 0x20) && (c != '\n') && (c != '\r') && (c != '\t'))
+        {
+            text = false;
+            break;
+        }
+    }
+
+    fprintf(_out, "%s%s ", topic, retain ? " (retained)" : "");
+    for (size_t i = 0; i < len; i++)
+    {
+        if (text)
+        {
+            fputc((payload[i] == '\n') ? ' ' : payload[i], _out);
+        }
+        else
+        {
+            fprintf(_out, "%02x", (uint8_t)payload[i]);
+        }
+    }
+    fputc('\n', _out);
+
+    return true;
+}
+
+uint32_t VicPrintMqttSink::getPublishes()
+{
+    return _publishes;
+}
+
+uint32_t VicPrintMqttSink::getBytes()
+{
+    return _bytes;
+}
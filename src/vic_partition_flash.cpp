@@ -0,0 +1,44 @@
+#include <esp_partition.h>
+#include "vic_partition_flash.hpp"
+
+VicPartitionFlash::VicPartitionFlash()
+    : _partition(0)
+{
+}
+
+bool VicPartitionFlash::begin(const char *label)
+{
+    _partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                          ESP_PARTITION_SUBTYPE_ANY,
+                                          label);
+
+    return _partition != 0;
+}
+
+size_t VicPartitionFlash::getSize()
+{
+    return (_partition != 0) ? _partition->size : 0;
+}
+
+size_t VicPartitionFlash::getSectorSize()
+{
+    return SPI_FLASH_SEC_SIZE;
+}
+
+bool VicPartitionFlash::read(size_t offset, void *dest, size_t len)
+{
+    return (_partition != 0) &&
+           (esp_partition_read(_partition, offset, dest, len) == ESP_OK);
+}
+
+bool VicPartitionFlash::write(size_t offset, const void *src, size_t len)
+{
+    return (_partition != 0) &&
+           (esp_partition_write(_partition, offset, src, len) == ESP_OK);
+}
+
+bool VicPartitionFlash::eraseSector(size_t offset)
+{
+    return (_partition != 0) &&
+           (esp_partition_erase_range(_partition, offset, SPI_FLASH_SEC_SIZE) == ESP_OK);
+}
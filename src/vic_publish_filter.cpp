@@ -0,0 +1,180 @@
+#include <stdlib.h>
+#include <ArduinoJson.h>
+#include "vic_publish_filter.hpp"
+#include "victron_defs.hpp"
+
+VicFilterSlot::VicFilterSlot()
+    : latest(0), published(0), publishedMillis(0), flags(0) {}
+
+VicPublishFilter::VicPublishFilter()
+    : _policyCount(0),
+      _suppressed(0)
+{
+}
+
+// Everything known is sent again on the next nextDue() pass, e.g.
+// after a reconnect
+void VicPublishFilter::reset()
+{
+    for (int i = 0; i < MAX_VIC_FIELDS; i++)
+    {
+        _slots[i].flags &= ~VIC_FILTER_PUBLISHED;
+    }
+}
+
+// Overrides the field's policy for this device only
+bool VicPublishFilter::setPolicy(uint8_t fieldId, const VicPolicy &policy)
+{
+    for (size_t i = 0; i < _policyCount; i++)
+    {
+        if (_policies[i].fieldId == fieldId)
+        {
+            _policies[i].policy = policy;
+            return true;
+        }
+    }
+
+    if (_policyCount >= MAX_VIC_DEVICE_POLICIES)
+    {
+        return false;
+    }
+
+    _policies[_policyCount].fieldId = fieldId;
+    _policies[_policyCount].policy = policy;
+    _policyCount++;
+
+    return true;
+}
+
+// A "policies" object as in victron_data_def.json, keyed by field name
+bool VicPublishFilter::loadPolicies(JsonObject policies)
+{
+    for (JsonPair kv : policies)
+    {
+        const VicFieldDef *fieldDef = VictronDefs::lookupField(kv.key().c_str());
+        JsonObject p = kv.value();
+        if ((fieldDef == 0) || p.isNull() ||
+            (!setPolicy(fieldDef->id, VEDirectText::parsePolicy(p, *getPolicy(fieldDef->id)))))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+const VicPolicy *VicPublishFilter::getPolicy(uint8_t fieldId)
+{
+    for (size_t i = 0; i < _policyCount; i++)
+    {
+        if (_policies[i].fieldId == fieldId)
+        {
+            return &(_policies[i].policy);
+        }
+    }
+
+    return VictronDefs::getPolicy(fieldId);
+}
+
+uint32_t VicPublishFilter::getSuppressed()
+{
+    return _suppressed;
+}
+
+bool VicPublishFilter::isFiltered(uint8_t fieldId)
+{
+    const VicFieldDef *fieldDef = VictronDefs::getField(fieldId);
+
+    return (fieldId < MAX_VIC_FIELDS) &&
+           (fieldDef != 0) &&
+           (!VictronDefs::isTextType(fieldDef->type));
+}
+
+bool VicPublishFilter::isDue(uint8_t fieldId, uint32_t now_ms)
+{
+    const VicFilterSlot &slot = _slots[fieldId];
+    if ((slot.flags & VIC_FILTER_PUBLISHED) == 0)
+    {
+        return true;
+    }
+
+    const VicPolicy *policy = getPolicy(fieldId);
+    uint32_t elapsed = now_ms - slot.publishedMillis;
+
+    if ((policy->maxInterval_s != 0) &&
+        (elapsed >= (uint32_t)policy->maxInterval_s * 1000))
+    {
+        return true;
+    }
+
+    if ((slot.latest == slot.published) ||
+        (elapsed < (uint32_t)policy->minInterval_s * 1000))
+    {
+        return false;
+    }
+
+    int64_t threshold = ((int64_t)llabs(slot.published) * policy->deadbandPctTenth) / 1000;
+    if (threshold < policy->deadband)
+    {
+        threshold = policy->deadband;
+    }
+
+    return llabs((int64_t)slot.latest - slot.published) > threshold;
+}
+
+void VicPublishFilter::markPublished(uint8_t fieldId, uint32_t now_ms)
+{
+    VicFilterSlot &slot = _slots[fieldId];
+    slot.published = slot.latest;
+    slot.publishedMillis = now_ms;
+    slot.flags |= VIC_FILTER_PUBLISHED;
+}
+
+// Records the change, true if it should be published now
+bool VicPublishFilter::offer(const VicDelta &delta, uint32_t now_ms)
+{
+    if ((delta.kind != VIC_DELTA_FIELD) || (!isFiltered(delta.fieldId)))
+    {
+        return true;
+    }
+
+    _slots[delta.fieldId].latest = delta.value;
+    _slots[delta.fieldId].flags |= VIC_FILTER_SEEN;
+
+    if (isDue(delta.fieldId, now_ms))
+    {
+        markPublished(delta.fieldId, now_ms);
+        return true;
+    }
+
+    _suppressed++;
+    return false;
+}
+
+// Next field after fieldId that is due, with its current value in
+// delta, -1 to start, -1 when done. Returned fields count as published.
+int VicPublishFilter::nextDue(int fieldId, uint32_t now_ms, VicDelta *delta)
+{
+    for (int id = fieldId + 1; id < MAX_VIC_FIELDS; id++)
+    {
+        if (((_slots[id].flags & VIC_FILTER_SEEN) == 0) ||
+            (!isFiltered(id)) ||
+            (!isDue(id, now_ms)))
+        {
+            continue;
+        }
+
+        markPublished(id, now_ms);
+
+        delta->kind = VIC_DELTA_FIELD;
+        delta->fieldId = id;
+        delta->reg = 0;
+        delta->value = _slots[id].latest;
+        delta->len = 0;
+        delta->data[0] = '\0';
+
+        return id;
+    }
+
+    return -1;
+}
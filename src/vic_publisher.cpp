@@ -0,0 +1,547 @@
+#include <stdio.h>
+#include <string.h>
+#include <ArduinoJson.h>
+#include "vic_publisher.hpp"
+#include "victron_defs.hpp"
+#include "ve_direct_hex.hpp"
+
+static const uint32_t statsRate_ms = 60000;
+
+// How often held back changes and heartbeats are checked for, see the
+// "policies" section of victron_data_def.json
+static const uint32_t policyRate_ms = 1000;
+
+static const uint32_t logFlushRate_ms = 60000;
+static const uint32_t replayRate_ms = 1000;
+
+VicInput::VicInput()
+    : source(0),
+      pollRegisters(0),
+      pollCount(0),
+      resendText(false)
+{
+    mqttBase[0] = 0;
+}
+
+VicPublishOptions::VicPublishOptions()
+    : batch(false),
+      encoding(VIC_ENCODING_JSON),
+      raw(true),
+      windowCount(0),
+      replayRate(50),
+      backlogSeries(false) {}
+
+//
+// Reader side
+//
+
+size_t VicPublisher::readInput(VicInput &input, uint32_t wait_ms)
+{
+    uint8_t buf[MAX_READ];
+    if (input.processor.hasChanges() && (wait_ms > VIC_QUEUE_RETRY_MS))
+    {
+        wait_ms = VIC_QUEUE_RETRY_MS;
+    }
+    size_t len = input.source->read(buf, sizeof(buf), wait_ms);
+    if (len > 0)
+    {
+        input.processor.handleBytes(buf, len);
+    }
+
+    if (input.resendText.exchange(false))
+    {
+        input.processor.markTextChanged();
+    }
+
+    if (input.processor.hasChanges())
+    {
+        input.processor.takeChanges(input.queue);
+    }
+
+    return len;
+}
+
+void VicPublisher::pollHex(VicInput &input)
+{
+    char frame[20];
+
+    for (size_t j = 0; j < input.pollCount; j++)
+    {
+        size_t len = VEDirectHex::encodeGet(frame, sizeof(frame),
+                                            input.pollRegisters[j]);
+        input.source->write((const uint8_t *)frame, len);
+    }
+}
+
+//
+// Publisher side
+//
+
+VicPublisher::VicPublisher(VicMqttSink *mqtt, VicClock *clock, VicRingLog *log)
+    : _mqtt(mqtt),
+      _clock(clock),
+      _log(log),
+      _inputs(0),
+      _inputCount(0),
+      _wasConnected(false),
+      _nextStatsMillis(0),
+      _nextPolicyMillis(0),
+      _nextLogFlushMillis(0),
+      _nextReplayMillis(0) {}
+
+void VicPublisher::begin(VicInput *const *inputs, size_t inputCount,
+                         const VicPublishOptions &options)
+{
+    _inputs = inputs;
+    _inputCount = inputCount;
+    _options = options;
+
+    uint16_t maxReplay = _options.backlogSeries ? MAX_REPLAY_SERIES : MAX_REPLAY;
+    if (_options.replayRate > maxReplay)
+    {
+        _options.replayRate = maxReplay;
+    }
+
+    uint32_t now = _clock->millis();
+    for (size_t i = 0; i < _inputCount; i++)
+    {
+        _inputs[i]->topics.build(_inputs[i]->mqttBase);
+        for (size_t w = 0; w < _options.windowCount; w++)
+        {
+            _inputs[i]->aggregator.addWindow(_options.windows[w], now);
+        }
+    }
+
+    _wasConnected = false;
+    _nextStatsMillis = now + statsRate_ms;
+    _nextPolicyMillis = now + policyRate_ms;
+    _nextLogFlushMillis = now + logFlushRate_ms;
+    _nextReplayMillis = now + replayRate_ms;
+}
+
+void VicPublisher::poll()
+{
+    bool connected = _mqtt->connected();
+    if (connected && !_wasConnected)
+    {
+        // Nothing sent while disconnected, start over with current values.
+        // Text fields aren't logged, the readers send them again.
+        for (size_t i = 0; i < _inputCount; i++)
+        {
+            _inputs[i]->filter.reset();
+            _inputs[i]->resendText = true;
+        }
+
+        publishSchemas();
+    }
+    _wasConnected = connected;
+
+    if (_clock->millis() > _nextStatsMillis)
+    {
+        publishStats();
+
+        _nextStatsMillis += statsRate_ms;
+    }
+
+    if (_clock->millis() > _nextPolicyMillis)
+    {
+        doPolicies();
+
+        _nextPolicyMillis += policyRate_ms;
+    }
+
+    if (_clock->millis() > _nextLogFlushMillis)
+    {
+        _log->flush();
+
+        _nextLogFlushMillis += logFlushRate_ms;
+    }
+
+    if (_clock->millis() > _nextReplayMillis)
+    {
+        doReplay();
+
+        _nextReplayMillis += replayRate_ms;
+    }
+
+    for (size_t i = 0; i < _inputCount; i++)
+    {
+        drain(i);
+    }
+
+    doAggregates();
+}
+
+// Always drain, changes that arrive while disconnected are logged for
+// replay and still tracked by the filter and the aggregates
+void VicPublisher::drain(int device)
+{
+    VicInput &input = *_inputs[device];
+
+    VicDelta delta;
+    while (input.queue.pop(&delta))
+    {
+        input.aggregator.add(delta, _clock->millis());
+
+        bool send = input.filter.offer(delta, _clock->millis());
+        if (!_mqtt->connected())
+        {
+            input.state.clear();
+            if (send)
+            {
+                logDelta(device, delta);
+            }
+        }
+        else if ((!send) || (!_options.raw))
+        {
+            // Held back by the field's policy
+        }
+        else if (_options.batch)
+        {
+            addToState(input, delta);
+        }
+        else
+        {
+            publishDelta(input, delta);
+        }
+    }
+}
+
+// Only the fields that changed get encoded, one topic per field
+void VicPublisher::publishDelta(VicInput &input, const VicDelta &delta)
+{
+    size_t len = VicEncoding::encodeDelta(_options.encoding, delta, _payload, sizeof(_payload));
+    if (len == 0)
+    {
+        return;
+    }
+
+    const char *topic = (delta.kind == VIC_DELTA_FIELD) ? input.topics.getField(delta.fieldId) : 0;
+    if (topic == 0)
+    {
+        char key[MAX_VIC_KEY];
+        if (!VicEncoding::deltaKey(delta, key, sizeof(key)))
+        {
+            return;
+        }
+
+        snprintf(_topic, sizeof(_topic), "%s/%s", input.mqttBase, key);
+        topic = _topic;
+    }
+
+    _mqtt->publish(topic, 0, false, _payload, len);
+}
+
+// The device's precomputed topic, or formatted into _topic if its
+// table couldn't be allocated
+const char *VicPublisher::getTopic(VicInput &input, VicTopic topic)
+{
+    const char *precomputed = input.topics.getTopic(topic);
+    if (precomputed != 0)
+    {
+        return precomputed;
+    }
+
+    snprintf(_topic, sizeof(_topic), "%s/%s", input.mqttBase, VicTopicTable::getSuffix(topic));
+    return _topic;
+}
+
+// Batched mode collects the block's changes, and any HEX updates since
+// the last block, into one document. The block marker sends it.
+void VicPublisher::addToState(VicInput &input, const VicDelta &delta)
+{
+    if (delta.kind == VIC_DELTA_BLOCK)
+    {
+        publishState(input);
+        return;
+    }
+
+    VicEncoding::addToState(_options.encoding, input.state, delta);
+}
+
+void VicPublisher::publishState(VicInput &input)
+{
+    if (input.state.size() == 0)
+    {
+        return;
+    }
+
+    size_t len = VicEncoding::encodeState(_options.encoding, input.state, _payload, MAX_STATE_JSON);
+    input.state.clear();
+
+    _mqtt->publish(getTopic(input, VIC_TOPIC_STATE), 0, false, _payload, len);
+}
+
+// Retained, so a subscriber gets it whenever it joins. The field
+// definitions are shared, so every device gets the same schema.
+void VicPublisher::publishSchemas()
+{
+    size_t len = VicEncoding::encodeSchema(_options.encoding, _scratch, _payload, MAX_SCHEMA);
+    for (size_t i = 0; i < _inputCount; i++)
+    {
+        _mqtt->publish(getTopic(*_inputs[i], VIC_TOPIC_SCHEMA), 0, true, _payload, len);
+    }
+}
+
+void VicPublisher::publishStats()
+{
+    if (!_mqtt->connected())
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < _inputCount; i++)
+    {
+        VicInput &input = *_inputs[i];
+
+        snprintf(_payload, sizeof(_payload), "{\"good\": %lu, \"bad\": %lu}",
+                 (unsigned long)input.processor.getGoodBlocks(),
+                 (unsigned long)input.processor.getBadBlocks());
+        _mqtt->publish(getTopic(input, VIC_TOPIC_BLOCKS), 0, false, _payload, strlen(_payload));
+
+        snprintf(_payload, sizeof(_payload), "{\"highWater\": %lu, \"drops\": %lu, \"overflows\": %lu, \"suppressed\": %lu}",
+                 (unsigned long)input.queue.getHighWater(),
+                 (unsigned long)input.queue.getDrops(),
+                 (unsigned long)input.source->getOverflows(),
+                 (unsigned long)input.filter.getSuppressed());
+        _mqtt->publish(getTopic(input, VIC_TOPIC_QUEUE), 0, false, _payload, strlen(_payload));
+    }
+
+    snprintf(_payload, sizeof(_payload), "{\"backlog\": %lu, \"dropped\": %lu}",
+             (unsigned long)_log->getBacklog(),
+             (unsigned long)_log->getDropped());
+    _mqtt->publish(VIC_BOARD_BASE "/log", 0, false, _payload, strlen(_payload));
+}
+
+// Sends changes whose minInterval has passed and heartbeats. In batched
+// mode they go out with the device's next block.
+void VicPublisher::doPolicies()
+{
+    if ((!_mqtt->connected()) || (!_options.raw))
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < _inputCount; i++)
+    {
+        VicDelta delta;
+        uint32_t now = _clock->millis();
+        for (int id = _inputs[i]->filter.nextDue(-1, now, &delta);
+             id >= 0;
+             id = _inputs[i]->filter.nextDue(id, now, &delta))
+        {
+            if (_options.batch)
+            {
+                VicEncoding::addToState(_options.encoding, _inputs[i]->state, delta);
+            }
+            else
+            {
+                publishDelta(*_inputs[i], delta);
+            }
+        }
+    }
+}
+
+// Windows are reported and restarted even while disconnected, the
+// report is only published when connected
+void VicPublisher::doAggregates()
+{
+    for (size_t i = 0; i < _inputCount; i++)
+    {
+        VicAggregator &aggregator = _inputs[i]->aggregator;
+        for (size_t w = 0; w < aggregator.getWindowCount(); w++)
+        {
+            if (!aggregator.isDue(w, _clock->millis()))
+            {
+                continue;
+            }
+
+            _scratch.clear();
+            aggregator.report(w, _clock->millis(), _scratch.to<JsonObject>());
+            if ((!_mqtt->connected()) || (_scratch.size() == 0))
+            {
+                continue;
+            }
+
+            size_t len = VicEncoding::encodeState(_options.encoding, _scratch, _payload, MAX_AGG_JSON);
+            snprintf(_topic, sizeof(_topic), "%s/agg/%us", _inputs[i]->mqttBase, (unsigned)aggregator.getWindow(w));
+            _mqtt->publish(_topic, 0, false, _payload, len);
+        }
+    }
+}
+
+// Seconds since the epoch, or since boot until the clock is set
+void VicPublisher::logTime(uint32_t *time, uint8_t *flags)
+{
+    uint32_t now = _clock->time();
+    if (now > 1600000000)
+    {
+        *time = now;
+        *flags = 0;
+    }
+    else
+    {
+        *time = _clock->millis() / 1000;
+        *flags = VIC_LOG_UPTIME;
+    }
+}
+
+void VicPublisher::logValue(uint8_t device, uint8_t fieldId, int32_t value)
+{
+    uint32_t time;
+    uint8_t flags;
+    logTime(&time, &flags);
+    _log->append(device, fieldId, value, time, flags);
+}
+
+// Only numeric fields are logged, the ring log has no room for text.
+// Text fields are sent again after each connect instead, see poll().
+void VicPublisher::logDelta(int device, const VicDelta &delta)
+{
+    const VicFieldDef *fieldDef = VictronDefs::getField(delta.fieldId);
+    if ((delta.kind != VIC_DELTA_FIELD) ||
+        (fieldDef == 0) ||
+        VictronDefs::isTextType(fieldDef->type))
+    {
+        return;
+    }
+
+    logValue(device, delta.fieldId, delta.value);
+}
+
+// Replayed records for one device as rows of [time, fieldId, raw value]
+size_t VicPublisher::encodeReplayRows(size_t count, uint8_t logDevice)
+{
+    _scratch.clear();
+    JsonArray rows = _scratch.to<JsonArray>();
+    for (size_t r = 0; r < count; r++)
+    {
+        if (_records[r].device != logDevice)
+        {
+            continue;
+        }
+
+        JsonArray row = rows.createNestedArray();
+        row.add(_records[r].time);
+        row.add(_records[r].fieldId);
+        row.add(_records[r].value);
+    }
+
+    if (rows.size() == 0)
+    {
+        return 0;
+    }
+
+    return VicEncoding::encodeState(_options.encoding, _scratch, _payload, MAX_REPLAY_JSON);
+}
+
+// Replayed records for one device as one series per field, each
+// [fieldId u8][length u16 LSB first][series stream]
+size_t VicPublisher::encodeReplaySeries(size_t count, uint8_t logDevice)
+{
+    uint8_t *payload = (uint8_t *)_payload;
+    const size_t size = MAX_SERIES_PAYLOAD;
+    size_t len = 0;
+
+    memset(_replayed, 0, sizeof(_replayed));
+    for (size_t first = 0; first < count; first++)
+    {
+        if ((_replayed[first]) || (_records[first].device != logDevice) || (len + 3 > size))
+        {
+            continue;
+        }
+
+        uint8_t fieldId = _records[first].fieldId;
+        VicSeriesEncoder encoder(payload + len + 3, size - len - 3);
+        for (size_t r = first; r < count; r++)
+        {
+            if ((_records[r].device == logDevice) && (_records[r].fieldId == fieldId))
+            {
+                // MAX_SERIES_PAYLOAD covers the worst case, but should a
+                // series still run out of room the rest of the field
+                // starts another one
+                if (!encoder.add(_records[r].time, _records[r].value))
+                {
+                    break;
+                }
+                _replayed[r] = true;
+            }
+        }
+
+        if (encoder.getCount() == 0)
+        {
+            continue;
+        }
+
+        size_t seriesLen = encoder.finish();
+        payload[len] = fieldId;
+        payload[len + 1] = seriesLen & 0xff;
+        payload[len + 2] = seriesLen >> 8;
+        len += 3 + seriesLen;
+    }
+
+    return len;
+}
+
+// Each device's share of the replayed records goes out on
+// <base>/backlog, the board's own on pmcg-esp32/backlog with field 0
+// temperature and 1 humidity in hundredths. With backlogSeries set they
+// are series encoded on <base>/backlog/series instead.
+// Uptime stamps from this boot are converted once the clock is set,
+// any others go out as time 0.
+void VicPublisher::doReplay()
+{
+    if ((!_mqtt->connected()) || (!_log->hasBacklog()))
+    {
+        return;
+    }
+
+    size_t count = _log->readNext(_records, _options.replayRate);
+
+    uint32_t uptime = _clock->millis() / 1000;
+    uint32_t now = _clock->time();
+    for (size_t r = 0; r < count; r++)
+    {
+        if (_records[r].flags & VIC_LOG_UPTIME)
+        {
+            uint32_t time = _records[r].time;
+            _records[r].time = ((now > 1600000000) && (time <= uptime)) ? now - (uptime - time) : 0;
+        }
+    }
+
+    for (size_t device = 0; device <= _inputCount; device++)
+    {
+        uint8_t logDevice = (device < _inputCount) ? device : VIC_LOG_BOARD;
+
+        size_t len;
+        if (_options.backlogSeries)
+        {
+            len = encodeReplaySeries(count, logDevice);
+        }
+        else
+        {
+            len = encodeReplayRows(count, logDevice);
+        }
+
+        if (len == 0)
+        {
+            continue;
+        }
+
+        VicTopic backlog = _options.backlogSeries ? VIC_TOPIC_BACKLOG_SERIES : VIC_TOPIC_BACKLOG;
+        if (device < _inputCount)
+        {
+            _mqtt->publish(getTopic(*_inputs[device], backlog), 0, false, _payload, len);
+        }
+        else
+        {
+            _mqtt->publish(_options.backlogSeries ? VIC_BOARD_BASE "/backlog/series" : VIC_BOARD_BASE "/backlog",
+                           0, false, _payload, len);
+        }
+    }
+
+    if (!_log->hasBacklog())
+    {
+        _log->markReplayed();
+    }
+}
@@ -0,0 +1,266 @@
+#include <string.h>
+#include "vic_reconnect.hpp"
+
+VicBrokerAddr::VicBrokerAddr()
+    : port(0)
+{
+    memset(ip, 0, sizeof(ip));
+}
+
+bool VicBrokerAddr::isValid() const
+{
+    return (port != 0) && ((ip[0] | ip[1] | ip[2] | ip[3]) != 0);
+}
+
+bool VicBrokerAddr::operator==(const VicBrokerAddr &other) const
+{
+    return (port == other.port) && (memcmp(ip, other.ip, sizeof(ip)) == 0);
+}
+
+VicBrokerOffer::VicBrokerOffer()
+    : version(0), load(0), rtt_us(0) {}
+
+VicReconnectStats::VicReconnectStats()
+    : connects(0), attempts(0), discoveries(0), last_ms(0), max_ms(0), cached(false) {}
+
+VicReconnect::VicReconnect(VicBrokerLink *link, VicClock *clock)
+    : _link(link), _clock(clock), _state(VIC_RECONNECT_BACKOFF),
+      _brokerCount(0), _current(0), _first(0), _tries(0), _discovered(false),
+      _offerCount(0), _firstOfferMillis(0),
+      _stateMillis(0), _downMillis(0), _backoff_ms(VIC_BACKOFF_MIN_MS), _wait_ms(0),
+      _random(1)
+{
+}
+
+void VicReconnect::begin()
+{
+    _random = _clock->micros() | 1;
+
+    // The cached broker's round trip and load are unknown until it
+    // answers a discovery
+    _brokerCount = 0;
+    if (_link->loadBroker(_brokers[0].broker))
+    {
+        _brokerCount = 1;
+    }
+
+    _downMillis = _clock->millis();
+    startRound(0);
+}
+
+bool VicReconnect::poll()
+{
+    uint32_t now = _clock->millis();
+    bool connected = _link->connected();
+
+    if (_state == VIC_RECONNECT_CONNECTED)
+    {
+        if (!connected)
+        {
+            _downMillis = now;
+            _backoff_ms = VIC_BACKOFF_MIN_MS;
+            startRound(_current + 1);
+        }
+        return false;
+    }
+
+    if (connected && (_state == VIC_RECONNECT_CONNECTING))
+    {
+        _stats.connects++;
+        _stats.last_ms = now - _downMillis;
+        if (_stats.last_ms > _stats.max_ms)
+        {
+            _stats.max_ms = _stats.last_ms;
+        }
+        _stats.cached = !_discovered;
+
+        VicBrokerAddr saved;
+        if ((!_link->loadBroker(saved)) || !(saved == _brokers[_current].broker))
+        {
+            _link->saveBroker(_brokers[_current].broker);
+        }
+
+        _state = VIC_RECONNECT_CONNECTED;
+        _backoff_ms = VIC_BACKOFF_MIN_MS;
+        return true;
+    }
+
+    switch (_state)
+    {
+    case VIC_RECONNECT_CONNECTING:
+        if (_link->takeDropped() || (now - _stateMillis >= VIC_CONNECT_TIMEOUT_MS))
+        {
+            _link->disconnect();
+            tryNext();
+        }
+        break;
+
+    case VIC_RECONNECT_DISCOVERY:
+        collect(now);
+        break;
+
+    case VIC_RECONNECT_BACKOFF:
+        if (now - _stateMillis >= _wait_ms)
+        {
+            startRound(0);
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    return false;
+}
+
+VicReconnectState VicReconnect::getState()
+{
+    return _state;
+}
+
+const VicReconnectStats &VicReconnect::getStats()
+{
+    return _stats;
+}
+
+const VicBrokerOffer &VicReconnect::getBroker()
+{
+    return _brokers[_current];
+}
+
+size_t VicReconnect::getBrokerCount()
+{
+    return _brokerCount;
+}
+
+//
+// Static functions
+//
+
+uint32_t VicReconnect::score(const VicBrokerOffer &offer)
+{
+    return (offer.rtt_us / 1000) + (offer.load * VIC_LOAD_WEIGHT_MS);
+}
+
+//
+// Private functions
+//
+
+// Tries every known broker once, starting from first
+void VicReconnect::startRound(size_t first)
+{
+    _first = first;
+    _tries = 0;
+    _discovered = false;
+    tryNext();
+}
+
+void VicReconnect::tryNext()
+{
+    if (_tries < _brokerCount)
+    {
+        _current = (_first + _tries++) % _brokerCount;
+        _state = VIC_RECONNECT_CONNECTING;
+        _stateMillis = _clock->millis();
+        _stats.attempts++;
+        _link->takeDropped();
+        _link->connect(_brokers[_current].broker);
+    }
+    else if (!_discovered)
+    {
+        discover();
+    }
+    else
+    {
+        backoff();
+    }
+}
+
+void VicReconnect::discover()
+{
+    // Drop any late reply to an earlier broadcast
+    VicBrokerOffer stale;
+    while (_link->takeDiscovered(stale))
+    {
+    }
+
+    _discovered = true;
+    _offerCount = 0;
+    _state = VIC_RECONNECT_DISCOVERY;
+    _stateMillis = _clock->millis();
+    _stats.discoveries++;
+    _link->sendDiscovery();
+}
+
+// Gathers replies until VIC_DISCOVERY_WINDOW_MS after the first, then
+// the answers replace the known brokers, best score first. With no
+// answers the known brokers are kept for the next round.
+void VicReconnect::collect(uint32_t now)
+{
+    VicBrokerOffer offer;
+    while (_link->takeDiscovered(offer))
+    {
+        bool known = false;
+        for (size_t i = 0; i < _offerCount; i++)
+        {
+            known = known || (_offers[i].broker == offer.broker);
+        }
+        if (known || (_offerCount >= MAX_VIC_BROKERS))
+        {
+            continue;
+        }
+
+        if (_offerCount == 0)
+        {
+            _firstOfferMillis = now;
+        }
+
+        size_t at = _offerCount++;
+        while ((at > 0) && (score(offer) < score(_offers[at - 1])))
+        {
+            _offers[at] = _offers[at - 1];
+            at--;
+        }
+        _offers[at] = offer;
+    }
+
+    bool windowDone = (_offerCount > 0) && (now - _firstOfferMillis >= VIC_DISCOVERY_WINDOW_MS);
+    if ((!windowDone) && (now - _stateMillis < VIC_DISCOVERY_TIMEOUT_MS))
+    {
+        return;
+    }
+
+    if (_offerCount == 0)
+    {
+        backoff();
+        return;
+    }
+
+    for (size_t i = 0; i < _offerCount; i++)
+    {
+        _brokers[i] = _offers[i];
+    }
+    _brokerCount = _offerCount;
+    _first = 0;
+    _tries = 0;
+    tryNext();
+}
+
+// Waits between half and all of the current backoff, then doubles it
+void VicReconnect::backoff()
+{
+    _wait_ms = (_backoff_ms / 2) + (random() % ((_backoff_ms / 2) + 1));
+    _backoff_ms = (_backoff_ms >= VIC_BACKOFF_MAX_MS / 2) ? VIC_BACKOFF_MAX_MS : _backoff_ms * 2;
+
+    _state = VIC_RECONNECT_BACKOFF;
+    _stateMillis = _clock->millis();
+}
+
+// xorshift32, plenty for spreading retries
+uint32_t VicReconnect::random()
+{
+    _random ^= _random << 13;
+    _random ^= _random >> 17;
+    _random ^= _random << 5;
+    return _random;
+}
@@ -0,0 +1,309 @@
+#include <string.h>
+#include "vic_ring_log.hpp"
+
+VicRingLog::VicRingLog(VicFlash *flash)
+    : _flash(flash),
+      _mounted(false),
+      _slots(0),
+      _slotsPerSector(0),
+      _headSeq(0),
+      _tailSeq(0),
+      _sinceMark(0),
+      _dropped(0),
+      _pendingCount(0)
+{
+}
+
+// Catches records torn by a reset mid-write
+uint8_t VicRingLog::checkOf(const VicLogRecord &record)
+{
+    const uint8_t *bytes = (const uint8_t *)&record;
+    uint8_t check = 0xa5;
+    for (size_t i = 0; i < offsetof(VicLogRecord, check); i++)
+    {
+        check = (check << 1 | check >> 7) ^ bytes[i];
+    }
+
+    return check;
+}
+
+bool VicRingLog::isValid(const VicLogRecord &record)
+{
+    return (record.seq != VIC_LOG_ERASED) && (record.check == checkOf(record));
+}
+
+size_t VicRingLog::offsetOf(uint32_t seq)
+{
+    return (seq % _slots) * sizeof(VicLogRecord);
+}
+
+// Every sector but the one the head is in holds a full sector of the
+// most recent records
+uint32_t VicRingLog::oldestSeq()
+{
+    uint32_t headSectorStart = _headSeq - (_headSeq % _slotsPerSector);
+    uint32_t kept = _slots - _slotsPerSector;
+
+    return (headSectorStart > kept) ? headSectorStart - kept : 0;
+}
+
+bool VicRingLog::readRecord(uint32_t seq, VicLogRecord *dest)
+{
+    return _flash->read(offsetOf(seq), dest, sizeof(*dest)) &&
+           isValid(*dest) &&
+           (dest->seq == seq);
+}
+
+bool VicRingLog::mount()
+{
+    _mounted = false;
+
+    size_t sectorSize = _flash->getSectorSize();
+    size_t sectors = (sectorSize > 0) ? _flash->getSize() / sectorSize : 0;
+    if ((sectors < 2) || (sectorSize % sizeof(VicLogRecord) != 0))
+    {
+        return false;
+    }
+
+    _slotsPerSector = sectorSize / sizeof(VicLogRecord);
+    _slots = sectors * _slotsPerSector;
+    _pendingCount = 0;
+    _sinceMark = 0;
+
+    // The newest sector is the one whose first record has the highest seq
+    bool found = false;
+    uint32_t headSectorSeq = 0;
+    for (size_t s = 0; s < sectors; s++)
+    {
+        VicLogRecord record;
+        if (_flash->read(s * sectorSize, &record, sizeof(record)) &&
+            isValid(record) &&
+            (record.seq % _slots == s * _slotsPerSector) &&
+            ((!found) || (record.seq > headSectorSeq)))
+        {
+            headSectorSeq = record.seq;
+            found = true;
+        }
+    }
+
+    // Then the head is the first slot in that sector never written
+    _headSeq = 0;
+    if (found)
+    {
+        uint32_t i;
+        for (i = 1; i < _slotsPerSector; i++)
+        {
+            VicLogRecord record;
+            static const uint8_t erased[sizeof(VicLogRecord)] = {
+                0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+                0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+            if (!_flash->read(offsetOf(headSectorSeq + i), &record, sizeof(record)))
+            {
+                return false;
+            }
+            if (memcmp(&record, erased, sizeof(record)) == 0)
+            {
+                break;
+            }
+        }
+        _headSeq = headSectorSeq + i;
+    }
+
+    // Replay resumes after the last mark, or from the oldest record
+    uint32_t oldest = oldestSeq();
+    _tailSeq = oldest;
+    for (uint32_t seq = _headSeq; seq > oldest; seq--)
+    {
+        VicLogRecord record;
+        if (readRecord(seq - 1, &record) && (record.flags & VIC_LOG_MARK))
+        {
+            uint32_t replayed = (uint32_t)record.value + 1;
+            _tailSeq = (replayed < oldest) ? oldest
+                                           : (replayed > _headSeq) ? _headSeq : replayed;
+            break;
+        }
+    }
+
+    _mounted = true;
+
+    return true;
+}
+
+bool VicRingLog::isMounted()
+{
+    return _mounted;
+}
+
+bool VicRingLog::append(uint8_t device, uint8_t fieldId, int32_t value,
+                        uint32_t time, uint8_t flags)
+{
+    VicLogRecord record;
+    record.seq = 0; // Assigned when written
+    record.time = time;
+    record.value = value;
+    record.device = device;
+    record.fieldId = fieldId;
+    record.flags = flags;
+    record.check = 0;
+
+    return appendRecord(record);
+}
+
+bool VicRingLog::appendRecord(const VicLogRecord &record)
+{
+    if (!_mounted)
+    {
+        return false;
+    }
+
+    if (_pendingCount >= VIC_LOG_BATCH)
+    {
+        if (!flush())
+        {
+            _dropped++;
+            return false;
+        }
+    }
+
+    _pending[_pendingCount++] = record;
+
+    return true;
+}
+
+// Writes the buffered records, as one write per sector they land in
+bool VicRingLog::flush()
+{
+    if ((!_mounted) || (_pendingCount == 0))
+    {
+        return true;
+    }
+
+    size_t done = 0;
+    while (done < _pendingCount)
+    {
+        uint32_t inSector = _headSeq % _slotsPerSector;
+        if (inSector == 0)
+        {
+            // Wrapping onto the oldest sector, its records are lost
+            if (!_flash->eraseSector(offsetOf(_headSeq)))
+            {
+                return false;
+            }
+        }
+
+        size_t count = _pendingCount - done;
+        if (count > _slotsPerSector - inSector)
+        {
+            count = _slotsPerSector - inSector;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            VicLogRecord &record = _pending[done + i];
+            record.seq = _headSeq + i;
+            record.check = checkOf(record);
+        }
+
+        if (!_flash->write(offsetOf(_headSeq), &(_pending[done]),
+                           count * sizeof(VicLogRecord)))
+        {
+            return false;
+        }
+
+        _headSeq += count;
+        done += count;
+
+        uint32_t oldest = oldestSeq();
+        if (_tailSeq < oldest)
+        {
+            _dropped += oldest - _tailSeq;
+            _tailSeq = oldest;
+        }
+    }
+
+    _pendingCount = 0;
+
+    return true;
+}
+
+bool VicRingLog::hasBacklog()
+{
+    return getBacklog() > 0;
+}
+
+// Records not yet replayed, including marks and any still in RAM
+uint32_t VicRingLog::getBacklog()
+{
+    if (!_mounted)
+    {
+        return 0;
+    }
+
+    return (_headSeq + _pendingCount) - _tailSeq;
+}
+
+// Reads up to max records to replay, oldest first, skipping marks and
+// damaged records. They count as replayed once returned.
+size_t VicRingLog::readNext(VicLogRecord *dest, size_t max)
+{
+    if (!_mounted)
+    {
+        return 0;
+    }
+
+    size_t count = 0;
+    while (count < max)
+    {
+        if ((_tailSeq >= _headSeq) && ((_pendingCount == 0) || (!flush())))
+        {
+            break;
+        }
+
+        VicLogRecord &record = dest[count];
+        if (readRecord(_tailSeq, &record) && !(record.flags & VIC_LOG_MARK))
+        {
+            count++;
+        }
+        _tailSeq++;
+
+        if (++_sinceMark >= VIC_LOG_MARK_EVERY)
+        {
+            markReplayed();
+        }
+    }
+
+    return count;
+}
+
+// Remembers in flash how far replay has got. Once caught up the mark
+// covers itself, so it doesn't become backlog of its own.
+void VicRingLog::markReplayed()
+{
+    if ((!_mounted) || (_tailSeq == 0))
+    {
+        return;
+    }
+
+    uint32_t markSeq = _headSeq + _pendingCount;
+    bool caughtUp = (_tailSeq == markSeq);
+
+    VicLogRecord record;
+    record.seq = 0;
+    record.time = 0;
+    record.value = (int32_t)(caughtUp ? markSeq : _tailSeq - 1);
+    record.device = VIC_LOG_BOARD;
+    record.fieldId = 0;
+    record.flags = VIC_LOG_MARK;
+    record.check = 0;
+
+    if (appendRecord(record) && caughtUp)
+    {
+        _tailSeq = markSeq + 1;
+    }
+    _sinceMark = 0;
+}
+
+uint32_t VicRingLog::getDropped()
+{
+    return _dropped;
+}
@@ -0,0 +1,319 @@
+#include <string.h>
+#include "vic_series.hpp"
+
+// Time delta of delta buckets: prefix ones, payload bits, range
+struct VicSeriesBucket
+{
+    uint8_t ones;
+    uint8_t bits;
+    int32_t lo;
+    int32_t hi;
+};
+
+static const VicSeriesBucket g_timeBuckets[] = {
+    {1, 7, -63, 64},
+    {2, 9, -255, 256},
+    {3, 12, -2047, 2048},
+};
+
+static const uint8_t g_valueBits[] = {6, 13, 20};
+
+static uint32_t zigzag(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value)
+{
+    return (int32_t)((value >> 1) ^ (~(value & 1) + 1));
+}
+
+//
+// Encoder
+//
+
+VicSeriesEncoder::VicSeriesEncoder(uint8_t *dest, size_t size)
+    : _dest(dest),
+      _size(size),
+      _bitPos(VIC_SERIES_HEADER * 8),
+      _count(0),
+      _prevTime(0),
+      _prevDelta(0),
+      _prevValue(0)
+{
+    if (_size > 0)
+    {
+        memset(_dest, 0, _size);
+    }
+}
+
+bool VicSeriesEncoder::writeBits(uint32_t bits, uint8_t count)
+{
+    if (_bitPos + count > _size * 8)
+    {
+        return false;
+    }
+
+    for (int i = count - 1; i >= 0; i--)
+    {
+        if ((bits >> i) & 1)
+        {
+            _dest[_bitPos / 8] |= 0x80 >> (_bitPos % 8);
+        }
+        _bitPos++;
+    }
+
+    return true;
+}
+
+bool VicSeriesEncoder::writeTime(uint32_t time)
+{
+    int64_t delta = (int64_t)time - _prevTime;
+    int64_t dod = delta - _prevDelta;
+
+    _prevTime = time;
+    _prevDelta = delta;
+
+    if (dod == 0)
+    {
+        return writeBits(0, 1);
+    }
+
+    for (size_t i = 0; i < sizeof(g_timeBuckets) / sizeof(g_timeBuckets[0]); i++)
+    {
+        const VicSeriesBucket &b = g_timeBuckets[i];
+        if ((dod >= b.lo) && (dod <= b.hi))
+        {
+            // Stored offset from lo so the payload is never negative
+            return writeBits((1u << (b.ones + 1)) - 2, b.ones + 1) &&
+                   writeBits((uint32_t)(dod - b.lo), b.bits);
+        }
+    }
+
+    return writeBits(0xf, 4) && writeBits((uint32_t)dod, 32);
+}
+
+bool VicSeriesEncoder::writeValue(int32_t value)
+{
+    uint32_t zz = zigzag((int32_t)((uint32_t)value - (uint32_t)_prevValue));
+    _prevValue = value;
+
+    if (zz == 0)
+    {
+        return writeBits(0, 1);
+    }
+
+    for (uint8_t i = 0; i < sizeof(g_valueBits); i++)
+    {
+        if (zz < (1u << g_valueBits[i]))
+        {
+            return writeBits((1u << (i + 2)) - 2, i + 2) &&
+                   writeBits(zz, g_valueBits[i]);
+        }
+    }
+
+    return writeBits(0xf, 4) && writeBits(zz, 32);
+}
+
+// False, with the stream unchanged, if the sample doesn't fit
+bool VicSeriesEncoder::add(uint32_t time, int32_t value)
+{
+    if (_count == 0xffff)
+    {
+        return false;
+    }
+
+    size_t bitPos = _bitPos;
+    uint32_t prevTime = _prevTime;
+    int64_t prevDelta = _prevDelta;
+    int32_t prevValue = _prevValue;
+
+    bool ok;
+    if (_count == 0)
+    {
+        _prevTime = time;
+        _prevValue = value;
+        ok = writeBits(time, 32) && writeBits((uint32_t)value, 32);
+    }
+    else
+    {
+        ok = writeTime(time) && writeValue(value);
+    }
+
+    if (!ok)
+    {
+        // Clear any bits the partial sample set
+        for (size_t i = bitPos; (i < _bitPos) && (i < _size * 8); i++)
+        {
+            _dest[i / 8] &= ~(0x80 >> (i % 8));
+        }
+        _bitPos = bitPos;
+        _prevTime = prevTime;
+        _prevDelta = prevDelta;
+        _prevValue = prevValue;
+        return false;
+    }
+
+    _count++;
+    return true;
+}
+
+// Stream length in bytes, 0 if the buffer can't even hold the header
+size_t VicSeriesEncoder::finish()
+{
+    if (_size < VIC_SERIES_HEADER)
+    {
+        return 0;
+    }
+
+    _dest[0] = _count & 0xff;
+    _dest[1] = _count >> 8;
+
+    return (_bitPos + 7) / 8;
+}
+
+uint16_t VicSeriesEncoder::getCount()
+{
+    return _count;
+}
+
+//
+// Decoder
+//
+
+VicSeriesDecoder::VicSeriesDecoder(const uint8_t *src, size_t len)
+    : _src(src),
+      _len(len),
+      _bitPos(VIC_SERIES_HEADER * 8),
+      _count(0),
+      _read(0),
+      _prevTime(0),
+      _prevDelta(0),
+      _prevValue(0)
+{
+    if (_len >= VIC_SERIES_HEADER)
+    {
+        _count = _src[0] | (_src[1] << 8);
+    }
+}
+
+uint16_t VicSeriesDecoder::getCount()
+{
+    return _count;
+}
+
+bool VicSeriesDecoder::readBits(uint8_t count, uint32_t *bits)
+{
+    if (_bitPos + count > _len * 8)
+    {
+        return false;
+    }
+
+    uint32_t result = 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        result = (result << 1) | ((_src[_bitPos / 8] >> (7 - (_bitPos % 8))) & 1);
+        _bitPos++;
+    }
+    *bits = result;
+
+    return true;
+}
+
+// Counts leading ones up to max, consuming the terminating zero if any
+bool VicSeriesDecoder::readPrefix(uint8_t max, uint8_t *ones)
+{
+    *ones = 0;
+    while (*ones < max)
+    {
+        uint32_t bit;
+        if (!readBits(1, &bit))
+        {
+            return false;
+        }
+        if (bit == 0)
+        {
+            break;
+        }
+        (*ones)++;
+    }
+
+    return true;
+}
+
+// False at the end of the stream or if it is damaged
+bool VicSeriesDecoder::next(uint32_t *time, int32_t *value)
+{
+    if (_read >= _count)
+    {
+        return false;
+    }
+
+    if (_read == 0)
+    {
+        uint32_t t, v;
+        if (!readBits(32, &t) || !readBits(32, &v))
+        {
+            return false;
+        }
+        _prevTime = t;
+        _prevValue = (int32_t)v;
+    }
+    else
+    {
+        uint8_t ones;
+        uint32_t bits;
+        int64_t dod = 0;
+
+        if (!readPrefix(4, &ones))
+        {
+            return false;
+        }
+        if (ones == 4)
+        {
+            if (!readBits(32, &bits))
+            {
+                return false;
+            }
+            dod = (int32_t)bits;
+        }
+        else if (ones > 0)
+        {
+            const VicSeriesBucket &b = g_timeBuckets[ones - 1];
+            if (!readBits(b.bits, &bits))
+            {
+                return false;
+            }
+            dod = (int64_t)bits + b.lo;
+        }
+        _prevDelta += dod;
+        _prevTime = (uint32_t)(_prevTime + _prevDelta);
+
+        uint32_t zz = 0;
+        if (!readPrefix(4, &ones))
+        {
+            return false;
+        }
+        if (ones == 4)
+        {
+            if (!readBits(32, &zz))
+            {
+                return false;
+            }
+        }
+        else if (ones > 0)
+        {
+            if (!readBits(g_valueBits[ones - 1], &zz))
+            {
+                return false;
+            }
+        }
+        _prevValue = (int32_t)((uint32_t)_prevValue + (uint32_t)unzigzag(zz));
+    }
+
+    *time = _prevTime;
+    *value = _prevValue;
+    _read++;
+
+    return true;
+}
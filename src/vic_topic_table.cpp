@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <string.h>
+#include <new>
+#include "vic_topic_table.hpp"
+#include "vic_encoding.hpp"
+#include "victron_defs.hpp"
+
+static const char *g_topicSuffixes[VIC_TOPIC_COUNT] = {
+    "state",
+    "schema",
+    "blocks",
+    "queue",
+    "backlog",
+    "backlog/series"};
+
+VicTopicTable::VicTopicTable()
+    : _pool(0), _poolSize(0)
+{
+    for (size_t id = 0; id < MAX_VIC_FIELDS; id++)
+    {
+        _fields[id] = VIC_TOPIC_NONE;
+    }
+    for (size_t t = 0; t < VIC_TOPIC_COUNT; t++)
+    {
+        _topics[t] = VIC_TOPIC_NONE;
+    }
+}
+
+VicTopicTable::~VicTopicTable()
+{
+    delete[] _pool;
+}
+
+// Two passes over the same keys, the first sizes the pool so it is
+// allocated exactly once
+bool VicTopicTable::build(const char *base)
+{
+    delete[] _pool;
+    _pool = 0;
+    _poolSize = 0;
+    for (size_t id = 0; id < MAX_VIC_FIELDS; id++)
+    {
+        _fields[id] = VIC_TOPIC_NONE;
+    }
+    for (size_t t = 0; t < VIC_TOPIC_COUNT; t++)
+    {
+        _topics[t] = VIC_TOPIC_NONE;
+    }
+
+    size_t baseLen = strlen(base);
+    size_t count = VictronDefs::getFieldCount();
+    if (count > MAX_VIC_FIELDS)
+    {
+        count = MAX_VIC_FIELDS;
+    }
+
+    char key[MAX_VIC_KEY];
+    size_t size = 0;
+    for (size_t id = 0; id < count; id++)
+    {
+        if (VicEncoding::fieldKey(id, key, sizeof(key)))
+        {
+            size += baseLen + 1 + strlen(key) + 1;
+        }
+    }
+    for (size_t t = 0; t < VIC_TOPIC_COUNT; t++)
+    {
+        size += baseLen + 1 + strlen(g_topicSuffixes[t]) + 1;
+    }
+
+    if (size >= VIC_TOPIC_NONE)
+    {
+        return false;
+    }
+
+    _pool = new (std::nothrow) char[size];
+    if (_pool == 0)
+    {
+        return false;
+    }
+
+    size_t offset = 0;
+    for (size_t id = 0; id < count; id++)
+    {
+        if (VicEncoding::fieldKey(id, key, sizeof(key)))
+        {
+            _fields[id] = offset;
+            offset += snprintf(_pool + offset, size - offset, "%s/%s", base, key) + 1;
+        }
+    }
+    for (size_t t = 0; t < VIC_TOPIC_COUNT; t++)
+    {
+        _topics[t] = offset;
+        offset += snprintf(_pool + offset, size - offset, "%s/%s", base, g_topicSuffixes[t]) + 1;
+    }
+
+    _poolSize = size;
+    return true;
+}
+
+const char *VicTopicTable::getField(uint8_t fieldId) const
+{
+    if ((fieldId >= MAX_VIC_FIELDS) || (_fields[fieldId] == VIC_TOPIC_NONE))
+    {
+        return 0;
+    }
+
+    return _pool + _fields[fieldId];
+}
+
+const char *VicTopicTable::getTopic(VicTopic topic) const
+{
+    if ((topic >= VIC_TOPIC_COUNT) || (_topics[topic] == VIC_TOPIC_NONE))
+    {
+        return 0;
+    }
+
+    return _pool + _topics[topic];
+}
+
+size_t VicTopicTable::getPoolSize() const
+{
+    return _poolSize;
+}
+
+//
+// Static functions
+//
+
+const char *VicTopicTable::getSuffix(VicTopic topic)
+{
+    return (topic < VIC_TOPIC_COUNT) ? g_topicSuffixes[topic] : "";
+}
@@ -0,0 +1,632 @@
+#include <string.h>
+#include <ctype.h>
+#include "victron_defs.hpp"
+#include "victron_defs_generated.hpp"
+
+//
+// Static data
+//
+
+VicExtraField VictronDefs::g_extraFields[MAX_VIC_EXTRA_FIELDS];
+size_t VictronDefs::g_extraFieldCount = 0;
+VicPolicyOverride VictronDefs::g_policyOverrides[MAX_VIC_POLICY_OVERRIDES];
+size_t VictronDefs::g_policyOverrideCount = 0;
+VicPolicy VictronDefs::g_defaultPolicy = g_vicDefaultPolicy;
+VicExprOverride VictronDefs::g_exprOverrides[MAX_VIC_EXPR_OVERRIDES];
+size_t VictronDefs::g_exprOverrideCount = 0;
+
+VicPolicyOverride::VicPolicyOverride()
+    : fieldId(0), policy{0, 0, 0, 0} {}
+
+VicExprOverride::VicExprOverride()
+    : fieldId(0), expr("") {}
+
+VicExtraField::VicExtraField()
+    : name(""), key(""), def{name, key, VIC_TYPE_UNKNOWN, 0} {}
+
+// Indexed by VicType, keep in enum order. Text, map and on/off types
+// have no units, the auto-ranged types are stored in the small unit.
+static const VicTypeScale g_vicTypeScales[] = {
+    {"", 0, 1},         // VIC_TYPE_UNKNOWN
+    {"%", 0, 1},        // VIC_TYPE_PCT
+    {"%", 1, 0.1f},     // VIC_TYPE_PCT_TENTH
+    {"V", 2, 0.01f},    // VIC_TYPE_VOLT_CENTI
+    {"kWh", 2, 10},     // VIC_TYPE_KWH_CENTI
+    {"A", 1, 0.1f},     // VIC_TYPE_AMP_TENTH
+    {"W", 0, 1},        // VIC_TYPE_WATT
+    {"VA", 0, 1},       // VIC_TYPE_VA
+    {"", 0, 1},         // VIC_TYPE_COUNTER
+    {"°C", 0, 1},       // VIC_TYPE_DEG_C
+    {"", 0, 1},         // VIC_TYPE_FW
+    {"", 0, 1},         // VIC_TYPE_FWE
+    {"mA", 0, 0.001f},  // VIC_TYPE_MA
+    {"mAh", 0, 0.001f}, // VIC_TYPE_MAH
+    {"mV", 0, 0.001f},  // VIC_TYPE_MV
+    {"", 0, 1},         // VIC_TYPE_MAP_AR
+    {"", 0, 1},         // VIC_TYPE_MAP_OR
+    {"", 0, 1},         // VIC_TYPE_MAP_CS
+    {"", 0, 1},         // VIC_TYPE_MAP_ERR
+    {"", 0, 1},         // VIC_TYPE_MAP_MODE
+    {"", 0, 1},         // VIC_TYPE_MAP_MPPT
+    {"", 0, 1},         // VIC_TYPE_MAP_PID
+    {"min", 0, 60},     // VIC_TYPE_MINUTES
+    {"", 0, 1},         // VIC_TYPE_ONOFF
+    {"", 0, 1},         // VIC_TYPE_DAY_SEQ
+    {"sec", 0, 1},      // VIC_TYPE_SECONDS
+    {"", 0, 1},         // VIC_TYPE_SERIAL
+    {"", 0, 1},         // VIC_TYPE_STRING
+};
+
+static_assert(sizeof(g_vicTypeScales) / sizeof(g_vicTypeScales[0]) == VIC_NUM_TYPES,
+              "g_vicTypeScales must have one entry per VicType");
+
+//
+// Static functions
+//
+
+const VicFieldDef *VictronDefs::findField(const char *name)
+{
+    // Runtime additions take precedence so they can retype compiled fields
+    for (size_t i = 0; i < g_extraFieldCount; i++)
+    {
+        if (strcmp(name, g_extraFields[i].name) == 0)
+        {
+            return &(g_extraFields[i].def);
+        }
+    }
+
+    // Derived fields follow the label fields and are never sent by a device
+    size_t lo = 0;
+    size_t hi = VIC_NUM_LABEL_FIELDS;
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        int cmp = strcmp(name, g_vicFieldDefs[mid].name);
+        if (cmp == 0)
+        {
+            return &(g_vicFieldDefs[mid]);
+        }
+        else if (cmp < 0)
+        {
+            hi = mid;
+        }
+        else
+        {
+            lo = mid + 1;
+        }
+    }
+
+    return 0;
+}
+
+// Any field, derived ones included, by label or by lower case key.
+// A linear search, for loading definitions rather than parsing blocks.
+const VicFieldDef *VictronDefs::lookupField(const char *nameOrKey)
+{
+    size_t count = getFieldCount();
+    for (size_t id = 0; id < count; id++)
+    {
+        const VicFieldDef *fieldDef = getField(id);
+        if ((fieldDef != 0) &&
+            ((strcmp(nameOrKey, fieldDef->name) == 0) || (strcmp(nameOrKey, fieldDef->key) == 0)))
+        {
+            return fieldDef;
+        }
+    }
+
+    return 0;
+}
+
+const VicFieldDef *VictronDefs::getField(uint8_t id)
+{
+    for (size_t i = 0; i < g_extraFieldCount; i++)
+    {
+        if (g_extraFields[i].def.id == id)
+        {
+            return &(g_extraFields[i].def);
+        }
+    }
+
+    if (id < VIC_NUM_FIELDS)
+    {
+        return &(g_vicFieldDefs[id]);
+    }
+
+    return 0;
+}
+
+size_t VictronDefs::getFieldCount()
+{
+    size_t count = VIC_NUM_FIELDS;
+    for (size_t i = 0; i < g_extraFieldCount; i++)
+    {
+        if (g_extraFields[i].def.id >= VIC_NUM_FIELDS)
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+// Values kept as text rather than parsed to an integer
+bool VictronDefs::isTextType(VicType type)
+{
+    switch (type)
+    {
+    case VIC_TYPE_UNKNOWN:
+    case VIC_TYPE_FW:
+    case VIC_TYPE_FWE:
+    case VIC_TYPE_SERIAL:
+    case VIC_TYPE_STRING:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+// Quantities with units, where a min, max or mean means something.
+// Not text, states, codes, flags or counts.
+bool VictronDefs::isMeasurementType(VicType type)
+{
+    switch (type)
+    {
+    case VIC_TYPE_PCT:
+    case VIC_TYPE_PCT_TENTH:
+    case VIC_TYPE_VOLT_CENTI:
+    case VIC_TYPE_KWH_CENTI:
+    case VIC_TYPE_AMP_TENTH:
+    case VIC_TYPE_WATT:
+    case VIC_TYPE_VA:
+    case VIC_TYPE_DEG_C:
+    case VIC_TYPE_MA:
+    case VIC_TYPE_MAH:
+    case VIC_TYPE_MV:
+    case VIC_TYPE_MINUTES:
+    case VIC_TYPE_SECONDS:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+const VicMap *VictronDefs::getMap(VicMapId map)
+{
+    if (map >= VIC_NUM_MAPS)
+    {
+        return 0;
+    }
+
+    return &(g_vicMaps[map]);
+}
+
+const char *VictronDefs::lookupMap(VicMapId map, int32_t key)
+{
+    const VicMap *m = getMap(map);
+    if (m == 0)
+    {
+        return 0;
+    }
+
+    size_t lo = 0;
+    size_t hi = m->count;
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if (m->entries[mid].key == key)
+        {
+            return m->entries[mid].value;
+        }
+        else if (key < m->entries[mid].key)
+        {
+            hi = mid;
+        }
+        else
+        {
+            lo = mid + 1;
+        }
+    }
+
+    return 0;
+}
+
+VicType VictronDefs::typeFromName(const char *typeName)
+{
+    size_t lo = 0;
+    size_t hi = sizeof(g_vicTypeNames) / sizeof(g_vicTypeNames[0]);
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        int cmp = strcmp(typeName, g_vicTypeNames[mid].name);
+        if (cmp == 0)
+        {
+            return g_vicTypeNames[mid].type;
+        }
+        else if (cmp < 0)
+        {
+            hi = mid;
+        }
+        else
+        {
+            lo = mid + 1;
+        }
+    }
+
+    return VIC_TYPE_UNKNOWN;
+}
+
+// Type name as used in the definitions file, "" for VIC_TYPE_UNKNOWN
+const char *VictronDefs::typeName(VicType type)
+{
+    for (size_t i = 0; i < sizeof(g_vicTypeNames) / sizeof(g_vicTypeNames[0]); i++)
+    {
+        if (g_vicTypeNames[i].type == type)
+        {
+            return g_vicTypeNames[i].name;
+        }
+    }
+
+    return "";
+}
+
+const VicTypeScale *VictronDefs::getTypeScale(VicType type)
+{
+    if (type >= VIC_NUM_TYPES)
+    {
+        return &(g_vicTypeScales[VIC_TYPE_UNKNOWN]);
+    }
+
+    return &(g_vicTypeScales[type]);
+}
+
+bool VictronDefs::addField(const char *name, VicType type)
+{
+    if ((type == VIC_TYPE_UNKNOWN) ||
+        (strlen(name) >= MAX_VIC_FIELDNAME))
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < g_extraFieldCount; i++)
+    {
+        if (strcmp(name, g_extraFields[i].name) == 0)
+        {
+            // Already added at runtime, just retype it
+            g_extraFields[i].def.type = type;
+            return true;
+        }
+    }
+
+    // Compiled derived fields aren't found by label
+    const VicFieldDef *existing = findField(name);
+    for (size_t id = VIC_NUM_LABEL_FIELDS; (existing == 0) && (id < VIC_NUM_FIELDS); id++)
+    {
+        if (strcmp(name, g_vicFieldDefs[id].name) == 0)
+        {
+            existing = &(g_vicFieldDefs[id]);
+        }
+    }
+    if ((existing != 0) && (existing->type == type))
+    {
+        // Compiled definition already matches, nothing to override
+        return true;
+    }
+
+    if (g_extraFieldCount >= MAX_VIC_EXTRA_FIELDS)
+    {
+        return false;
+    }
+
+    VicExtraField *extra = &(g_extraFields[g_extraFieldCount]);
+    strcpy(extra->name, name);
+    for (size_t i = 0; name[i] != '\0'; i++)
+    {
+        extra->key[i] = tolower(name[i]);
+    }
+    extra->key[strlen(name)] = '\0';
+    extra->def.type = type;
+    extra->def.id = (existing != 0) ? existing->id : getFieldCount();
+    g_extraFieldCount++;
+
+    return true;
+}
+
+const VicPolicy *VictronDefs::getPolicy(uint8_t id)
+{
+    for (size_t i = 0; i < g_policyOverrideCount; i++)
+    {
+        if (g_policyOverrides[i].fieldId == id)
+        {
+            return &(g_policyOverrides[i].policy);
+        }
+    }
+
+    // A compiled field on the compiled default follows a new default
+    if ((id < VIC_NUM_FIELDS) && !samePolicy(g_vicPolicies[id], g_vicDefaultPolicy))
+    {
+        return &(g_vicPolicies[id]);
+    }
+
+    return &g_defaultPolicy;
+}
+
+// Replaces the policy of a known field, derived ones included, e.g. from
+// an override file
+bool VictronDefs::setPolicy(const char *name, const VicPolicy &policy)
+{
+    const VicFieldDef *fieldDef = lookupField(name);
+    if (fieldDef == 0)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < g_policyOverrideCount; i++)
+    {
+        if (g_policyOverrides[i].fieldId == fieldDef->id)
+        {
+            g_policyOverrides[i].policy = policy;
+            return true;
+        }
+    }
+
+    if (g_policyOverrideCount >= MAX_VIC_POLICY_OVERRIDES)
+    {
+        return false;
+    }
+
+    g_policyOverrides[g_policyOverrideCount].fieldId = fieldDef->id;
+    g_policyOverrides[g_policyOverrideCount].policy = policy;
+    g_policyOverrideCount++;
+
+    return true;
+}
+
+const VicPolicy *VictronDefs::getDefaultPolicy()
+{
+    return &g_defaultPolicy;
+}
+
+void VictronDefs::setDefaultPolicy(const VicPolicy &policy)
+{
+    g_defaultPolicy = policy;
+}
+
+bool VictronDefs::samePolicy(const VicPolicy &a, const VicPolicy &b)
+{
+    return (a.deadband == b.deadband) &&
+           (a.deadbandPctTenth == b.deadbandPctTenth) &&
+           (a.minInterval_s == b.minInterval_s) &&
+           (a.maxInterval_s == b.maxInterval_s);
+}
+
+const char *VictronDefs::getExpr(uint8_t id)
+{
+    for (size_t i = 0; i < g_exprOverrideCount; i++)
+    {
+        if (g_exprOverrides[i].fieldId == id)
+        {
+            return (g_exprOverrides[i].expr[0] != '\0') ? g_exprOverrides[i].expr : 0;
+        }
+    }
+
+    for (size_t i = 0; i < VIC_NUM_DERIVED_EXPRS; i++)
+    {
+        if (g_vicDerivedExprs[i].fieldId == id)
+        {
+            return g_vicDerivedExprs[i].expr;
+        }
+    }
+
+    return 0;
+}
+
+// Derives a known field from others, or stops deriving it with an empty
+// expression. Checked when the expressions are compiled, see VicDerived.
+bool VictronDefs::setExpr(const char *name, const char *expr)
+{
+    const VicFieldDef *fieldDef = lookupField(name);
+    if ((fieldDef == 0) || (strlen(expr) >= MAX_VIC_EXPR))
+    {
+        return false;
+    }
+
+    VicExprOverride *o = 0;
+    for (size_t i = 0; i < g_exprOverrideCount; i++)
+    {
+        if (g_exprOverrides[i].fieldId == fieldDef->id)
+        {
+            o = &(g_exprOverrides[i]);
+        }
+    }
+    if (o == 0)
+    {
+        if (g_exprOverrideCount >= MAX_VIC_EXPR_OVERRIDES)
+        {
+            return false;
+        }
+        o = &(g_exprOverrides[g_exprOverrideCount++]);
+    }
+
+    o->fieldId = fieldDef->id;
+    strcpy(o->expr, expr);
+
+    return true;
+}
+
+// [version][definitions hash u32][extra count]
+//   {[name length][name][type]}...
+// [default policy]
+// [policy count]
+//   {[field id][policy]}...
+// [expression count]
+//   {[field id][length][expression]}...
+// A policy is [deadband i32][deadbandPctTenth u16][minInterval u16]
+// [maxInterval u16]. All little endian. Field IDs only hold for the
+// compiled definitions the blob was saved with, which the hash names.
+#define VIC_OVERRIDES_VERSION 4
+#define VIC_POLICY_BYTES 10
+
+static size_t putPolicy(uint8_t *dest, const VicPolicy &policy)
+{
+    size_t len = 0;
+    for (int b = 0; b < 4; b++)
+    {
+        dest[len++] = (uint32_t)policy.deadband >> (b * 8);
+    }
+    dest[len++] = policy.deadbandPctTenth & 0xff;
+    dest[len++] = policy.deadbandPctTenth >> 8;
+    dest[len++] = policy.minInterval_s & 0xff;
+    dest[len++] = policy.minInterval_s >> 8;
+    dest[len++] = policy.maxInterval_s & 0xff;
+    dest[len++] = policy.maxInterval_s >> 8;
+
+    return len;
+}
+
+static VicPolicy takePolicy(const uint8_t *data)
+{
+    VicPolicy policy;
+    policy.deadband = (int32_t)((uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+                                ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24));
+    policy.deadbandPctTenth = data[4] | (data[5] << 8);
+    policy.minInterval_s = data[6] | (data[7] << 8);
+    policy.maxInterval_s = data[8] | (data[9] << 8);
+
+    return policy;
+}
+
+size_t VictronDefs::saveOverrides(uint8_t *dest, size_t size)
+{
+    if (size < MAX_VIC_OVERRIDES_BLOB)
+    {
+        return 0;
+    }
+
+    size_t len = 0;
+    dest[len++] = VIC_OVERRIDES_VERSION;
+    for (int b = 0; b < 4; b++)
+    {
+        dest[len++] = VIC_DEFS_HASH >> (b * 8);
+    }
+    dest[len++] = g_extraFieldCount;
+    for (size_t i = 0; i < g_extraFieldCount; i++)
+    {
+        size_t nameLen = strlen(g_extraFields[i].name);
+        dest[len++] = nameLen;
+        memcpy(dest + len, g_extraFields[i].name, nameLen);
+        len += nameLen;
+        dest[len++] = g_extraFields[i].def.type;
+    }
+
+    len += putPolicy(dest + len, g_defaultPolicy);
+    dest[len++] = g_policyOverrideCount;
+    for (size_t i = 0; i < g_policyOverrideCount; i++)
+    {
+        dest[len++] = g_policyOverrides[i].fieldId;
+        len += putPolicy(dest + len, g_policyOverrides[i].policy);
+    }
+
+    dest[len++] = g_exprOverrideCount;
+    for (size_t i = 0; i < g_exprOverrideCount; i++)
+    {
+        size_t exprLen = strlen(g_exprOverrides[i].expr);
+        dest[len++] = g_exprOverrides[i].fieldId;
+        dest[len++] = exprLen;
+        memcpy(dest + len, g_exprOverrides[i].expr, exprLen);
+        len += exprLen;
+    }
+
+    return len;
+}
+
+// Extra fields are added again in their original order, so they get
+// the same IDs as when they were saved
+bool VictronDefs::loadOverrides(const uint8_t *data, size_t len)
+{
+    if ((len < 8) || (data[0] != VIC_OVERRIDES_VERSION) ||
+        (((uint32_t)data[1] | ((uint32_t)data[2] << 8) |
+          ((uint32_t)data[3] << 16) | ((uint32_t)data[4] << 24)) != VIC_DEFS_HASH))
+    {
+        return false;
+    }
+
+    g_extraFieldCount = 0;
+    g_policyOverrideCount = 0;
+    g_exprOverrideCount = 0;
+    g_defaultPolicy = g_vicDefaultPolicy;
+
+    size_t pos = 5;
+    size_t extraCount = data[pos++];
+    for (size_t i = 0; i < extraCount; i++)
+    {
+        char name[MAX_VIC_FIELDNAME];
+        size_t nameLen = (pos < len) ? data[pos++] : MAX_VIC_FIELDNAME;
+        if ((nameLen >= MAX_VIC_FIELDNAME) || (pos + nameLen + 1 > len))
+        {
+            g_extraFieldCount = 0;
+            return false;
+        }
+        memcpy(name, data + pos, nameLen);
+        name[nameLen] = '\0';
+        pos += nameLen;
+
+        if (!addField(name, (VicType)data[pos++]))
+        {
+            g_extraFieldCount = 0;
+            return false;
+        }
+    }
+
+    if (pos + VIC_POLICY_BYTES > len)
+    {
+        g_extraFieldCount = 0;
+        return false;
+    }
+    VicPolicy defaultPolicy = takePolicy(data + pos);
+    pos += VIC_POLICY_BYTES;
+
+    size_t policyCount = (pos < len) ? data[pos++] : 0;
+    if ((policyCount > MAX_VIC_POLICY_OVERRIDES) || (pos + (policyCount * (1 + VIC_POLICY_BYTES)) > len))
+    {
+        g_extraFieldCount = 0;
+        return false;
+    }
+    for (size_t i = 0; i < policyCount; i++)
+    {
+        VicPolicyOverride &o = g_policyOverrides[i];
+        o.fieldId = data[pos++];
+        o.policy = takePolicy(data + pos);
+        pos += VIC_POLICY_BYTES;
+    }
+    g_policyOverrideCount = policyCount;
+
+    size_t exprCount = (pos < len) ? data[pos++] : MAX_VIC_EXPR_OVERRIDES + 1;
+    if (exprCount > MAX_VIC_EXPR_OVERRIDES)
+    {
+        g_extraFieldCount = 0;
+        g_policyOverrideCount = 0;
+        return false;
+    }
+    for (size_t i = 0; i < exprCount; i++)
+    {
+        size_t exprLen = (pos + 2 <= len) ? data[pos + 1] : MAX_VIC_EXPR;
+        if ((exprLen >= MAX_VIC_EXPR) || (pos + 2 + exprLen > len))
+        {
+            g_extraFieldCount = 0;
+            g_policyOverrideCount = 0;
+            return false;
+        }
+
+        VicExprOverride &o = g_exprOverrides[i];
+        o.fieldId = data[pos];
+        memcpy(o.expr, data + pos + 2, exprLen);
+        o.expr[exprLen] = '\0';
+        pos += 2 + exprLen;
+    }
+    g_exprOverrideCount = exprCount;
+    g_defaultPolicy = defaultPolicy;
+
+    return true;
+}
@@ -0,0 +1,172 @@
+//
+// VictronDefs at runtime: policies and expressions for derived fields
+// are accepted the same way the generator accepts them, by label or key,
+// and loading the definitions file the firmware was built from changes
+// nothing.
+//
+//   pio test -e native_test -f test_defs
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <unity.h>
+#include "victron_defs.hpp"
+#include "vic_derived.hpp"
+#include "ve_direct_text.hpp"
+#include "vic_hal_host.hpp"
+#include "../ve_direct_fixture.hpp"
+
+#define DEFS_PATH "defs/victron_data_def.json"
+
+// The compiled definitions, restored before each test
+static uint8_t g_compiled[MAX_VIC_OVERRIDES_BLOB];
+static size_t g_compiledLen;
+
+static void feedBlock(VEDirectText &text, const char *const *fields, size_t count)
+{
+  std::string block = veDirectBlock(fields, count);
+
+  // Twice, the first block only syncs the parser
+  text.handleBytes((const uint8_t *)block.data(), block.size());
+  text.handleBytes((const uint8_t *)block.data(), block.size());
+}
+
+static bool loadDefsText(const char *json)
+{
+  const char *path = "test_defs.json";
+  FILE *f = fopen(path, "w");
+  fputs(json, f);
+  fclose(f);
+
+  VicStdioFile file;
+  bool loaded = file.open(path) && VEDirectText::loadDefs(file);
+  file.close();
+  remove(path);
+
+  return loaded;
+}
+
+static size_t savedLen()
+{
+  uint8_t blob[MAX_VIC_OVERRIDES_BLOB];
+  return VictronDefs::saveOverrides(blob, sizeof(blob));
+}
+
+void setUp()
+{
+  VictronDefs::loadOverrides(g_compiled, g_compiledLen);
+  VicDerived::build();
+}
+
+void tearDown()
+{
+}
+
+void test_policy_for_derived_field()
+{
+  VicPolicy policy = {25, 0, 10, 120};
+  TEST_ASSERT_TRUE(VictronDefs::setPolicy("ipv", policy));
+  TEST_ASSERT_EQUAL_INT32(25, VictronDefs::getPolicy(VIC_FIELD_IPV)->deadband);
+  TEST_ASSERT_EQUAL_UINT16(120, VictronDefs::getPolicy(VIC_FIELD_IPV)->maxInterval_s);
+
+  policy.deadband = 5;
+  TEST_ASSERT_TRUE(VictronDefs::setPolicy("eff", policy));
+  TEST_ASSERT_EQUAL_INT32(5, VictronDefs::getPolicy(VIC_FIELD_EFF)->deadband);
+
+  TEST_ASSERT_FALSE(VictronDefs::setPolicy("nope", policy));
+}
+
+// A derived field read by another expression, computed in order
+void test_expression_reads_derived_field()
+{
+  const VicFieldDef *ipv = VictronDefs::lookupField("ipv");
+  TEST_ASSERT_NOT_NULL(ipv);
+  TEST_ASSERT_EQUAL_UINT8(VIC_FIELD_IPV, ipv->id);
+
+  TEST_ASSERT_TRUE(VictronDefs::addField("PVW", VIC_TYPE_WATT));
+  TEST_ASSERT_TRUE(VictronDefs::setExpr("PVW", "ipv * VPV"));
+  TEST_ASSERT_TRUE_MESSAGE(VicDerived::build(), VicDerived::getBuildError());
+
+  const char *mppt[MPPT_FIELD_COUNT];
+  memcpy(mppt, MPPT_FIELDS, sizeof(mppt));
+  mppt[5] = "VPV\t35000";
+  VEDirectText text;
+  feedBlock(text, mppt, MPPT_FIELD_COUNT);
+
+  // 700 W / 35 V = 20 A, and back to 700 W
+  const VicSlot *slot = text.getSlot(VIC_FIELD_IPV);
+  TEST_ASSERT_NOT_NULL(slot);
+  TEST_ASSERT_EQUAL_INT32(20000, slot->value);
+
+  slot = text.getSlot(VictronDefs::lookupField("PVW")->id);
+  TEST_ASSERT_NOT_NULL(slot);
+  TEST_ASSERT_INT_WITHIN(1, 700, slot->value);
+}
+
+// The shipped file has more policies than there are override slots, all
+// of them already compiled in
+void test_shipped_defs_add_no_overrides()
+{
+  VicStdioFile file;
+  TEST_ASSERT_TRUE(file.open(DEFS_PATH));
+  TEST_ASSERT_TRUE_MESSAGE(VEDirectText::loadDefs(file), VEDirectText::getLoadDefsError());
+  TEST_ASSERT_EQUAL_size_t(g_compiledLen, savedLen());
+  TEST_ASSERT_TRUE_MESSAGE(VicDerived::build(), VicDerived::getBuildError());
+}
+
+void test_default_policy()
+{
+  VicPolicy ppv = *VictronDefs::getPolicy(VIC_FIELD_PPV);
+
+  TEST_ASSERT_TRUE_MESSAGE(loadDefsText("{\"policies\": {\"default\": {\"maxInterval\": 600},"
+                                        " \"eff\": {\"deadband\": 3}}}"),
+                           VEDirectText::getLoadDefsError());
+
+  // H1 has no policy of its own and follows the default, PPV keeps its own
+  TEST_ASSERT_EQUAL_UINT16(600, VictronDefs::getDefaultPolicy()->maxInterval_s);
+  TEST_ASSERT_EQUAL_UINT16(600, VictronDefs::getPolicy(VIC_FIELD_H1)->maxInterval_s);
+  TEST_ASSERT_TRUE(VictronDefs::samePolicy(ppv, *VictronDefs::getPolicy(VIC_FIELD_PPV)));
+  TEST_ASSERT_EQUAL_INT32(3, VictronDefs::getPolicy(VIC_FIELD_EFF)->deadband);
+
+  // Fields added at runtime too
+  TEST_ASSERT_TRUE(VictronDefs::addField("NEW", VIC_TYPE_WATT));
+  TEST_ASSERT_EQUAL_UINT16(600, VictronDefs::getPolicy(VictronDefs::lookupField("NEW")->id)->maxInterval_s);
+
+  // And the default survives the overrides cache
+  uint8_t blob[MAX_VIC_OVERRIDES_BLOB];
+  size_t len = VictronDefs::saveOverrides(blob, sizeof(blob));
+  TEST_ASSERT_TRUE(VictronDefs::loadOverrides(g_compiled, g_compiledLen));
+  TEST_ASSERT_EQUAL_UINT16(300, VictronDefs::getPolicy(VIC_FIELD_H1)->maxInterval_s);
+  TEST_ASSERT_TRUE(VictronDefs::loadOverrides(blob, len));
+  TEST_ASSERT_EQUAL_UINT16(600, VictronDefs::getPolicy(VIC_FIELD_H1)->maxInterval_s);
+}
+
+// Cached overrides name fields by ID, so they're refused once the
+// compiled definitions change
+void test_overrides_keyed_on_definitions()
+{
+  VicPolicy policy = {25, 0, 10, 120};
+  TEST_ASSERT_TRUE(VictronDefs::setPolicy("ipv", policy));
+
+  uint8_t blob[MAX_VIC_OVERRIDES_BLOB];
+  size_t len = VictronDefs::saveOverrides(blob, sizeof(blob));
+  TEST_ASSERT_TRUE(VictronDefs::loadOverrides(blob, len));
+  TEST_ASSERT_EQUAL_INT32(25, VictronDefs::getPolicy(VIC_FIELD_IPV)->deadband);
+
+  blob[2] ^= 0x01;
+  TEST_ASSERT_FALSE(VictronDefs::loadOverrides(blob, len));
+}
+
+int main(int argc, char **argv)
+{
+  g_compiledLen = VictronDefs::saveOverrides(g_compiled, sizeof(g_compiled));
+
+  UNITY_BEGIN();
+  RUN_TEST(test_policy_for_derived_field);
+  RUN_TEST(test_expression_reads_derived_field);
+  RUN_TEST(test_shipped_defs_add_no_overrides);
+  RUN_TEST(test_default_policy);
+  RUN_TEST(test_overrides_keyed_on_definitions);
+  return UNITY_END();
+}
@@ -0,0 +1,235 @@
+//
+// VEDirectParser and VEDirectText fed the same stream in random sized
+// chunks must see exactly what a single pass sees: the same fields,
+// HEX frames and good and bad blocks, whatever the chunk boundaries.
+//
+//   pio test -e native_test -f test_parser
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <unity.h>
+#include "ve_direct_parser.hpp"
+#include "ve_direct_text.hpp"
+#include "../ve_direct_fixture.hpp"
+
+static std::vector<uint8_t> g_stream;
+
+static void appendBlock(std::vector<uint8_t> &stream, const char *const *fields, size_t count, bool corrupt)
+{
+  std::string block = veDirectBlock(fields, count);
+  if (corrupt)
+  {
+    block[block.size() / 2] ^= 0x01;
+  }
+  stream.insert(stream.end(), block.begin(), block.end());
+}
+
+static void appendText(std::vector<uint8_t> &stream, const char *text)
+{
+  stream.insert(stream.end(), text, text + strlen(text));
+}
+
+// BMV-712 and MPPT blocks as they come off the wire, with HEX traffic,
+// damaged blocks and an overlong line in between
+static void buildStream()
+{
+  static const char *const bmv[] = {
+      "PID\t0xA381", "V\t12843", "VS\t12863", "I\t-4512", "P\t-58", "CE\t-1234",
+      "SOC\t876", "TTG\t522", "Alarm\tOFF", "Relay\tOFF", "AR\t0", "BMV\t712 Smart",
+      "FW\t0408", "MON\t0"};
+
+  g_stream.clear();
+  char value[24];
+  for (int i = 0; i < 40; i++)
+  {
+    appendBlock(g_stream, bmv, sizeof(bmv) / sizeof(bmv[0]), (i % 7) == 3);
+
+    std::vector<const char *> fields(MPPT_FIELDS, MPPT_FIELDS + MPPT_FIELD_COUNT);
+    snprintf(value, sizeof(value), "PPV\t%d", 700 + i);
+    fields[6] = value;
+    appendBlock(g_stream, fields.data(), fields.size(), (i % 11) == 5);
+
+    if ((i % 5) == 0)
+    {
+      // A GET response for the panel power register, then a frame with
+      // a bad checksum
+      char hex[VED_MAX_HEX];
+      uint8_t data[] = {0xbc, 0xed, 0x00, 0xbc, 0x02, 0x00, 0x00};
+      VEDirectHex::encode(hex, sizeof(hex), 0x7, data, sizeof(data));
+      appendText(g_stream, hex);
+      appendText(g_stream, ":7BCED0000AABB\n");
+    }
+    if ((i % 13) == 7)
+    {
+      // Longer than any label or value, the block it's in goes bad
+      appendText(g_stream, "\r\nV\t");
+      for (int j = 0; j < 3 * VED_MAX_VALUE; j++)
+      {
+        g_stream.push_back('1');
+      }
+    }
+  }
+}
+
+// Every event the parser reports, with its payload, as one string
+static std::string parseEvents(uint32_t seed, size_t maxChunk)
+{
+  VEDirectParser parser;
+  std::string events;
+  uint32_t state = seed;
+
+  for (size_t pos = 0; pos < g_stream.size();)
+  {
+    size_t chunk = (seed == 0) ? g_stream.size() : 1 + nextRandom(state) % maxChunk;
+    size_t end = (pos + chunk < g_stream.size()) ? pos + chunk : g_stream.size();
+    for (; pos < end; pos++)
+    {
+      switch (parser.feed(g_stream[pos]))
+      {
+      case VEDirectParser::EVENT_FIELD:
+        events += "F:";
+        events += parser.getLabel();
+        events += "=";
+        events += parser.getValue();
+        events += "\n";
+        break;
+      case VEDirectParser::EVENT_BLOCK_GOOD:
+        events += "GOOD\n";
+        break;
+      case VEDirectParser::EVENT_BLOCK_BAD:
+        events += "BAD\n";
+        break;
+      case VEDirectParser::EVENT_HEX:
+        events += "H:";
+        events.append(parser.getHex(), parser.getHexLen());
+        events += "\n";
+        break;
+      case VEDirectParser::EVENT_NONE:
+        break;
+      }
+    }
+  }
+
+  char counts[64];
+  snprintf(counts, sizeof(counts), "good %lu bad %lu resyncs %lu",
+           (unsigned long)parser.getGoodBlocks(), (unsigned long)parser.getBadBlocks(),
+           (unsigned long)parser.getResyncs());
+  events += counts;
+
+  return events;
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_single_pass_sees_every_block()
+{
+  std::string events = parseEvents(0, 0);
+
+  // 40 BMV and 40 MPPT blocks. The first only syncs the parser, 10
+  // are damaged on purpose and 3 more take in an overlong line.
+  TEST_ASSERT_TRUE(events.find("good 66 bad 13 resyncs 3") != std::string::npos);
+  TEST_ASSERT_TRUE(events.find("H:7BCED00BC020000E7\n") != std::string::npos);
+}
+
+void test_random_chunks_match_single_pass()
+{
+  std::string expected = parseEvents(0, 0);
+
+  for (uint32_t seed = 1; seed <= 200; seed++)
+  {
+    size_t maxChunk = (seed % 4 == 0) ? 3 : (seed % 4 == 1) ? 17 : (seed % 4 == 2) ? 200 : 4096;
+    std::string events = parseEvents(seed, maxChunk);
+    char message[48];
+    snprintf(message, sizeof(message), "seed %lu", (unsigned long)seed);
+    TEST_ASSERT_TRUE_MESSAGE(events == expected, message);
+  }
+}
+
+// The text processor sits on the parser, its values and block counts
+// mustn't depend on the chunks either
+void test_text_random_chunks_match_single_pass()
+{
+  VEDirectText single;
+  single.handleBytes(g_stream.data(), g_stream.size());
+
+  for (uint32_t seed = 1; seed <= 50; seed++)
+  {
+    VEDirectText chunked;
+    uint32_t state = seed;
+    for (size_t pos = 0; pos < g_stream.size();)
+    {
+      size_t chunk = 1 + nextRandom(state) % 64;
+      if (pos + chunk > g_stream.size())
+      {
+        chunk = g_stream.size() - pos;
+      }
+      chunked.handleBytes(&g_stream[pos], chunk);
+      pos += chunk;
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(single.getGoodBlocks(), chunked.getGoodBlocks());
+    TEST_ASSERT_EQUAL_UINT32(single.getBadBlocks(), chunked.getBadBlocks());
+    TEST_ASSERT_EQUAL_UINT32(single.getBadHexFrames(), chunked.getBadHexFrames());
+    for (size_t id = 0; id < VIC_NUM_FIELDS; id++)
+    {
+      const VicSlot *a = single.getSlot(id);
+      const VicSlot *b = chunked.getSlot(id);
+      TEST_ASSERT_EQUAL(a != 0, b != 0);
+      if (a != 0)
+      {
+        TEST_ASSERT_EQUAL_INT32(a->value, b->value);
+        TEST_ASSERT_EQUAL_STRING(single.getText(id), chunked.getText(id));
+      }
+    }
+  }
+}
+
+// Values as stored, hex fields with every bit and negative ones included
+void test_text_stores_values()
+{
+  static const char *const mppt[] = {
+      "PID\t0xA057", "V\t14600", "I\t-4512", "CS\t3", "AR\t0", "OR\t0x80000001"};
+
+  std::vector<uint8_t> stream;
+  appendBlock(stream, mppt, sizeof(mppt) / sizeof(mppt[0]), false);
+  appendBlock(stream, mppt, sizeof(mppt) / sizeof(mppt[0]), false);
+
+  VEDirectText text;
+  text.handleBytes(stream.data(), stream.size());
+  TEST_ASSERT_EQUAL_UINT32(1, text.getGoodBlocks());
+
+  const VicSlot *slot = text.getSlot(VIC_FIELD_OR);
+  TEST_ASSERT_NOT_NULL(slot);
+  TEST_ASSERT_EQUAL_UINT32(0x80000001, (uint32_t)slot->value);
+  TEST_ASSERT_EQUAL_INT32(0xA057, text.getSlot(VIC_FIELD_PID)->value);
+  TEST_ASSERT_EQUAL_INT32(14600, text.getSlot(VIC_FIELD_V)->value);
+  TEST_ASSERT_EQUAL_INT32(-4512, text.getSlot(VIC_FIELD_I)->value);
+  TEST_ASSERT_EQUAL_INT32(3, text.getSlot(VIC_FIELD_CS)->value);
+
+  // The shared stream sends OR too
+  VEDirectText single;
+  single.handleBytes(g_stream.data(), g_stream.size());
+  TEST_ASSERT_NOT_NULL(single.getSlot(VIC_FIELD_OR));
+  TEST_ASSERT_EQUAL_INT32(0, single.getSlot(VIC_FIELD_OR)->value);
+}
+
+int main(int argc, char **argv)
+{
+  buildStream();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_single_pass_sees_every_block);
+  RUN_TEST(test_random_chunks_match_single_pass);
+  RUN_TEST(test_text_random_chunks_match_single_pass);
+  RUN_TEST(test_text_stores_values);
+  return UNITY_END();
+}
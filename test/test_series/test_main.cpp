@@ -0,0 +1,177 @@
+//
+// VicSeriesEncoder and VicSeriesDecoder: every sample comes back exactly
+// as it went in, whichever escape its time and value need, and a sample
+// that doesn't fit leaves the stream as it was.
+//
+//   pio test -e native_test -f test_series
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unity.h>
+#include "vic_series.hpp"
+
+#define MAX_BUF 1024
+
+static uint8_t g_buf[MAX_BUF];
+
+// Encodes the samples and checks they decode unchanged, g_len is the
+// stream length
+static size_t g_len;
+
+static void roundTrip(const uint32_t *times, const int32_t *values, size_t count)
+{
+  VicSeriesEncoder encoder(g_buf, sizeof(g_buf));
+  for (size_t i = 0; i < count; i++)
+  {
+    TEST_ASSERT_TRUE(encoder.add(times[i], values[i]));
+  }
+  g_len = encoder.finish();
+
+  VicSeriesDecoder decoder(g_buf, g_len);
+  TEST_ASSERT_EQUAL_UINT16(count, decoder.getCount());
+
+  uint32_t time;
+  int32_t value;
+  for (size_t i = 0; i < count; i++)
+  {
+    TEST_ASSERT_TRUE(decoder.next(&time, &value));
+    TEST_ASSERT_EQUAL_UINT32(times[i], time);
+    TEST_ASSERT_EQUAL_INT32(values[i], value);
+  }
+  TEST_ASSERT_FALSE(decoder.next(&time, &value));
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+// A steady 1 Hz series costs two bits a sample
+void test_steady_series()
+{
+  uint32_t times[100];
+  int32_t values[100];
+  for (size_t i = 0; i < 100; i++)
+  {
+    times[i] = 1700000000 + i;
+    values[i] = 13000;
+  }
+
+  // Header, first sample, 2 + 7 and 1 bits for the first step
+  roundTrip(times, values, 100);
+  TEST_ASSERT_EQUAL_size_t(2 + (64 + 9 + 1 + 98 * 2 + 7) / 8, g_len);
+}
+
+// Each delta of delta bucket up to its edge, then the 32 bit escape
+// just past it, both ways
+void test_time_escapes()
+{
+  static const int32_t edges[][2] = {{-63, 64}, {-255, 256}, {-2047, 2048}};
+  static const uint8_t bits[] = {2 + 7, 3 + 9, 4 + 12};
+  int32_t values[3] = {0, 0, 0};
+
+  for (size_t b = 0; b < 3; b++)
+  {
+    for (size_t side = 0; side < 2; side++)
+    {
+      // Two samples at the same time make the step 0, the third step is
+      // then the delta of delta
+      int32_t dod = edges[b][side];
+      uint32_t times[3] = {1000000, 1000000, (uint32_t)(1000000 + dod)};
+      roundTrip(times, values, 3);
+      TEST_ASSERT_EQUAL_size_t(2 + (64 + 2 + bits[b] + 1 + 7) / 8, g_len);
+
+      times[2] += (side == 0) ? -1 : 1;
+      roundTrip(times, values, 3);
+      if (b == 2)
+      {
+        TEST_ASSERT_EQUAL_size_t(2 + (64 + 2 + 36 + 1 + 7) / 8, g_len);
+      }
+    }
+  }
+}
+
+// Clock steps back, and times across the 32 bit wrap
+void test_time_backwards()
+{
+  uint32_t times[] = {1700000000, 1700000010, 1699999000, 1699999001, 5, 0xffffffff, 0,
+                      0x80000000, 0x7fffffff, 0, 0xffffffff, 1700000000, 1700000001};
+  int32_t values[sizeof(times) / sizeof(times[0])];
+  for (size_t i = 0; i < sizeof(times) / sizeof(times[0]); i++)
+  {
+    values[i] = (int32_t)i;
+  }
+
+  roundTrip(times, values, sizeof(times) / sizeof(times[0]));
+}
+
+// Value deltas that overflow 32 bits
+void test_value_extremes()
+{
+  int32_t values[] = {INT32_MIN, INT32_MAX, INT32_MIN, 0, -1, INT32_MAX, INT32_MAX, 1, INT32_MIN,
+                      -63, 64, -4096, 4096, -524288, 524288, 0};
+  uint32_t times[sizeof(values) / sizeof(values[0])];
+  for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+  {
+    times[i] = 1700000000 + i;
+  }
+
+  roundTrip(times, values, sizeof(values) / sizeof(values[0]));
+
+  // And as the first sample, the rest unchanged
+  int32_t first[] = {INT32_MIN, INT32_MIN};
+  roundTrip(times, first, 2);
+}
+
+// A sample that doesn't fit is refused and the bits it had written are
+// cleared, so a smaller one can still follow it
+void test_full_buffer_rolls_back()
+{
+  // Header, the first sample and 16 bits to spare, then a guard byte
+  uint8_t buf[2 + 8 + 2 + 1];
+  VicSeriesEncoder encoder(buf, sizeof(buf) - 1);
+  buf[sizeof(buf) - 1] = 0xa5;
+
+  TEST_ASSERT_TRUE(encoder.add(1000, 100));
+  // 2 + 7 time bits and 4 + 32 value bits
+  TEST_ASSERT_FALSE(encoder.add(1001, INT32_MIN));
+  TEST_ASSERT_EQUAL_UINT16(1, encoder.getCount());
+  // 2 + 7 time bits and 1 value bit
+  TEST_ASSERT_TRUE(encoder.add(1001, 100));
+  // 1 time bit and 4 + 32 value bits, with 6 left
+  TEST_ASSERT_FALSE(encoder.add(1002, INT32_MIN));
+  TEST_ASSERT_EQUAL_UINT16(2, encoder.getCount());
+  // 1 time bit and 1 value bit, over the bits the refused one set
+  TEST_ASSERT_TRUE(encoder.add(1002, 100));
+
+  TEST_ASSERT_EQUAL_size_t(sizeof(buf) - 1, encoder.finish());
+  TEST_ASSERT_EQUAL_UINT8(0xa5, buf[sizeof(buf) - 1]);
+
+  VicSeriesDecoder decoder(buf, sizeof(buf) - 1);
+  TEST_ASSERT_EQUAL_UINT16(3, decoder.getCount());
+  uint32_t time;
+  int32_t value;
+  for (uint32_t i = 0; i < 3; i++)
+  {
+    TEST_ASSERT_TRUE(decoder.next(&time, &value));
+    TEST_ASSERT_EQUAL_UINT32(1000 + i, time);
+    TEST_ASSERT_EQUAL_INT32(100, value);
+  }
+  TEST_ASSERT_FALSE(decoder.next(&time, &value));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_steady_series);
+  RUN_TEST(test_time_escapes);
+  RUN_TEST(test_time_backwards);
+  RUN_TEST(test_value_extremes);
+  RUN_TEST(test_full_buffer_rolls_back);
+  return UNITY_END();
+}
@@ -0,0 +1,283 @@
+//
+// SPSCQueue and VEDirectText::takeChanges with a real producer and
+// consumer thread each, as the reader tasks and the publisher run on
+// the board. Nothing may be lost, reordered or torn, and a reader that
+// finds the queue full must still deliver its latest values.
+//
+//   pio test -e native_test -f test_spsc
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <unity.h>
+#include "spsc_queue.hpp"
+#include "ve_direct_text.hpp"
+#include "../ve_direct_fixture.hpp"
+
+#define ITEMS 2000000
+
+struct Item
+{
+  uint32_t seq;
+  uint32_t check;
+};
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+// A producer that retries on full gets every item through, in order
+void test_queue_keeps_order_under_load()
+{
+  static SPSCQueue<Item, 64> queue;
+  uint32_t bad = 0;
+
+  std::thread consumer([&]() {
+    Item item;
+    for (uint32_t expected = 0; expected < ITEMS;)
+    {
+      if (!queue.pop(&item))
+      {
+        std::this_thread::yield();
+        continue;
+      }
+      if ((item.seq != expected) || (item.check != ~item.seq))
+      {
+        bad++;
+      }
+      expected++;
+    }
+  });
+
+  Item item;
+  for (uint32_t seq = 0; seq < ITEMS; seq++)
+  {
+    item.seq = seq;
+    item.check = ~seq;
+    while (!queue.push(item))
+    {
+      std::this_thread::yield();
+    }
+  }
+  consumer.join();
+
+  TEST_ASSERT_EQUAL_UINT32(0, bad);
+  TEST_ASSERT_EQUAL_UINT32(0, queue.size());
+  TEST_ASSERT_TRUE(queue.getHighWater() <= 64);
+}
+
+// One that doesn't loses only what it counts as dropped, and what does
+// arrive is still in order
+void test_queue_counts_every_drop()
+{
+  static SPSCQueue<Item, 64> queue;
+  std::atomic<bool> done(false);
+  uint32_t received = 0;
+  uint32_t bad = 0;
+
+  std::thread consumer([&]() {
+    Item item;
+    uint32_t last = 0;
+    uint32_t state = 7;
+    for (;;)
+    {
+      bool finished = done;
+      if (!queue.pop(&item))
+      {
+        if (finished)
+        {
+          break;
+        }
+        std::this_thread::yield();
+        continue;
+      }
+      if (((received > 0) && (item.seq <= last)) || (item.check != ~item.seq))
+      {
+        bad++;
+      }
+      last = item.seq;
+      received++;
+      if ((nextRandom(state) % 64) == 0)
+      {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  Item item;
+  for (uint32_t seq = 0; seq < ITEMS; seq++)
+  {
+    item.seq = seq;
+    item.check = ~seq;
+    queue.push(item);
+  }
+  done = true;
+  consumer.join();
+
+  TEST_ASSERT_EQUAL_UINT32(0, bad);
+  TEST_ASSERT_EQUAL_UINT32(ITEMS, received + queue.getDrops());
+}
+
+// A reader feeding MPPT blocks into a small queue with a slow publisher.
+// Whatever the queue turns away stays pending, so once the reader has
+// flushed the publisher's view matches the processor's exactly and every
+// block marker comes after the fields of its block.
+void test_text_changes_survive_full_queue()
+{
+  std::string stream;
+  char v[16], i[16], vpv[16], ppv[16], h19[16];
+  for (int n = 0; n < 3000; n++)
+  {
+    const char *fields[MPPT_FIELD_COUNT];
+    memcpy(fields, MPPT_FIELDS, sizeof(fields));
+    snprintf(v, sizeof(v), "V\t%d", 13000 + (n % 1700));
+    snprintf(i, sizeof(i), "I\t%d", (n * 37) % 50000);
+    snprintf(vpv, sizeof(vpv), "VPV\t%d", 30000 + (n % 9000));
+    snprintf(ppv, sizeof(ppv), "PPV\t%d", n % 1000);
+    snprintf(h19, sizeof(h19), "H19\t%d", 12345 + n / 10);
+    fields[3] = v;
+    fields[4] = i;
+    fields[5] = vpv;
+    fields[6] = ppv;
+    fields[13] = h19;
+    stream += veDirectBlock(fields, MPPT_FIELD_COUNT);
+  }
+
+  VEDirectText text;
+  VicDeltaQueue queue;
+  std::atomic<bool> done(false);
+
+  int32_t values[VIC_NUM_FIELDS];
+  bool seen[VIC_NUM_FIELDS] = {false};
+  uint32_t blocks = 0;
+  uint32_t fieldsSinceBlock = 0;
+  uint32_t lastKind = VIC_DELTA_BLOCK;
+
+  std::thread publisher([&]() {
+    VicDelta delta;
+    uint32_t state = 11;
+    for (;;)
+    {
+      bool finished = done;
+      if (!queue.pop(&delta))
+      {
+        if (finished)
+        {
+          break;
+        }
+        std::this_thread::yield();
+        continue;
+      }
+      if (delta.kind == VIC_DELTA_FIELD)
+      {
+        values[delta.fieldId] = delta.value;
+        seen[delta.fieldId] = true;
+        fieldsSinceBlock++;
+      }
+      else if (delta.kind == VIC_DELTA_BLOCK)
+      {
+        blocks++;
+        fieldsSinceBlock = 0;
+      }
+      lastKind = delta.kind;
+      if ((nextRandom(state) % 8) == 0)
+      {
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+      }
+    }
+  });
+
+  uint32_t state = 3;
+  for (size_t pos = 0; pos < stream.size();)
+  {
+    size_t chunk = 1 + nextRandom(state) % 128;
+    if (pos + chunk > stream.size())
+    {
+      chunk = stream.size() - pos;
+    }
+    text.handleBytes((const uint8_t *)&stream[pos], chunk);
+    pos += chunk;
+    if (text.hasChanges())
+    {
+      text.takeChanges(queue);
+    }
+  }
+  while (text.hasChanges() && !text.takeChanges(queue))
+  {
+    std::this_thread::yield();
+  }
+  done = true;
+  publisher.join();
+
+  TEST_ASSERT_TRUE(queue.getDrops() > 0);
+  TEST_ASSERT_TRUE(blocks > 0);
+  TEST_ASSERT_TRUE(blocks <= text.getGoodBlocks());
+  TEST_ASSERT_EQUAL_UINT32(VIC_DELTA_BLOCK, lastKind);
+  TEST_ASSERT_EQUAL_UINT32(0, fieldsSinceBlock);
+  TEST_ASSERT_TRUE(seen[VIC_FIELD_OR] && seen[VIC_FIELD_PID] && seen[VIC_FIELD_V]);
+
+  for (size_t id = 0; id < VIC_NUM_FIELDS; id++)
+  {
+    const VicSlot *slot = text.getSlot(id);
+    char message[48];
+    snprintf(message, sizeof(message), "field %lu", (unsigned long)id);
+    TEST_ASSERT_EQUAL_MESSAGE(slot != 0, seen[id], message);
+    if (slot != 0)
+    {
+      TEST_ASSERT_EQUAL_MESSAGE(slot->value, values[id], message);
+    }
+  }
+}
+
+// After a reconnect the publisher has the reader send its text fields
+// again, they aren't in the ring log
+void test_text_fields_sent_again()
+{
+  static const char *const mppt[] = {
+      "PID\t0xA057", "FW\t159", "SER#\tHQ2028ABCDE", "V\t14600", "I\t47900", "CS\t3"};
+
+  std::string stream;
+  stream += veDirectBlock(mppt, sizeof(mppt) / sizeof(mppt[0]));
+  stream += veDirectBlock(mppt, sizeof(mppt) / sizeof(mppt[0]));
+
+  VEDirectText text;
+  VicDeltaQueue queue;
+  VicDelta delta;
+  text.handleBytes((const uint8_t *)stream.data(), stream.size());
+  TEST_ASSERT_TRUE(text.takeChanges(queue));
+  while (queue.pop(&delta))
+  {
+  }
+
+  text.markTextChanged();
+  TEST_ASSERT_TRUE(text.hasChanges());
+  TEST_ASSERT_TRUE(text.takeChanges(queue));
+
+  std::string sent;
+  while (queue.pop(&delta))
+  {
+    TEST_ASSERT_EQUAL_UINT8(VIC_DELTA_FIELD, delta.kind);
+    sent += VictronDefs::getField(delta.fieldId)->name;
+    sent += "=";
+    sent.append((const char *)delta.data, delta.len);
+    sent += " ";
+  }
+  TEST_ASSERT_EQUAL_STRING("FW=159 SER#=HQ2028ABCDE ", sent.c_str());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_queue_keeps_order_under_load);
+  RUN_TEST(test_queue_counts_every_drop);
+  RUN_TEST(test_text_changes_survive_full_queue);
+  RUN_TEST(test_text_fields_sent_again);
+  return UNITY_END();
+}
@@ -0,0 +1,49 @@
+#ifndef __H_VE_DIRECT_FIXTURE__
+#define __H_VE_DIRECT_FIXTURE__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+//
+// VE.Direct text blocks for the host tests, built the way a device
+// sends them, and a seeded random source so a failure can be replayed.
+//
+
+// An MPPT block as it comes off the wire. Tests copy it and replace
+// values by index, V is 3, I 4, VPV 5, PPV 6 and H19 13.
+static const char *const MPPT_FIELDS[] = {
+  "PID\t0xA057", "FW\t159", "SER#\tHQ2028ABCDE", "V\t14600", "I\t47900",
+  "VPV\t35680", "PPV\t700", "CS\t3", "MPPT\t2", "OR\t0x00000000", "ERR\t0",
+  "LOAD\tON", "IL\t300", "H19\t12345", "H20\t0", "H21\t700", "H22\t12", "H23\t650", "HSDS\t42"};
+
+#define MPPT_FIELD_COUNT (sizeof(MPPT_FIELDS) / sizeof(MPPT_FIELDS[0]))
+
+// Deterministic, so a failure can be replayed from its seed
+static inline uint32_t nextRandom(uint32_t &state)
+{
+  state = state * 1664525 + 1013904223;
+  return state >> 8;
+}
+
+// One block of label/value fields with its checksum
+static inline std::string veDirectBlock(const char *const *fields, size_t count)
+{
+  std::string block;
+  for (size_t i = 0; i < count; i++)
+  {
+    block += "\r\n";
+    block += fields[i];
+  }
+  block += "\r\nChecksum\t";
+
+  uint8_t sum = 0;
+  for (size_t i = 0; i < block.size(); i++)
+  {
+    sum += (uint8_t)block[i];
+  }
+  block += (char)(uint8_t)(256 - sum);
+  return block;
+}
+
+#endif
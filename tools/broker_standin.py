@@ -0,0 +1,132 @@
+#
+# Stands in for the broker and its discovery responder on a Linux box,
+# to exercise the board's reconnect logic (or src/native/reconnect.cpp)
+# without a real broker. Answers discovery requests on UDP and accepts
+# MQTT connections far enough to CONNACK them and answer pings.
+#
+#   python tools/broker_standin.py [--discovery-port 2112] [--port 1883]
+#       [--address 127.0.0.1] [--drop 2] [--loss 0.3]
+#       [--restart-every 20 --down 5] [--move] [--no-discovery]
+#
+#   --drop N         ignore the first N discovery requests
+#   --loss P         then ignore each one with probability P
+#   --restart-every  drop every client and stop listening every S seconds
+#   --down           for this many seconds
+#   --move           come back on the next port each time, so the cached
+#                    broker is stale and only discovery finds it again
+#   --no-discovery   leave discovery to tools/discovery_agent.py, to run
+#                    several stand-ins behind one agent
+#
+
+import argparse
+import random
+import select
+import socket
+import time
+
+MAGIC = bytes([0xDE, 0xAD, 0xFA, 0xCE, 0xB0, 0x0B, 0x1E, 0xDD])
+
+
+def log(start, message):
+    print("%8.3f %s" % (time.monotonic() - start, message), flush=True)
+
+
+def listen(port):
+    server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server.bind(("0.0.0.0", port))
+    server.listen(8)
+    return server
+
+
+def on_mqtt(client, data):
+    # Whole packets are assumed, fine for CONNECT and PINGREQ on loopback
+    while len(data) >= 2:
+        kind = data[0] >> 4
+        size = data[1]
+        if kind == 1:
+            client.send(bytes([0x20, 2, 0, 0]))
+        elif kind == 12:
+            client.send(bytes([0xD0, 0]))
+        data = data[2 + size:]
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--discovery-port", type=int, default=2112)
+    parser.add_argument("--port", type=int, default=1883)
+    parser.add_argument("--address", default="127.0.0.1")
+    parser.add_argument("--drop", type=int, default=0)
+    parser.add_argument("--loss", type=float, default=0)
+    parser.add_argument("--restart-every", type=float, default=0)
+    parser.add_argument("--down", type=float, default=5)
+    parser.add_argument("--move", action="store_true")
+    parser.add_argument("--no-discovery", action="store_true")
+    args = parser.parse_args()
+
+    start = time.monotonic()
+    udp = None
+    if not args.no_discovery:
+        udp = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        udp.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        udp.bind(("0.0.0.0", args.discovery_port))
+
+    port = args.port
+    server = listen(port)
+    clients = []
+    requests = 0
+    next_restart = start + args.restart_every if args.restart_every else None
+    up_at = None
+    log(start, "broker on %s:%d" % (args.address, port))
+
+    while True:
+        now = time.monotonic()
+        if (next_restart is not None) and (now >= next_restart) and (server is not None):
+            for client in clients:
+                client.close()
+            clients = []
+            server.close()
+            server = None
+            up_at = now + args.down
+            log(start, "broker down")
+        if (up_at is not None) and (now >= up_at):
+            port = port + 1 if args.move else port
+            server = listen(port)
+            up_at = None
+            next_restart = now + args.restart_every
+            log(start, "broker up on %s:%d" % (args.address, port))
+
+        sockets = ([udp] if udp is not None else []) + clients + ([server] if server is not None else [])
+        readable, _, _ = select.select(sockets, [], [], 0.1)
+        for sock in readable:
+            if sock is udp:
+                data, sender = udp.recvfrom(64)
+                if (len(data) < 14) or (data[:8] != MAGIC):
+                    continue
+                requests += 1
+                reply_to = (socket.inet_ntoa(data[8:12]), (data[12] << 8) + data[13])
+                if (requests <= args.drop) or (random.random() < args.loss) or (server is None):
+                    log(start, "discovery from %s:%d ignored" % reply_to)
+                    continue
+                reply = MAGIC + socket.inet_aton(args.address) + bytes([port >> 8, port & 0xFF])
+                if len(data) >= 17:
+                    # Version 2, echo the sequence number, clients as load
+                    reply += bytes([2]) + data[15:17] + bytes([min(255, len(clients))])
+                udp.sendto(reply, reply_to)
+                log(start, "discovery from %s:%d answered" % reply_to)
+            elif sock is server:
+                client, address = server.accept()
+                clients.append(client)
+                log(start, "client %s:%d connected" % address)
+            else:
+                data = sock.recv(256)
+                if not data:
+                    clients.remove(sock)
+                    sock.close()
+                    log(start, "client gone")
+                else:
+                    on_mqtt(sock, data)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,113 @@
+#
+# Reference discovery agent. Answers the board's broadcast discovery
+# requests with one reply per broker it's told about, see
+# include/vic_discovery.hpp for the protocol. Run one next to each
+# broker, so the round trip the board measures is the broker's own:
+#
+#   python tools/discovery_agent.py --broker 192.168.1.10:1883
+#
+# Several brokers, and made up delays and loads, let the board's choice
+# and failover be tried on one Linux host, with tools/broker_standin.py
+# as the brokers:
+#
+#   python tools/broker_standin.py --port 1883 --no-discovery &
+#   python tools/broker_standin.py --port 1884 --no-discovery &
+#   python tools/discovery_agent.py --broker 127.0.0.1:1883,delay=40 \
+#                                   --broker 127.0.0.1:1884,load=2
+#
+#   --broker host:port[,delay=ms][,load=n]
+#                   a broker to offer. Load is its established client
+#                   connections, counted from /proc/net/tcp, unless
+#                   given.
+#   --port          the discovery port, 2112 as on the board
+#
+
+import argparse
+import socket
+import threading
+import time
+
+MAGIC = bytes([0xDE, 0xAD, 0xFA, 0xCE, 0xB0, 0x0B, 0x1E, 0xDD])
+VERSION = 2
+
+
+class Broker:
+    def __init__(self, spec):
+        parts = spec.split(",")
+        host, port = parts[0].rsplit(":", 1)
+        self.address = socket.inet_aton(socket.gethostbyname(host))
+        self.port = int(port)
+        self.delay = 0
+        self.load = None
+        for option in parts[1:]:
+            key, value = option.split("=", 1)
+            if key == "delay":
+                self.delay = float(value) / 1000
+            elif key == "load":
+                self.load = int(value)
+            else:
+                raise ValueError("unknown broker option " + key)
+
+    def name(self):
+        return "%s:%d" % (socket.inet_ntoa(self.address), self.port)
+
+    def current_load(self):
+        if self.load is not None:
+            return self.load
+        return min(255, established(self.port))
+
+
+# Established TCP connections to a local port, Linux only
+def established(port):
+    count = 0
+    for table in ("/proc/net/tcp", "/proc/net/tcp6"):
+        try:
+            with open(table) as f:
+                next(f)
+                for line in f:
+                    fields = line.split()
+                    local_port = int(fields[1].rsplit(":", 1)[1], 16)
+                    if (local_port == port) and (fields[3] == "01"):
+                        count += 1
+        except OSError:
+            pass
+    return count
+
+
+def reply(sock, broker, request, reply_to):
+    data = MAGIC + broker.address + bytes([broker.port >> 8, broker.port & 0xFF])
+    if len(request) >= 17:
+        data += bytes([VERSION]) + request[15:17] + bytes([broker.current_load()])
+    sock.sendto(data, reply_to)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--broker", action="append", required=True)
+    parser.add_argument("--port", type=int, default=2112)
+    args = parser.parse_args()
+
+    brokers = [Broker(spec) for spec in args.broker]
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.bind(("0.0.0.0", args.port))
+    print("offering %s on UDP port %d" % (", ".join(b.name() for b in brokers), args.port), flush=True)
+
+    while True:
+        request, sender = sock.recvfrom(64)
+        if (len(request) < 14) or (request[:8] != MAGIC):
+            continue
+
+        reply_to = (socket.inet_ntoa(request[8:12]), (request[12] << 8) + request[13])
+        version = request[14] if len(request) >= 17 else 1
+        print("%s request v%d from %s:%d" % (time.strftime("%H:%M:%S"), version, *reply_to), flush=True)
+        for broker in brokers:
+            if broker.delay > 0:
+                threading.Timer(broker.delay, reply, (sock, broker, request, reply_to)).start()
+            else:
+                reply(sock, broker, request, reply_to)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,110 @@
+#
+# Writes a synthetic VE.Direct capture, the raw bytes a device sends, for
+# the native build and the trace benchmark when no real capture is at
+# hand. Values drift the way a battery monitor or a charger's do, every
+# block carries a correct checksum unless --corrupt is given.
+#
+#   python tools/gen_ve_trace.py bmv-712 3600 bmv-712.bin
+#   python tools/gen_ve_trace.py mppt-100-50 3600 mppt-100-50.bin
+#   python tools/gen_ve_trace.py mppt-100-30 3600 mppt-100-30.bin
+#
+# Real captures are better: they have the devices' own HEX traffic and
+# timing. Save one with any serial terminal at 19200 8N1.
+#
+
+import argparse
+import math
+import random
+
+
+def block(fields):
+    data = b"".join(b"\r\n" + k.encode() + b"\t" + v.encode() for k, v in fields)
+    data += b"\r\nChecksum\t"
+    return data + bytes([(256 - sum(data) % 256) % 256])
+
+
+def bmv_712(t, state):
+    # Discharging through the night, a little noise on top
+    state["soc"] = max(0, state["soc"] - 0.002)
+    i = int(-4500 + random.gauss(0, 150))
+    v = int(12600 + state["soc"] * 4 + random.gauss(0, 3))
+    state["ce"] += i / 3600.0
+    return [
+        block([
+            ("PID", "0xA381"), ("V", str(v)), ("VS", str(v + 20)),
+            ("I", str(i)), ("P", str(v * i // 1000000)),
+            ("CE", str(int(state["ce"]))), ("SOC", str(int(state["soc"] * 10))),
+            ("TTG", str(int(state["soc"] * 60))), ("Alarm", "OFF"),
+            ("Relay", "OFF"), ("AR", "0"), ("BMV", "712 Smart"),
+            ("FW", "0408"), ("MON", "0"),
+        ]),
+        block([
+            ("H1", "-102345"), ("H2", str(int(state["ce"]))), ("H3", "-90000"),
+            ("H4", "12"), ("H5", "0"), ("H6", "-3456789"), ("H7", "10567"),
+            ("H8", "14520"), ("H9", str(t)), ("H10", "3"), ("H11", "0"),
+            ("H12", "0"), ("H15", "0"), ("H16", "0"), ("H17", "8765"),
+            ("H18", "9876"),
+        ]),
+    ]
+
+
+def mppt(pid, load, t, state):
+    # Sun up over the run, clouds now and then
+    sun = max(0.0, math.sin(math.pi * (t % 43200) / 43200))
+    if random.random() < 0.01:
+        state["cloud"] = random.uniform(0.2, 1.0)
+    state["cloud"] = min(1.0, state["cloud"] + 0.01)
+    ppv = int(state["rated"] * sun * state["cloud"])
+    v = 13200 + int(ppv * 2)
+    i = ppv * 10000 // max(v, 1) * 100
+    vpv = 36000 + random.randint(-40, 40) * 10 if ppv else 21000
+    state["yield"] += ppv / 360000.0
+    fields = [
+        ("PID", pid), ("FW", "159"), ("SER#", "HQ2028ABCDE"),
+        ("V", str(v)), ("I", str(i)), ("VPV", str(vpv)), ("PPV", str(ppv)),
+        ("CS", "3" if ppv else "0"), ("MPPT", "2" if ppv else "0"),
+        ("OR", "0x00000000" if ppv else "0x00000001"), ("ERR", "0"),
+    ]
+    if load:
+        fields += [("LOAD", "ON"), ("IL", "300")]
+    fields += [
+        ("H19", str(int(state["yield"]) + 12345)), ("H20", str(int(state["yield"]))),
+        ("H21", str(state["rated"])), ("H22", "234"), ("H23", "567"),
+        ("HSDS", str(t // 86400)),
+    ]
+    return [block(fields)]
+
+
+DEVICES = {
+    "bmv-712": (bmv_712, {"soc": 95.0, "ce": -1000.0}),
+    "mppt-100-50": (lambda t, s: mppt("0xA057", True, t, s),
+                    {"rated": 700, "cloud": 1.0, "yield": 0.0}),
+    "mppt-100-30": (lambda t, s: mppt("0xA056", False, t, s),
+                    {"rated": 440, "cloud": 1.0, "yield": 0.0}),
+}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Write a synthetic VE.Direct capture")
+    parser.add_argument("device", choices=sorted(DEVICES))
+    parser.add_argument("seconds", type=int)
+    parser.add_argument("output")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--corrupt", type=float, default=0.0,
+                        help="fraction of blocks with a flipped byte")
+    args = parser.parse_args()
+
+    random.seed(args.seed)
+    generate, state = DEVICES[args.device]
+
+    with open(args.output, "wb") as out:
+        for t in range(args.seconds):
+            for data in generate(21600 + t, state):
+                if random.random() < args.corrupt:
+                    data = bytearray(data)
+                    data[random.randrange(len(data))] ^= 0x10
+                out.write(data)
+
+
+if __name__ == "__main__":
+    main()
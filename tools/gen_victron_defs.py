@@ -0,0 +1,262 @@
+#
+# Generates include/victron_fields.hpp and include/victron_defs_generated.hpp
+# from defs/victron_data_def.json
+#
+# Runs automatically as a PlatformIO pre-build script, or by hand with:
+#
+#   python tools/gen_victron_defs.py
+#
+
+import json
+import os
+import re
+import sys
+import zlib
+
+# VE.Direct type strings used in the definitions file and the VicType
+# enumerator each one maps to (see include/victron_defs.hpp)
+TYPES = {
+    "%": "VIC_TYPE_PCT",
+    "0.1 %": "VIC_TYPE_PCT_TENTH",
+    "0.01 V": "VIC_TYPE_VOLT_CENTI",
+    "0.01 kWh": "VIC_TYPE_KWH_CENTI",
+    "0.1 A": "VIC_TYPE_AMP_TENTH",
+    "W": "VIC_TYPE_WATT",
+    "VA": "VIC_TYPE_VA",
+    "count": "VIC_TYPE_COUNTER",
+    "deg_C": "VIC_TYPE_DEG_C",
+    "fw": "VIC_TYPE_FW",
+    "fwe": "VIC_TYPE_FWE",
+    "mA": "VIC_TYPE_MA",
+    "mAh": "VIC_TYPE_MAH",
+    "mV": "VIC_TYPE_MV",
+    "map_ar": "VIC_TYPE_MAP_AR",
+    "map_or": "VIC_TYPE_MAP_OR",
+    "map_cs": "VIC_TYPE_MAP_CS",
+    "map_err": "VIC_TYPE_MAP_ERR",
+    "map_mode": "VIC_TYPE_MAP_MODE",
+    "map_mppt": "VIC_TYPE_MAP_MPPT",
+    "map_pid": "VIC_TYPE_MAP_PID",
+    "min": "VIC_TYPE_MINUTES",
+    "onoff": "VIC_TYPE_ONOFF",
+    "range[0..364]": "VIC_TYPE_DAY_SEQ",
+    "sec": "VIC_TYPE_SECONDS",
+    "serial": "VIC_TYPE_SERIAL",
+    "string": "VIC_TYPE_STRING",
+}
+
+# Maps in the order of the VicMapId enumerators
+MAPS = ["map_ar", "map_or", "map_pid", "map_cs", "map_err", "map_mode", "map_mppt"]
+
+
+def c_string(s):
+    return '"' + s.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+
+def field_enum(name):
+    ident = "".join(c if c.isalnum() else "_" for c in name.upper())
+    if name.endswith("#"):
+        ident = ident[:-1] + "NUM"
+    return "VIC_FIELD_" + ident
+
+
+# Publish policy keys and their defaults, see VicPolicy
+POLICY_KEYS = ["deadband", "deadbandPct", "minInterval", "maxInterval", "onChange"]
+NO_POLICY = {"deadband": 0, "deadbandPct": 0, "minInterval": 0, "maxInterval": 0}
+
+
+def policy(entry, default):
+    for key in entry:
+        if key not in POLICY_KEYS:
+            raise ValueError("unknown policy key '%s'" % key)
+    if entry.get("onChange", False):
+        return dict(NO_POLICY)
+    p = dict(default)
+    p.update((k, v) for k, v in entry.items() if k != "onChange")
+    return p
+
+
+def c_policy(p):
+    return "{%d, %d, %d, %d}" % (int(p["deadband"]),
+                                 int(round(p["deadbandPct"] * 10)),
+                                 int(p["minInterval"]),
+                                 int(p["maxInterval"]))
+
+
+# Names in a derived field's expression, checked here so a typo fails
+# the build rather than the board's start-up (see include/vic_derived.hpp)
+EXPR_NAME = re.compile(r"[A-Za-z][A-Za-z0-9_#]*")
+
+
+def check_expr(f, names):
+    for name in EXPR_NAME.findall(f["expr"]):
+        if name not in names:
+            raise ValueError("field '%s' is derived from unknown field '%s'" % (f["name"], name))
+
+
+def map_key(key):
+    if isinstance(key, str):
+        return int(key, 0)
+    return int(key)
+
+
+def generate_fields(defs):
+    out = []
+    out.append("// Generated by tools/gen_victron_defs.py from defs/victron_data_def.json.")
+    out.append("// Do not edit by hand, edit the definitions file and rebuild.")
+    out.append("")
+    out.append("#ifndef __H_VICTRON_FIELDS__")
+    out.append("#define __H_VICTRON_FIELDS__")
+    out.append("")
+    out.append("#include <stddef.h>")
+    out.append("#include <stdint.h>")
+    out.append("")
+
+    fields = sorted(defs["fields"], key=lambda f: f["name"])
+    derived = defs.get("derived", [])
+    names = [f["name"] for f in fields] + [f["name"] for f in derived]
+    if len(set(names)) != len(names):
+        raise ValueError("duplicate field name in definitions file")
+
+    out.append("// Field IDs. Fields sent by the device come first, in the (strcmp)")
+    out.append("// order of the field table, followed by fields derived from them.")
+    out.append("enum VicFieldId : uint8_t")
+    out.append("{")
+    for f in fields:
+        out.append("    %s," % field_enum(f["name"]))
+    out.append("")
+    for f in derived:
+        out.append("    %s," % field_enum(f["name"]))
+    out.append("")
+    out.append("    VIC_NUM_FIELDS")
+    out.append("};")
+    out.append("")
+    out.append("static constexpr size_t VIC_NUM_LABEL_FIELDS = %d;" % len(fields))
+    out.append("")
+    out.append("#endif")
+    out.append("")
+
+    return "\n".join(out)
+
+
+def generate(defs):
+    out = []
+    out.append("// Generated by tools/gen_victron_defs.py from defs/victron_data_def.json.")
+    out.append("// Do not edit by hand, edit the definitions file and rebuild.")
+    out.append("")
+    out.append("#ifndef __H_VICTRON_DEFS_GENERATED__")
+    out.append("#define __H_VICTRON_DEFS_GENERATED__")
+    out.append("")
+    out.append('#include "victron_defs.hpp"')
+    out.append("")
+
+    fields = sorted(defs["fields"], key=lambda f: f["name"])
+    derived = defs.get("derived", [])
+
+    out.append("// Indexed by VicFieldId")
+    out.append("static constexpr VicFieldDef g_vicFieldDefs[] = {")
+    for f in fields + derived:
+        if f["type"] not in TYPES:
+            raise ValueError("field '%s' has unknown type '%s'" % (f["name"], f["type"]))
+        out.append("    {%s, %s, %s, %s}," % (c_string(f["name"]),
+                                              c_string(f["name"].lower()),
+                                              TYPES[f["type"]],
+                                              field_enum(f["name"])))
+    out.append("};")
+    out.append("")
+
+    for m in MAPS:
+        entries = sorted(defs[m], key=lambda e: map_key(e["key"]))
+        keys = [map_key(e["key"]) for e in entries]
+        if len(set(keys)) != len(keys):
+            raise ValueError("duplicate key in %s" % m)
+        out.append("static constexpr VicMapEntry g_vic_%s[] = {" % m)
+        for e in entries:
+            out.append("    {%d, %s}," % (map_key(e["key"]), c_string(e["value"])))
+        out.append("};")
+        out.append("")
+
+    policies = defs.get("policies", {})
+    names = set(f["name"] for f in fields + derived)
+    for name in policies:
+        if (name != "default") and (name not in names):
+            raise ValueError("policy for unknown field '%s'" % name)
+    default = policy(policies.get("default", {}), NO_POLICY)
+
+    out.append("// Publish policies, indexed by VicFieldId")
+    out.append("static constexpr VicPolicy g_vicPolicies[] = {")
+    for f in fields + derived:
+        p = policy(policies[f["name"]], default) if f["name"] in policies else default
+        out.append("    %s, // %s" % (c_policy(p), f["name"]))
+    out.append("};")
+    out.append("")
+    # Label or key, as the board accepts either
+    expr_names = set(names) | set(n.lower() for n in names)
+    exprs = [f for f in fields + derived if "expr" in f]
+    out.append("// Derived fields and the expressions they're computed from")
+    out.append("static constexpr VicDerivedExpr g_vicDerivedExprs[] = {")
+    for f in exprs:
+        check_expr(f, expr_names)
+        out.append("    {%s, %s}," % (field_enum(f["name"]), c_string(f["expr"])))
+    if not exprs:
+        out.append("    {0, 0},")
+    out.append("};")
+    out.append("static constexpr size_t VIC_NUM_DERIVED_EXPRS = %d;" % len(exprs))
+    out.append("")
+    out.append("// Fields added at runtime")
+    out.append("static constexpr VicPolicy g_vicDefaultPolicy = %s;" % c_policy(default))
+    out.append("")
+
+    out.append("// Type names, sorted for binary search")
+    out.append("static constexpr VicTypeName g_vicTypeNames[] = {")
+    for name in sorted(TYPES):
+        out.append("    {%s, %s}," % (c_string(name), TYPES[name]))
+    out.append("};")
+    out.append("")
+
+    out.append("static constexpr VicMap g_vicMaps[] = {")
+    for m in MAPS:
+        out.append("    {g_vic_%s, sizeof(g_vic_%s) / sizeof(g_vic_%s[0])}," % (m, m, m))
+    out.append("};")
+    out.append("")
+
+    # Overrides cached on the board name fields by ID, they only apply to
+    # the definitions they were made against
+    canonical = json.dumps(defs, sort_keys=True, separators=(",", ":"))
+    out.append("// CRC-32 of the definitions, see VictronDefs::saveOverrides()")
+    out.append("static constexpr uint32_t VIC_DEFS_HASH = 0x%08x;" % (zlib.crc32(canonical.encode("utf-8")) & 0xffffffff))
+    out.append("")
+    out.append("#endif")
+    out.append("")
+
+    return "\n".join(out)
+
+
+def write_if_changed(dest, text):
+    # Only touch the header when it changes so it doesn't force a rebuild
+    if os.path.exists(dest):
+        with open(dest, "r") as f:
+            if f.read() == text:
+                return
+
+    with open(dest, "w") as f:
+        f.write(text)
+    print("Generated %s" % dest)
+
+
+def run(project_dir):
+    src = os.path.join(project_dir, "defs", "victron_data_def.json")
+    include = os.path.join(project_dir, "include")
+
+    with open(src, "r") as f:
+        defs = json.load(f)
+
+    write_if_changed(os.path.join(include, "victron_fields.hpp"), generate_fields(defs))
+    write_if_changed(os.path.join(include, "victron_defs_generated.hpp"), generate(defs))
+
+
+try:
+    Import("env")
+    run(env.subst("$PROJECT_DIR"))
+except NameError:
+    run(os.path.dirname(os.path.dirname(os.path.abspath(sys.argv[0]))))
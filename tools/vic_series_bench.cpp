@@ -0,0 +1,194 @@
+//
+// Compression benchmark and round trip check for the series encoding
+// (include/vic_series.hpp) over raw VE.Direct captures.
+//
+// Every good text block is taken as one sample per numeric field, one
+// second apart as the devices send them, and each field's series is
+// encoded in chunks of an hour. Every chunk is decoded again and must
+// match. Sizes are compared against the 16 byte records of the offline
+// log and against the capture itself.
+//
+// Builds on the host:
+//
+//   g++ -std=c++11 -O2 -Iinclude -o vic_series_bench
+//       tools/vic_series_bench.cpp src/vic_series.cpp
+//       src/ve_direct_parser.cpp src/ve_direct_file_source.cpp
+//   ./vic_series_bench capture.bin...
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "ve_direct_file_source.hpp"
+#include "ve_direct_parser.hpp"
+#include "vic_series.hpp"
+
+#define CHUNK_SAMPLES 3600
+#define CHUNK_BYTES (CHUNK_SAMPLES * 10)
+#define LOG_RECORD_BYTES 16
+
+struct Sample
+{
+    uint32_t time;
+    int32_t value;
+};
+
+typedef std::map<std::string, std::vector<Sample>> SeriesMap;
+
+static bool parseInt(const char *text, int32_t *value)
+{
+    char *end;
+    long parsed = strtol(text, &end, 10);
+    if ((end == text) || (*end != '\0'))
+    {
+        return false;
+    }
+
+    *value = parsed;
+    return true;
+}
+
+static bool readCapture(const char *path, SeriesMap &series, uint32_t *bytes)
+{
+    VEDirectFileSource source;
+    if (!source.open(path))
+    {
+        fprintf(stderr, "Can't open %s\n", path);
+        return false;
+    }
+
+    VEDirectParser parser;
+    std::vector<std::pair<std::string, int32_t>> block;
+    uint32_t time = 1600000000;
+    uint8_t buf[512];
+    size_t len;
+    while ((len = source.read(buf, sizeof(buf), 0)) > 0)
+    {
+        for (size_t i = 0; i < len; i++)
+        {
+            int32_t value;
+            switch (parser.feed(buf[i]))
+            {
+            case VEDirectParser::EVENT_FIELD:
+                if (parseInt(parser.getValue(), &value))
+                {
+                    block.push_back(std::make_pair(std::string(parser.getLabel()), value));
+                }
+                break;
+
+            case VEDirectParser::EVENT_BLOCK_GOOD:
+                for (auto &field : block)
+                {
+                    series[field.first].push_back({time, field.second});
+                }
+                block.clear();
+                time++;
+                break;
+
+            case VEDirectParser::EVENT_BLOCK_BAD:
+                block.clear();
+                break;
+
+            default:
+                break;
+            }
+        }
+    }
+    *bytes = source.getBytesRead();
+
+    return true;
+}
+
+// Encoded size, 0 if the round trip fails
+static size_t encodeSeries(const std::vector<Sample> &samples)
+{
+    static uint8_t chunk[CHUNK_BYTES];
+    size_t total = 0;
+
+    for (size_t start = 0; start < samples.size(); start += CHUNK_SAMPLES)
+    {
+        size_t end = std::min(start + CHUNK_SAMPLES, samples.size());
+
+        VicSeriesEncoder encoder(chunk, sizeof(chunk));
+        for (size_t i = start; i < end; i++)
+        {
+            if (!encoder.add(samples[i].time, samples[i].value))
+            {
+                return 0;
+            }
+        }
+        size_t len = encoder.finish();
+
+        VicSeriesDecoder decoder(chunk, len);
+        for (size_t i = start; i < end; i++)
+        {
+            uint32_t time;
+            int32_t value;
+            if ((!decoder.next(&time, &value)) ||
+                (time != samples[i].time) ||
+                (value != samples[i].value))
+            {
+                return 0;
+            }
+        }
+
+        total += len;
+    }
+
+    return total;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s capture...\n", argv[0]);
+        return 2;
+    }
+
+    int failed = 0;
+    for (int a = 1; a < argc; a++)
+    {
+        SeriesMap series;
+        uint32_t captureBytes;
+        if (!readCapture(argv[a], series, &captureBytes))
+        {
+            failed++;
+            continue;
+        }
+
+        size_t samples = 0;
+        size_t encoded = 0;
+        printf("%s\n", argv[a]);
+        printf("  %-10s %8s %10s %10s %7s\n", "field", "samples", "records", "encoded", "ratio");
+        for (auto &s : series)
+        {
+            size_t len = encodeSeries(s.second);
+            if (len == 0)
+            {
+                printf("  %-10s round trip FAILED\n", s.first.c_str());
+                failed++;
+                continue;
+            }
+
+            size_t records = s.second.size() * LOG_RECORD_BYTES;
+            printf("  %-10s %8zu %10zu %10zu %6.1fx\n", s.first.c_str(),
+                   s.second.size(), records, len, (double)records / len);
+            samples += s.second.size();
+            encoded += len;
+        }
+
+        if (encoded > 0)
+        {
+            printf("  %-10s %8zu %10zu %10zu %6.1fx (capture %lu bytes, %.1fx)\n", "total",
+                   samples, samples * LOG_RECORD_BYTES, encoded,
+                   (double)(samples * LOG_RECORD_BYTES) / encoded,
+                   (unsigned long)captureBytes, (double)captureBytes / encoded);
+        }
+    }
+
+    return failed ? 1 : 0;
+}